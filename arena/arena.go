@@ -0,0 +1,171 @@
+package arena
+
+import (
+	"errors"
+	"fmt"
+	"sync"
+	"sync/atomic"
+
+	sys "golang.org/x/sys/unix"
+)
+
+const hugePageSize = 2 << 20
+
+var (
+	// ErrExhausted is returned when all slabs of an arena are in use.
+	ErrExhausted = errors.New("arena exhausted")
+)
+
+type config struct {
+	hugeTLB  bool
+	node     int
+	bindNode bool
+}
+
+type Option func(*config)
+
+// WithHugeTLB backs the arena with explicit (pre-reserved) huge pages (MAP_HUGETLB).
+// When no huge pages are available, the arena falls back to transparent huge pages.
+func WithHugeTLB() Option {
+	return func(o *config) {
+		o.hugeTLB = true
+	}
+}
+
+// Arena is a fixed set of equally sized, page-aligned slabs carved from a single
+// anonymous memory mapping outside of the Go heap. Slab memory is never scanned by the
+// garbage collector, and the mapping is backed with huge pages when possible to reduce
+// TLB misses when touching large frames.
+type Arena struct {
+	mem      []byte
+	slabSize int
+	hugeTLB  bool
+	node     int
+	slabs    []Slab
+
+	mu   sync.Mutex
+	free []int
+}
+
+// New maps an arena of count slabs, each able to hold size bytes. Slabs are
+// rounded up to the huge page size (2 MiB) so that slab boundaries stay page-aligned.
+func New(size, count int, options ...Option) (*Arena, error) {
+	if size <= 0 || count <= 0 {
+		return nil, fmt.Errorf("arena: invalid size %d or count %d", size, count)
+	}
+	var cfg config
+	for _, o := range options {
+		o(&cfg)
+	}
+
+	slabSize := (size + hugePageSize - 1) &^ (hugePageSize - 1)
+	a := &Arena{slabSize: slabSize, node: -1}
+
+	var err error
+	length := slabSize * count
+	if cfg.hugeTLB {
+		a.mem, err = sys.Mmap(-1, 0, length, sys.PROT_READ|sys.PROT_WRITE, sys.MAP_PRIVATE|sys.MAP_ANONYMOUS|sys.MAP_HUGETLB)
+		a.hugeTLB = err == nil
+	}
+	if a.mem == nil {
+		if a.mem, err = sys.Mmap(-1, 0, length, sys.PROT_READ|sys.PROT_WRITE, sys.MAP_PRIVATE|sys.MAP_ANONYMOUS); err != nil {
+			return nil, fmt.Errorf("arena: map: %w", err)
+		}
+		// transparent huge pages, ignore errors when THP is disabled
+		sys.Madvise(a.mem, sys.MADV_HUGEPAGE)
+	}
+
+	if cfg.bindNode {
+		if err := bindNode(a.mem, cfg.node); err != nil {
+			sys.Munmap(a.mem)
+			return nil, fmt.Errorf("arena: %w", err)
+		}
+		a.node = cfg.node
+	}
+
+	a.slabs = make([]Slab, count)
+	a.free = make([]int, count)
+	for i := range a.slabs {
+		a.slabs[i] = Slab{arena: a, index: i, buf: a.mem[i*slabSize : (i+1)*slabSize : (i+1)*slabSize]}
+		a.free[i] = count - 1 - i
+	}
+	return a, nil
+}
+
+// SlabSize returns the (rounded) capacity of each slab
+func (a *Arena) SlabSize() int {
+	return a.slabSize
+}
+
+// IsHugeTLB returns true if the arena is backed by explicit huge pages
+func (a *Arena) IsHugeTLB() bool {
+	return a.hugeTLB
+}
+
+// Available returns the number of free slabs
+func (a *Arena) Available() int {
+	a.mu.Lock()
+	defer a.mu.Unlock()
+	return len(a.free)
+}
+
+// Alloc returns a free slab with a reference count of one, or ErrExhausted.
+func (a *Arena) Alloc() (*Slab, error) {
+	a.mu.Lock()
+	defer a.mu.Unlock()
+	if len(a.free) == 0 {
+		return nil, ErrExhausted
+	}
+	idx := a.free[len(a.free)-1]
+	a.free = a.free[:len(a.free)-1]
+	s := &a.slabs[idx]
+	atomic.StoreInt32(&s.refs, 1)
+	return s, nil
+}
+
+func (a *Arena) put(s *Slab) {
+	a.mu.Lock()
+	a.free = append(a.free, s.index)
+	a.mu.Unlock()
+}
+
+// Close unmaps the arena. Slabs must not be used afterward.
+func (a *Arena) Close() error {
+	if a.mem == nil {
+		return nil
+	}
+	if err := sys.Munmap(a.mem); err != nil {
+		return fmt.Errorf("arena: unmap: %w", err)
+	}
+	a.mem = nil
+	return nil
+}
+
+// Slab is a page-aligned region of an arena. A slab is reference counted: it is
+// returned to its arena when the last reference is released.
+type Slab struct {
+	arena *Arena
+	index int
+	buf   []byte
+	refs  int32
+}
+
+// Bytes returns the full capacity of the slab
+func (s *Slab) Bytes() []byte {
+	return s.buf
+}
+
+// Retain adds a reference to the slab
+func (s *Slab) Retain() {
+	atomic.AddInt32(&s.refs, 1)
+}
+
+// Release drops a reference, the slab goes back to the arena once unreferenced.
+func (s *Slab) Release() {
+	switch refs := atomic.AddInt32(&s.refs, -1); {
+	case refs == 0:
+		s.arena.put(s)
+	case refs < 0:
+		panic("arena: slab released too many times")
+	}
+}
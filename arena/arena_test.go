@@ -0,0 +1,214 @@
+package arena
+
+import (
+	"errors"
+	"os"
+	"runtime"
+	"sync"
+	"testing"
+	"unsafe"
+)
+
+// 1080p RGBA frame
+const frameSize = 1920 * 1080 * 4
+
+func TestArenaSlabs(t *testing.T) {
+	if _, err := New(0, 1); err == nil {
+		t.Fatal("arena of empty slabs created")
+	}
+	if _, err := New(1, 0); err == nil {
+		t.Fatal("arena without slabs created")
+	}
+
+	for _, size := range []int{1, hugePageSize, hugePageSize + 1, frameSize} {
+		a, err := New(size, 3, WithHugeTLB()) // falls back when no huge pages are reserved
+		if err != nil {
+			t.Fatal(err)
+		}
+		want := (size + hugePageSize - 1) / hugePageSize * hugePageSize
+		if a.SlabSize() != want || a.SlabSize() < size {
+			t.Fatalf("size %d: slab size %d, want %d", size, a.SlabSize(), want)
+		}
+		var prev uintptr
+		for i := 0; i < 3; i++ {
+			slab, err := a.Alloc()
+			if err != nil {
+				t.Fatal(err)
+			}
+			b := slab.Bytes()
+			if len(b) != want || cap(b) != want {
+				t.Fatalf("size %d: slab of %d bytes (capacity %d), want %d", size, len(b), cap(b), want)
+			}
+			addr := uintptr(unsafe.Pointer(&b[0]))
+			if addr%uintptr(os.Getpagesize()) != 0 {
+				t.Fatalf("size %d: slab at %#x not page aligned", size, addr)
+			}
+			if prev != 0 && (addr < prev+uintptr(want) && prev < addr+uintptr(want)) {
+				t.Fatalf("size %d: slabs at %#x and %#x overlap", size, prev, addr)
+			}
+			prev = addr
+			b[0], b[len(b)-1] = 1, 1 // mapped and writable
+		}
+		if err := a.Close(); err != nil {
+			t.Fatal(err)
+		}
+		if err := a.Close(); err != nil {
+			t.Fatal(err)
+		}
+	}
+}
+
+func TestArenaAllocRelease(t *testing.T) {
+	const count = 4
+	a, err := New(4096, count)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer a.Close()
+
+	slabs := make(map[*Slab]bool)
+	for i := 0; i < count; i++ {
+		slab, err := a.Alloc()
+		if err != nil {
+			t.Fatal(err)
+		}
+		if slabs[slab] {
+			t.Fatal("slab allocated twice")
+		}
+		slabs[slab] = true
+		if a.Available() != count-1-i {
+			t.Fatalf("%d slabs available after %d allocations", a.Available(), i+1)
+		}
+	}
+	if _, err := a.Alloc(); !errors.Is(err, ErrExhausted) {
+		t.Fatalf("allocation from an exhausted arena: %v", err)
+	}
+
+	// a retained slab goes back to the arena with its last reference only
+	var slab *Slab
+	for slab = range slabs {
+		break
+	}
+	slab.Retain()
+	slab.Release()
+	if a.Available() != 0 {
+		t.Fatal("slab released while still referenced")
+	}
+	slab.Release()
+	if a.Available() != 1 {
+		t.Fatal("unreferenced slab not released")
+	}
+	again, err := a.Alloc()
+	if err != nil || again != slab {
+		t.Fatalf("released slab not reused: %v", err)
+	}
+
+	// releasing too many times panics
+	again.Release()
+	func() {
+		defer func() {
+			if recover() == nil {
+				t.Fatal("double release did not panic")
+			}
+		}()
+		again.Release()
+	}()
+	if a.Available() != 1 {
+		t.Fatalf("%d slabs available after a double release, want 1", a.Available())
+	}
+}
+
+func TestArenaConcurrent(t *testing.T) {
+	const count, workers = 8, 16
+	a, err := New(4096, count)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer a.Close()
+
+	var wg sync.WaitGroup
+	for w := 0; w < workers; w++ {
+		wg.Add(1)
+		go func(id byte) {
+			defer wg.Done()
+			for i := 0; i < 1000; i++ {
+				slab, err := a.Alloc()
+				if errors.Is(err, ErrExhausted) {
+					runtime.Gosched()
+					continue
+				}
+				if err != nil {
+					t.Error(err)
+					return
+				}
+				// a slab has a single owner until released
+				b := slab.Bytes()[:64]
+				for j := range b {
+					b[j] = id
+				}
+				runtime.Gosched()
+				for j := range b {
+					if b[j] != id {
+						t.Errorf("slab %d shared by workers %d and %d", slab.index, id, b[j])
+						return
+					}
+				}
+				slab.Release()
+			}
+		}(byte(w))
+	}
+	wg.Wait()
+	if a.Available() != count {
+		t.Fatalf("%d slabs available once all released, want %d", a.Available(), count)
+	}
+}
+
+// The frame copy benchmarks keep a few frames in flight (as a capture pipeline
+// would) and report the GC pause time and collection count per copied frame.
+// TLB misses are best compared with: perf stat -e dTLB-load-misses go test -bench FrameCopy
+
+func BenchmarkFrameCopyHeap(b *testing.B) {
+	src := make([]byte, frameSize)
+	var inflight [4][]byte
+	benchmarkGC(b, func(i int) {
+		dst := make([]byte, frameSize)
+		copy(dst, src)
+		inflight[i%len(inflight)] = dst
+	})
+}
+
+func BenchmarkFrameCopyArena(b *testing.B) {
+	a, err := New(frameSize, 8)
+	if err != nil {
+		b.Fatal(err)
+	}
+	defer a.Close()
+	src := make([]byte, frameSize)
+	var inflight [4]*Slab
+	benchmarkGC(b, func(i int) {
+		slab, err := a.Alloc()
+		if err != nil {
+			b.Fatal(err)
+		}
+		copy(slab.Bytes(), src)
+		if old := inflight[i%len(inflight)]; old != nil {
+			old.Release()
+		}
+		inflight[i%len(inflight)] = slab
+	})
+}
+
+func benchmarkGC(b *testing.B, copyFrame func(i int)) {
+	var before, after runtime.MemStats
+	runtime.GC()
+	runtime.ReadMemStats(&before)
+	b.SetBytes(frameSize)
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		copyFrame(i)
+	}
+	b.StopTimer()
+	runtime.ReadMemStats(&after)
+	b.ReportMetric(float64(after.PauseTotalNs-before.PauseTotalNs)/float64(b.N), "gc-pause-ns/op")
+	b.ReportMetric(float64(after.NumGC-before.NumGC)/float64(b.N), "gcs/op")
+}
@@ -0,0 +1,2 @@
+// Package arena provides an off-heap allocator for large frame buffers.
+package arena
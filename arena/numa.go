@@ -0,0 +1,45 @@
+package arena
+
+import (
+	"fmt"
+	"unsafe"
+
+	sys "golang.org/x/sys/unix"
+)
+
+// memory policy values, see https://elixir.bootlin.com/linux/latest/source/include/uapi/linux/mempolicy.h
+const (
+	mpolBind   = 2
+	mpolMFMove = 1 << 1
+)
+
+// WithNode binds the arena memory to the specified NUMA node (mbind with MPOL_BIND),
+// so that frames are placed on the node local to the capture device. A negative node
+// leaves placement to the kernel.
+func WithNode(node int) Option {
+	return func(o *config) {
+		o.node = node
+		o.bindNode = node >= 0
+	}
+}
+
+// Node returns the NUMA node the arena memory is bound to, or -1
+func (a *Arena) Node() int {
+	return a.node
+}
+
+// bindNode applies the NUMA memory policy on the (not yet touched) mapping
+func bindNode(mem []byte, node int) error {
+	const bitsPerWord = 8 * int(unsafe.Sizeof(uint(0)))
+	mask := make([]uint, node/bitsPerWord+1)
+	mask[node/bitsPerWord] |= 1 << (uint(node) % uint(bitsPerWord))
+	_, _, errno := sys.Syscall6(sys.SYS_MBIND,
+		uintptr(unsafe.Pointer(&mem[0])), uintptr(len(mem)),
+		mpolBind, uintptr(unsafe.Pointer(&mask[0])), uintptr(len(mask)*bitsPerWord+1),
+		mpolMFMove,
+	)
+	if errno != 0 {
+		return fmt.Errorf("mbind node %d: %w", node, errno)
+	}
+	return nil
+}
@@ -0,0 +1,92 @@
+package device
+
+import "sync"
+
+// AttachmentKey identifies an artifact derived from frames (a luma plane, a thumbnail, an
+// encoding, statistics...). Keys are compared by identity: create each key once, with
+// NewAttachmentKey, and share it among the consumers of the artifact.
+type AttachmentKey struct {
+	name string
+}
+
+// NewAttachmentKey returns a new attachment key. The name is only used for display.
+func NewAttachmentKey(name string) *AttachmentKey {
+	return &AttachmentKey{name: name}
+}
+
+func (k *AttachmentKey) String() string {
+	return k.name
+}
+
+// DeriveFunc computes an artifact from a frame
+type DeriveFunc func(*Frame) (interface{}, error)
+
+// attachment is an artifact attached to a frame; done is closed once it is derived
+type attachment struct {
+	key   *AttachmentKey
+	done  chan struct{}
+	value interface{}
+	err   error
+}
+
+// attachments holds the artifacts derived from a frame. Frames carry a handful of
+// artifacts at most, a slice is cheaper than a map.
+type attachments struct {
+	mu    sync.Mutex
+	items []*attachment
+}
+
+// Attachment returns the artifact identified by key, deriving it from the frame on first
+// use. Derivation happens at most once per frame: concurrent callers of the same key wait
+// for the first one and all share its result (and error) by reference, so the artifact
+// must be treated as read-only. Artifacts implementing Release() are released along with
+// the frame, once its last reference is dropped.
+func (f *Frame) Attachment(key *AttachmentKey, derive DeriveFunc) (interface{}, error) {
+	f.attached.mu.Lock()
+	for _, a := range f.attached.items {
+		if a.key == key {
+			f.attached.mu.Unlock()
+			<-a.done
+			return a.value, a.err
+		}
+	}
+	a := &attachment{key: key, done: make(chan struct{})}
+	f.attached.items = append(f.attached.items, a)
+	f.attached.mu.Unlock()
+
+	defer close(a.done)
+	a.value, a.err = derive(f)
+	return a.value, a.err
+}
+
+// Attached returns the artifact identified by key if it was already derived from the frame,
+// without deriving it or waiting for a derivation in progress.
+func (f *Frame) Attached(key *AttachmentKey) (interface{}, bool) {
+	f.attached.mu.Lock()
+	defer f.attached.mu.Unlock()
+	for _, a := range f.attached.items {
+		if a.key != key {
+			continue
+		}
+		select {
+		case <-a.done:
+			return a.value, a.err == nil
+		default:
+			return nil, false
+		}
+	}
+	return nil, false
+}
+
+// release releases the artifacts attached to an unreferenced frame
+func (at *attachments) release() {
+	at.mu.Lock()
+	items := at.items
+	at.items = nil
+	at.mu.Unlock()
+	for _, a := range items {
+		if r, ok := a.value.(interface{ Release() }); ok && a.err == nil {
+			r.Release()
+		}
+	}
+}
@@ -0,0 +1,62 @@
+package device
+
+import (
+	"sync"
+	"sync/atomic"
+	"testing"
+)
+
+type thumbnail struct {
+	released int32
+}
+
+func (t *thumbnail) Release() {
+	atomic.AddInt32(&t.released, 1)
+}
+
+func TestFrameAttachment(t *testing.T) {
+	key := NewAttachmentKey("thumbnail")
+	frame := &Frame{Data: make([]byte, 64), refs: 1}
+
+	var derived int32
+	derive := func(*Frame) (interface{}, error) {
+		atomic.AddInt32(&derived, 1)
+		return &thumbnail{}, nil
+	}
+
+	// concurrent consumers derive the artifact once and share it
+	results := make([]interface{}, 8)
+	var wg sync.WaitGroup
+	for i := range results {
+		frame.Retain()
+		wg.Add(1)
+		go func(i int) {
+			defer wg.Done()
+			defer frame.Release()
+			results[i], _ = frame.Attachment(key, derive)
+		}(i)
+	}
+	wg.Wait()
+
+	if derived != 1 {
+		t.Fatalf("artifact derived %d times", derived)
+	}
+	for _, r := range results {
+		if r != results[0] {
+			t.Fatal("artifact not shared")
+		}
+	}
+	if v, ok := frame.Attached(key); !ok || v != results[0] {
+		t.Fatal("artifact not attached")
+	}
+
+	// the artifact goes away with the last frame reference
+	thumb := results[0].(*thumbnail)
+	if thumb.released != 0 {
+		t.Fatal("artifact released while the frame is referenced")
+	}
+	frame.Release()
+	if thumb.released != 1 {
+		t.Fatalf("artifact released %d times", thumb.released)
+	}
+}
@@ -0,0 +1,277 @@
+package device
+
+import (
+	"fmt"
+	"image"
+	"sync"
+
+	"github.com/vladimirvivien/go4vl/imgsupport"
+	"github.com/vladimirvivien/go4vl/v4l2"
+)
+
+// AutofocusConfig tunes an Autofocus run. Zero values select the defaults.
+type AutofocusConfig struct {
+	// ROI is the region of the frame scored (the centered half of the frame by default)
+	ROI image.Rectangle
+
+	// Step is the initial focus step (an eighth of the focus range by default), MinStep the
+	// step below which the search stops (a 64th of the range, or the control step if larger,
+	// by default: finer steps cost frames for differences within the depth of field)
+	Step    int32
+	MinStep int32
+
+	// Settle is the number of frames skipped after each lens move, while the lens settles
+	// and frames exposed during the move are drained (1 by default)
+	Settle int
+
+	// MaxMoves bounds the number of lens moves of a run (32 by default)
+	MaxMoves int
+
+	// Score returns the sharpness of a frame (by default, an imgsupport sharpness metric
+	// on ROI for YUYV, GREY and MJPEG frames)
+	Score func(*Frame) (uint64, error)
+}
+
+// Autofocus is a contrast detection autofocus run: it moves the lens (control
+// v4l2.CtrlCameraFocusAbsolute) through the asynchronous control queue of the device,
+// scores the sharpness of the frames captured at each position, and hill-climbs to the
+// sharpest position, halving the step each time the peak is overshot in both directions.
+//
+// An Autofocus is driven by the frames fed to it (see Feed), so it never waits on
+// the driver: while the lens moves, frames are simply not scored.
+type Autofocus struct {
+	config   AutofocusConfig
+	min, max int32
+	set      func(int32) *ControlFuture
+
+	mu       sync.Mutex
+	scores   map[int32]uint64 // scores of the positions measured
+	pos      int32            // lens position (being) set
+	pending  *ControlFuture   // lens move in progress
+	skip     int              // frames left to skip before scoring
+	best     int32
+	measured bool // best is set
+	dir      int32
+	step     int32
+	fails    int // moves in a row that did not improve the score
+	moves    int
+	parking  bool // moving to the best position, the search is over
+	err      error
+	done     chan struct{}
+}
+
+// NewAutofocus starts an autofocus run from the current lens position. It turns off the
+// continuous autofocus of the camera, if any.
+func (d *Device) NewAutofocus(config AutofocusConfig) (*Autofocus, error) {
+	ctrl, err := v4l2.GetControl(d.fd, v4l2.CtrlCameraFocusAbsolute)
+	if err != nil {
+		return nil, fmt.Errorf("device: autofocus: %w", err)
+	}
+	if config.MinStep <= 0 && ctrl.Step > (ctrl.Maximum-ctrl.Minimum)/64 {
+		config.MinStep = ctrl.Step
+	}
+	if config.Score == nil {
+		if config.Score, err = d.defaultFocusScore(&config.ROI); err != nil {
+			return nil, err
+		}
+	}
+
+	queue := d.ControlQueue()
+	queue.Set(v4l2.CtrlCameraFocusAuto, 0) // not all cameras have it: ignore the result
+	return newAutofocus(config, ctrl.Minimum, ctrl.Maximum, ctrl.Value, func(pos int32) *ControlFuture {
+		return queue.Set(v4l2.CtrlCameraFocusAbsolute, pos)
+	}), nil
+}
+
+// defaultFocusScore returns the sharpness metric for the device pixel format, on roi
+// (set to the centered half of the frame if empty)
+func (d *Device) defaultFocusScore(roi *image.Rectangle) (func(*Frame) (uint64, error), error) {
+	pixFmt := d.config.pixFormat
+	width, height := int(pixFmt.Width), int(pixFmt.Height)
+	if roi.Empty() {
+		*roi = image.Rect(width/4, height/4, width*3/4, height*3/4)
+	}
+	r := *roi
+	stride := int(pixFmt.BytesPerLine)
+	switch pixFmt.PixelFormat {
+	case v4l2.PixelFmtYUYV:
+		return func(f *Frame) (uint64, error) { return imgsupport.SharpnessYUYV(f.Data, width, r) }, nil
+	case v4l2.PixelFmtMJPEG, v4l2.PixelFmtJPEG:
+		return func(f *Frame) (uint64, error) { return imgsupport.SharpnessMJPEG(f.Data, r) }, nil
+	case v4l2.PixelFmtGrey:
+		if stride == 0 {
+			stride = width
+		}
+		return func(f *Frame) (uint64, error) { return imgsupport.SharpnessLuma(f.Data, stride, r) }, nil
+	}
+	return nil, fmt.Errorf("device: autofocus: no sharpness metric for format %s: %w", v4l2.PixelFormats[pixFmt.PixelFormat], v4l2.ErrorUnsupportedFeature)
+}
+
+func newAutofocus(config AutofocusConfig, min, max, start int32, set func(int32) *ControlFuture) *Autofocus {
+	if config.Step <= 0 {
+		config.Step = (max - min) / 8
+	}
+	if config.MinStep <= 0 {
+		config.MinStep = (max - min) / 64
+	}
+	if config.MinStep <= 0 {
+		config.MinStep = 1
+	}
+	if config.Step < config.MinStep {
+		config.Step = config.MinStep
+	}
+	if config.Settle <= 0 {
+		config.Settle = 1
+	}
+	if config.MaxMoves <= 0 {
+		config.MaxMoves = 32
+	}
+	return &Autofocus{
+		config: config,
+		min:    min,
+		max:    max,
+		set:    set,
+		scores: make(map[int32]uint64),
+		pos:    start,
+		dir:    1,
+		step:   config.Step,
+		done:   make(chan struct{}),
+	}
+}
+
+// Feed hands a captured frame to the autofocus run, and reports whether the run is over.
+// Feed returns quickly: it scores the frame when the lens is in position, and queues the
+// next lens move. It must be called from a single goroutine (i.e. a frame consumer).
+func (a *Autofocus) Feed(f *Frame) bool {
+	a.mu.Lock()
+	defer a.mu.Unlock()
+	if a.isDone() {
+		return true
+	}
+
+	if a.pending != nil {
+		select {
+		case <-a.pending.Done():
+		default:
+			return false // the lens is moving
+		}
+		err := a.pending.Wait()
+		a.pending = nil
+		if err != nil {
+			a.finish(fmt.Errorf("device: autofocus: %w", err))
+			return true
+		}
+		if a.parking {
+			a.finish(nil)
+			return true
+		}
+		a.skip = a.config.Settle
+	}
+	if a.skip > 0 {
+		a.skip--
+		return false
+	}
+
+	score, err := a.config.Score(f)
+	if err != nil {
+		a.finish(fmt.Errorf("device: autofocus: %w", err))
+		return true
+	}
+	a.scores[a.pos] = score
+	a.consider(a.pos, score)
+
+	for {
+		next, ok := a.next()
+		if !ok {
+			// converged (or out of moves): park the lens at the best position
+			if a.pos == a.best {
+				a.finish(nil)
+				return true
+			}
+			a.parking = true
+			a.move(a.best)
+			return false
+		}
+		if score, known := a.scores[next]; known {
+			a.consider(next, score)
+			continue
+		}
+		a.move(next)
+		return false
+	}
+}
+
+// consider updates the search with the score of position pos
+func (a *Autofocus) consider(pos int32, score uint64) {
+	switch {
+	case !a.measured:
+		a.best, a.measured = pos, true
+	case score > a.scores[a.best]:
+		a.best, a.fails = pos, 0
+	default:
+		a.fail()
+	}
+}
+
+// fail turns the search around, and refines the step once both directions failed
+func (a *Autofocus) fail() {
+	a.dir = -a.dir
+	a.fails++
+	if a.fails == 2 {
+		a.step /= 2
+		a.fails = 0
+	}
+}
+
+// next returns the next position to measure, or false when the search is over
+func (a *Autofocus) next() (int32, bool) {
+	for a.step >= a.config.MinStep && a.moves < a.config.MaxMoves {
+		next := a.best + a.dir*a.step
+		if next < a.min {
+			next = a.min
+		}
+		if next > a.max {
+			next = a.max
+		}
+		if next != a.best {
+			return next, true
+		}
+		a.fail() // at the end of the range
+	}
+	return 0, false
+}
+
+func (a *Autofocus) move(pos int32) {
+	a.pos = pos
+	a.moves++
+	a.pending = a.set(pos)
+}
+
+func (a *Autofocus) finish(err error) {
+	a.err = err
+	close(a.done)
+}
+
+func (a *Autofocus) isDone() bool {
+	select {
+	case <-a.done:
+		return true
+	default:
+		return false
+	}
+}
+
+// Done returns a channel closed once the run is over
+func (a *Autofocus) Done() <-chan struct{} {
+	return a.done
+}
+
+// Result returns the sharpest lens position found so far, and the error that ended the run, if any
+func (a *Autofocus) Result() (int32, error) {
+	a.mu.Lock()
+	defer a.mu.Unlock()
+	if !a.measured {
+		return a.pos, a.err
+	}
+	return a.best, a.err
+}
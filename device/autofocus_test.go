@@ -0,0 +1,38 @@
+package device
+
+import "testing"
+
+func TestAutofocusConverges(t *testing.T) {
+	const peak = 537
+	var lens int32 = 100
+	set := func(pos int32) *ControlFuture {
+		lens = pos
+		f := &ControlFuture{done: make(chan struct{})}
+		close(f.done)
+		return f
+	}
+	score := func(*Frame) (uint64, error) {
+		d := int64(lens - peak)
+		return uint64(1<<40 - d*d), nil
+	}
+
+	af := newAutofocus(AutofocusConfig{Score: score}, 0, 1000, lens, set)
+	frames := 0
+	for !af.Feed(&Frame{}) {
+		frames++
+		if frames > 1000 {
+			t.Fatal("autofocus does not converge")
+		}
+	}
+	pos, err := af.Result()
+	if err != nil {
+		t.Fatal(err)
+	}
+	// within the default minimum step (a 64th of the range)
+	if pos < peak-15 || pos > peak+15 || lens != pos {
+		t.Fatalf("focused at %d (lens at %d), expected %d", pos, lens, peak)
+	}
+	if af.moves > 12 {
+		t.Fatalf("%d lens moves", af.moves)
+	}
+}
@@ -0,0 +1,427 @@
+package device
+
+import (
+	"fmt"
+	"math"
+	"os"
+	"path/filepath"
+	"regexp"
+	"sort"
+	"strconv"
+	"strings"
+	sys "syscall"
+
+	"github.com/vladimirvivien/go4vl/v4l2"
+)
+
+// USB isochronous bandwidth (bytes per second) available for periodic transfers on a bus,
+// and to a single endpoint, by link speed (Mbps). High speed reserves 80% of each
+// microframe for periodic transfers and at most 3 x 1024 bytes per microframe per endpoint;
+// full and super speed reserve 90% of the bus.
+var usbBandwidth = map[int]struct{ bus, endpoint float64 }{
+	12:    {bus: 1350e3, endpoint: 1023e3},
+	480:   {bus: 48e6, endpoint: 24.576e6},
+	5000:  {bus: 450e6, endpoint: 393.216e6},
+	10000: {bus: 900e6, endpoint: 393.216e6},
+}
+
+// usbLimits returns the bandwidth of the fastest listed speed not above speed (Mbps), so
+// that a speed missing from usbBandwidth is never credited more than it carries: unknown
+// speeds (0, the sysfs speed could not be read) get the bandwidth of full speed.
+func usbLimits(speed int) (bus, endpoint float64) {
+	fit := 12
+	for s := range usbBandwidth {
+		if s <= speed && s > fit {
+			fit = s
+		}
+	}
+	limits := usbBandwidth[fit]
+	return limits.bus, limits.endpoint
+}
+
+// uncompressedBytesPerPixel is the frame size of uncompressed formats, per pixel
+var uncompressedBytesPerPixel = map[v4l2.FourCCType]float64{
+	v4l2.PixelFmtGrey:  1,
+	v4l2.PixelFmtYUYV:  2,
+	v4l2.PixelFmtYYUV:  2,
+	v4l2.PixelFmtYVYU:  2,
+	v4l2.PixelFmtUYVY:  2,
+	v4l2.PixelFmtVYUY:  2,
+	v4l2.PixelFmtRGB24: 3,
+}
+
+// compressed formats the planner can estimate
+var compressedFormats = map[v4l2.FourCCType]bool{
+	v4l2.PixelFmtMJPEG: true,
+	v4l2.PixelFmtJPEG:  true,
+	v4l2.PixelFmtH264:  true,
+}
+
+var usbRootHubPattern = regexp.MustCompile(`^usb[0-9]+$`)
+
+// BandwidthConfig sets the constraints of a BandwidthPlanner. Zero values select the defaults.
+type BandwidthConfig struct {
+	// MinFPS and MaxFPS bound the frame rates considered (at least 10 fps by default)
+	MinFPS uint32
+	MaxFPS uint32
+
+	// MaxWidth bounds the frame sizes considered (no bound by default)
+	MaxWidth uint32
+
+	// CompressedBytesPerPixel estimates the size of compressed (MJPEG, H.264) frames
+	// (0.3 bytes per pixel by default, a conservative figure for MJPEG)
+	CompressedBytesPerPixel float64
+
+	// CompressedQuality weighs compressed modes against uncompressed ones of the same size
+	// and rate, when ranking modes by quality (0.8 by default)
+	CompressedQuality float64
+
+	// Headroom is the share of the bus bandwidth the plan may use (0.9 by default), which
+	// leaves room for other devices (keyboards, audio)
+	Headroom float64
+
+	// Profiles, when set, is used to enumerate the modes of known devices without probing them
+	Profiles *ProfileCache
+}
+
+// CaptureMode is a format, frame size and frame rate a device can capture with
+type CaptureMode struct {
+	PixelFormat v4l2.FourCCType
+	Width       uint32
+	Height      uint32
+	FPS         uint32
+}
+
+// Bandwidth returns the estimated bus bandwidth of the mode, in bytes per second
+func (m CaptureMode) Bandwidth(config BandwidthConfig) float64 {
+	bpp, ok := uncompressedBytesPerPixel[m.PixelFormat]
+	if !ok {
+		bpp = config.CompressedBytesPerPixel
+	}
+	return float64(m.Width) * float64(m.Height) * bpp * float64(m.FPS)
+}
+
+// Quality ranks modes: the pixel rate, discounted for compressed formats
+func (m CaptureMode) Quality(config BandwidthConfig) float64 {
+	q := float64(m.Width) * float64(m.Height) * float64(m.FPS)
+	if compressedFormats[m.PixelFormat] {
+		q *= config.CompressedQuality
+	}
+	return q
+}
+
+// Options returns the device options that select the mode (see Open)
+func (m CaptureMode) Options() []Option {
+	return []Option{
+		WithPixFormat(v4l2.PixFormat{PixelFormat: m.PixelFormat, Width: m.Width, Height: m.Height, Field: v4l2.FieldAny}),
+		WithFPS(m.FPS),
+	}
+}
+
+func (m CaptureMode) String() string {
+	return fmt.Sprintf("%s %dx%d@%d", v4l2.PixelFormats[m.PixelFormat], m.Width, m.Height, m.FPS)
+}
+
+// plannedDevice is a device added to a planner with the modes it can use
+type plannedDevice struct {
+	path     string
+	bus      string // USB bus (root hub), empty when not on USB
+	busSpeed int    // bus speed in Mbps
+	speed    int    // device link speed in Mbps
+	modes    []CaptureMode
+}
+
+// BandwidthPlanner picks a capture mode for each of a set of devices, so that the cameras
+// sharing a USB bus fit its isochronous bandwidth together, at the best aggregate quality.
+// Without a plan, each device picks its mode alone and STREAMON fails with ENOSPC (or
+// frames get dropped) once the bus is oversubscribed.
+type BandwidthPlanner struct {
+	config  BandwidthConfig
+	devices []*plannedDevice
+}
+
+// NewBandwidthPlanner returns an empty planner
+func NewBandwidthPlanner(config BandwidthConfig) *BandwidthPlanner {
+	if config.MinFPS == 0 {
+		config.MinFPS = 10
+	}
+	if config.CompressedBytesPerPixel <= 0 {
+		config.CompressedBytesPerPixel = 0.3
+	}
+	if config.CompressedQuality <= 0 {
+		config.CompressedQuality = 0.8
+	}
+	if config.Headroom <= 0 || config.Headroom > 1 {
+		config.Headroom = 0.9
+	}
+	return &BandwidthPlanner{config: config}
+}
+
+// Add enumerates the modes of the device at path (from the profile cache when possible)
+// and locates its USB bus
+func (p *BandwidthPlanner) Add(path string) error {
+	fd, err := v4l2.OpenDevice(path, sys.O_RDWR|sys.O_NONBLOCK, 0)
+	if err != nil {
+		return fmt.Errorf("bandwidth planner: %w", err)
+	}
+	defer v4l2.CloseDevice(fd)
+
+	cap, err := v4l2.GetCapability(fd)
+	if err != nil {
+		return fmt.Errorf("bandwidth planner: %s: %w", path, err)
+	}
+	var profile *Profile
+	if p.config.Profiles != nil {
+		profile, _ = p.config.Profiles.Load(cap)
+	}
+	if profile == nil {
+		if profile, err = probeProfile(fd, cap, v4l2.BufTypeVideoCapture); err != nil {
+			return fmt.Errorf("bandwidth planner: %s: %w", path, err)
+		}
+		if p.config.Profiles != nil {
+			p.config.Profiles.Save(profile)
+		}
+	}
+
+	bus, busSpeed, speed := usbBusOf(path)
+	p.addDevice(&plannedDevice{path: path, bus: bus, busSpeed: busSpeed, speed: speed}, profile)
+	return nil
+}
+
+func (p *BandwidthPlanner) addDevice(dev *plannedDevice, profile *Profile) {
+	for _, format := range profile.Formats {
+		_, raw := uncompressedBytesPerPixel[format.PixelFormat]
+		if !raw && !compressedFormats[format.PixelFormat] {
+			continue
+		}
+		for _, size := range format.Sizes {
+			width, height := size.Size.MaxWidth, size.Size.MaxHeight
+			if p.config.MaxWidth > 0 && width > p.config.MaxWidth {
+				continue
+			}
+			for _, interval := range size.Intervals {
+				// intervals are frame durations: the shortest one is the highest rate
+				fps := fractFPS(interval.Interval.Min)
+				if interval.Type != v4l2.FrameIntervalTypeDiscrete && p.config.MaxFPS > 0 && fps > p.config.MaxFPS {
+					fps = p.config.MaxFPS
+				}
+				if fps < p.config.MinFPS || (p.config.MaxFPS > 0 && fps > p.config.MaxFPS) {
+					continue
+				}
+				dev.modes = append(dev.modes, CaptureMode{PixelFormat: format.PixelFormat, Width: width, Height: height, FPS: fps})
+			}
+		}
+	}
+	p.devices = append(p.devices, dev)
+}
+
+func fractFPS(f v4l2.Fract) uint32 {
+	if f.Numerator == 0 {
+		return 0
+	}
+	return (f.Denominator + f.Numerator/2) / f.Numerator
+}
+
+// usbBusOf returns the USB bus (root hub) the video device at path is attached to, with
+// the speed of the bus and of the device link (Mbps), from sysfs. The bus is empty for
+// devices not on USB. The two ports of a USB 3 controller are distinct buses (root hubs).
+func usbBusOf(path string) (bus string, busSpeed, speed int) {
+	dir, err := filepath.EvalSymlinks(filepath.Join(sysfsRoot, "class/video4linux", filepath.Base(path), "device"))
+	if err != nil {
+		return "", 0, 0
+	}
+	for ; dir != sysfsRoot && dir != "/" && dir != "."; dir = filepath.Dir(dir) {
+		if speed == 0 {
+			speed = readUSBSpeed(dir)
+		}
+		if usbRootHubPattern.MatchString(filepath.Base(dir)) {
+			return filepath.Base(dir), readUSBSpeed(dir), speed
+		}
+	}
+	return "", 0, 0
+}
+
+func readUSBSpeed(dir string) int {
+	data, err := os.ReadFile(filepath.Join(dir, "speed"))
+	if err != nil {
+		return 0
+	}
+	// "1.5" (low speed) parses as 0 and is ignored, cameras are not low speed devices
+	speed, _ := strconv.Atoi(strings.TrimSpace(string(data)))
+	return speed
+}
+
+// BusUsage reports the planned use of a USB bus
+type BusUsage struct {
+	Bus      string
+	Devices  []string
+	Capacity float64 // bytes per second available to the plan
+	Used     float64 // bytes per second used by the plan
+}
+
+// BandwidthPlan holds the mode picked for each device of a planner
+type BandwidthPlan struct {
+	Modes map[string]CaptureMode
+	Buses []BusUsage
+}
+
+// Open opens the device at path with its planned mode (and any other options)
+func (p *BandwidthPlan) Open(path string, options ...Option) (*Device, error) {
+	mode, ok := p.Modes[path]
+	if !ok {
+		return nil, fmt.Errorf("bandwidth plan: %s: device not planned", path)
+	}
+	return Open(path, append(options, mode.Options()...)...)
+}
+
+// Plan picks a mode for each device: the best one its link carries for devices not on
+// USB, and for the devices sharing a USB bus, the modes of best aggregate quality that fit
+// the bus bandwidth. It fails when even the lowest modes of the devices of a bus do not fit.
+func (p *BandwidthPlanner) Plan() (*BandwidthPlan, error) {
+	plan := &BandwidthPlan{Modes: make(map[string]CaptureMode)}
+
+	buses := make(map[string][]*plannedDevice)
+	var names []string
+	for _, dev := range p.devices {
+		if len(dev.modes) == 0 {
+			return nil, fmt.Errorf("bandwidth plan: %s: no usable mode", dev.path)
+		}
+		if _, ok := buses[dev.bus]; !ok {
+			names = append(names, dev.bus)
+		}
+		buses[dev.bus] = append(buses[dev.bus], dev)
+	}
+	sort.Strings(names)
+
+	for _, bus := range names {
+		devs := buses[bus]
+		capacity := 0.0
+		if bus != "" {
+			busCapacity, _ := usbLimits(devs[0].busSpeed)
+			capacity = busCapacity * p.config.Headroom
+		}
+		candidates := make([][]CaptureMode, len(devs))
+		for i, dev := range devs {
+			candidates[i] = p.frontier(dev)
+			if len(candidates[i]) == 0 {
+				return nil, fmt.Errorf("bandwidth plan: %s: no mode fits the link", dev.path)
+			}
+		}
+		picks, used, err := p.planBus(candidates, capacity)
+		if err != nil {
+			return nil, fmt.Errorf("bandwidth plan: bus %s: %w", bus, err)
+		}
+		usage := BusUsage{Bus: bus, Capacity: capacity, Used: used}
+		for i, dev := range devs {
+			plan.Modes[dev.path] = candidates[i][picks[i]]
+			usage.Devices = append(usage.Devices, dev.path)
+		}
+		if bus != "" {
+			plan.Buses = append(plan.Buses, usage)
+		}
+	}
+	return plan, nil
+}
+
+// frontier returns the modes of dev worth considering, best first: those fitting its link,
+// each with less bandwidth than the previous one (a mode needing more bandwidth than a
+// better one is never picked)
+func (p *BandwidthPlanner) frontier(dev *plannedDevice) []CaptureMode {
+	modes := make([]CaptureMode, 0, len(dev.modes))
+	for _, m := range dev.modes {
+		if dev.bus != "" {
+			if _, endpoint := usbLimits(dev.speed); m.Bandwidth(p.config) > endpoint {
+				continue
+			}
+		}
+		modes = append(modes, m)
+	}
+	sort.SliceStable(modes, func(i, j int) bool {
+		qi, qj := modes[i].Quality(p.config), modes[j].Quality(p.config)
+		if qi != qj {
+			return qi > qj
+		}
+		return modes[i].Bandwidth(p.config) < modes[j].Bandwidth(p.config)
+	})
+	frontier := modes[:0]
+	for _, m := range modes {
+		if len(frontier) == 0 || m.Bandwidth(p.config) < frontier[len(frontier)-1].Bandwidth(p.config) {
+			frontier = append(frontier, m)
+		}
+	}
+	return frontier
+}
+
+// planBusUnits is the resolution of planBus: bandwidths are counted in 1/planBusUnits
+// of the bus capacity (rounded up, so that the plan never oversubscribes the bus)
+const planBusUnits = 1000
+
+// planBus picks a mode (index) for each device sharing a bus of the specified capacity
+// (0 for no limit), maximizing the sum of the mode qualities: a multiple-choice knapsack,
+// solved exactly by dynamic programming over the bus capacity.
+func (p *BandwidthPlanner) planBus(candidates [][]CaptureMode, capacity float64) ([]int, float64, error) {
+	picks := make([]int, len(candidates))
+	if capacity <= 0 {
+		used := 0.0
+		for _, modes := range candidates {
+			used += modes[0].Bandwidth(p.config)
+		}
+		return picks, used, nil
+	}
+
+	type choice struct{ mode, from int32 }
+	best := make([]float64, planBusUnits+1) // best quality for each bandwidth used, -1 if unreachable
+	next := make([]float64, planBusUnits+1)
+	choices := make([][]choice, len(candidates))
+	for b := range best {
+		best[b] = -1
+	}
+	best[0] = 0
+
+	for i, modes := range candidates {
+		choices[i] = make([]choice, planBusUnits+1)
+		for b := range next {
+			next[b] = -1
+		}
+		for b, q := range best {
+			if q < 0 {
+				continue
+			}
+			for k, m := range modes {
+				units := int(math.Ceil(m.Bandwidth(p.config) / capacity * planBusUnits))
+				nb := b + units
+				if nb > planBusUnits {
+					continue
+				}
+				if nq := q + m.Quality(p.config); nq > next[nb] {
+					next[nb] = nq
+					choices[i][nb] = choice{mode: int32(k), from: int32(b)}
+				}
+			}
+		}
+		best, next = next, best
+	}
+
+	end := -1
+	for b, q := range best {
+		if q >= 0 && (end < 0 || q > best[end]) {
+			end = b
+		}
+	}
+	if end < 0 {
+		needed := 0.0
+		for _, modes := range candidates {
+			needed += modes[len(modes)-1].Bandwidth(p.config)
+		}
+		return nil, 0, fmt.Errorf("%.1f MB/s needed at least, %.1f MB/s available", needed/1e6, capacity/1e6)
+	}
+
+	used := 0.0
+	for i := len(candidates) - 1; i >= 0; i-- {
+		c := choices[i][end]
+		picks[i] = int(c.mode)
+		used += candidates[i][c.mode].Bandwidth(p.config)
+		end = int(c.from)
+	}
+	return picks, used, nil
+}
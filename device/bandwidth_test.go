@@ -0,0 +1,104 @@
+package device
+
+import (
+	"fmt"
+	"testing"
+
+	"github.com/vladimirvivien/go4vl/v4l2"
+)
+
+// testCameraProfile returns the profile of a typical UVC camera: YUYV and MJPEG at 720p and 480p, 30 fps
+func testCameraProfile() *Profile {
+	interval := []v4l2.FrameIntervalEnum{{Type: v4l2.FrameIntervalTypeDiscrete, Interval: v4l2.FrameInterval{Min: v4l2.Fract{Numerator: 1, Denominator: 30}}}}
+	size := func(w, h uint32) SizeProfile {
+		return SizeProfile{
+			FrameSizeEnum: v4l2.FrameSizeEnum{Size: v4l2.FrameSize{MinWidth: w, MaxWidth: w, MinHeight: h, MaxHeight: h}},
+			Intervals:     interval,
+		}
+	}
+	sizes := []SizeProfile{size(1280, 720), size(640, 480), size(320, 240)}
+	return &Profile{Formats: []FormatProfile{
+		{FormatDescription: v4l2.FormatDescription{PixelFormat: v4l2.PixelFmtYUYV}, Sizes: sizes},
+		{FormatDescription: v4l2.FormatDescription{PixelFormat: v4l2.PixelFmtMJPEG}, Sizes: sizes},
+	}}
+}
+
+func TestBandwidthPlan(t *testing.T) {
+	planner := NewBandwidthPlanner(BandwidthConfig{})
+	for i := 0; i < 6; i++ {
+		planner.addDevice(&plannedDevice{path: fmt.Sprintf("/dev/video%d", i), bus: "usb1", busSpeed: 480, speed: 480}, testCameraProfile())
+	}
+	planner.addDevice(&plannedDevice{path: "/dev/video9", bus: "usb3", busSpeed: 480, speed: 480}, testCameraProfile())
+
+	plan, err := planner.Plan()
+	if err != nil {
+		t.Fatal(err)
+	}
+	hd, low := 0, 0
+	for i := 0; i < 6; i++ {
+		switch mode := plan.Modes[fmt.Sprintf("/dev/video%d", i)]; {
+		case mode.PixelFormat == v4l2.PixelFmtMJPEG && mode.Width == 1280:
+			hd++
+		case mode.PixelFormat == v4l2.PixelFmtMJPEG && mode.Width == 320:
+			low++
+		default:
+			t.Fatalf("unexpected mode %s", mode)
+		}
+	}
+	// six 720p MJPEG streams (8.3 MB/s each) do not fit the 43.2 MB/s of the bus: the best
+	// fit is five of them and a 320x240 one (not four and two 640x480 ones)
+	if hd != 5 || low != 1 {
+		t.Fatalf("%d cameras at 720p, %d at 240p", hd, low)
+	}
+	for _, bus := range plan.Buses {
+		if bus.Used > bus.Capacity {
+			t.Fatalf("bus %s oversubscribed: %+v", bus.Bus, bus)
+		}
+	}
+	// alone on its bus, a camera gets the best mode its link carries
+	if mode := plan.Modes["/dev/video9"]; mode.PixelFormat != v4l2.PixelFmtMJPEG || mode.Width != 1280 {
+		t.Fatalf("unexpected mode %s", mode)
+	}
+
+	// even at 320x240 MJPEG (0.69 MB/s), 70 cameras do not fit
+	for i := 6; i < 70; i++ {
+		planner.addDevice(&plannedDevice{path: fmt.Sprintf("/dev/video%d", 10+i), bus: "usb1", busSpeed: 480, speed: 480}, testCameraProfile())
+	}
+	if _, err := planner.Plan(); err == nil {
+		t.Fatal("oversubscribed bus planned")
+	}
+}
+
+func TestBandwidthPlanUnlistedSpeed(t *testing.T) {
+	// a speed missing from the table gets the bandwidth of the next slower speed, an
+	// unknown one the bandwidth of full speed (never an unlimited bus)
+	planner := NewBandwidthPlanner(BandwidthConfig{})
+	planner.addDevice(&plannedDevice{path: "/dev/video0", bus: "usb1", busSpeed: 20000, speed: 20000}, testCameraProfile())
+	planner.addDevice(&plannedDevice{path: "/dev/video1", bus: "usb2", speed: 480}, testCameraProfile())
+	plan, err := planner.Plan()
+	if err != nil {
+		t.Fatal(err)
+	}
+	capacity := map[string]float64{}
+	for _, bus := range plan.Buses {
+		capacity[bus.Bus] = bus.Capacity
+		if bus.Used > bus.Capacity {
+			t.Fatalf("bus %s oversubscribed: %+v", bus.Bus, bus)
+		}
+	}
+	if want := usbBandwidth[10000].bus * 0.9; capacity["usb1"] != want {
+		t.Fatalf("20 Gbps bus capacity %.0f, want %.0f", capacity["usb1"], want)
+	}
+	if want := usbBandwidth[12].bus * 0.9; capacity["usb2"] != want {
+		t.Fatalf("unknown speed bus capacity %.0f, want %.0f", capacity["usb2"], want)
+	}
+	if mode := plan.Modes["/dev/video1"]; mode.Width != 320 {
+		t.Fatalf("unexpected mode %s on a bus of unknown speed", mode)
+	}
+
+	// two cameras do not fit a bus of unknown speed
+	planner.addDevice(&plannedDevice{path: "/dev/video2", bus: "usb2", speed: 480}, testCameraProfile())
+	if _, err := planner.Plan(); err == nil {
+		t.Fatal("bus of unknown speed planned as unlimited")
+	}
+}
@@ -0,0 +1,227 @@
+package device
+
+import (
+	"sync"
+
+	"github.com/vladimirvivien/go4vl/v4l2"
+)
+
+// BitrateConfig sets the bounds within which a BitrateController adapts an encoder
+type BitrateConfig struct {
+	// MinBitrate, MaxBitrate and StartBitrate are in bits per second
+	MinBitrate   int32
+	MaxBitrate   int32
+	StartBitrate int32
+
+	// MinQP and MaxQP bound the H.264 quantizer (0 leaves the encoder bounds as is)
+	MinQP int32
+	MaxQP int32
+
+	// GOPSize is the key frame interval (in frames) used when the network is clean;
+	// it is halved while losses are reported, so that decoders recover sooner.
+	GOPSize int32
+}
+
+// bitrate adaptation parameters: losses above lossHigh reduce the rate, losses
+// below lossLow let it grow by rateIncrease per update. A single update never changes
+// the rate by more than maxStep, so quality changes stay gradual.
+const (
+	lossLow      = 0.02
+	lossHigh     = 0.10
+	rateIncrease = 0.08
+	maxStep      = 0.15
+	headroom     = 0.85 // share of the measured throughput the rate may use
+)
+
+type clientFeedback struct {
+	throughput float64 // smoothed, in bits per second
+	loss       float64 // smoothed loss fraction
+}
+
+// BitrateController adapts the bitrate, quantizer bounds and GOP size of an encoder to
+// the network feedback of its clients. Feedback is collected continuously (see Report),
+// and the resulting settings are applied with a single batch of codec controls at key
+// frames (see FrameDone), so that the encoder changes settings at most once per GOP.
+type BitrateController struct {
+	config BitrateConfig
+	apply  func([]v4l2.Control) error
+
+	mu      sync.Mutex
+	clients map[string]*clientFeedback
+	rate    float64
+	gop     int32
+	applied []v4l2.Control
+	frames  int32 // frames since the last key frame
+	flagged bool  // the encoder flags key frames
+}
+
+// NewBitrateController returns a controller adapting the encoder of device dev
+func NewBitrateController(dev *Device, config BitrateConfig) *BitrateController {
+	return newBitrateController(config, func(ctrls []v4l2.Control) error {
+		return dev.SetExtControlValues(v4l2.CtrlClassCodec, ctrls)
+	})
+}
+
+func newBitrateController(config BitrateConfig, apply func([]v4l2.Control) error) *BitrateController {
+	if config.StartBitrate == 0 {
+		config.StartBitrate = config.MaxBitrate
+	}
+	return &BitrateController{
+		config:  config,
+		apply:   apply,
+		clients: make(map[string]*clientFeedback),
+		rate:    float64(config.StartBitrate),
+		gop:     config.GOPSize,
+	}
+}
+
+// Report records the feedback of a client: the throughput (bits per second) it received
+// over the last interval, and the fraction of packets it lost (i.e. from RTCP receiver
+// reports, or credits/acks).
+func (c *BitrateController) Report(client string, throughput int64, loss float64) {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	fb, ok := c.clients[client]
+	if !ok {
+		c.clients[client] = &clientFeedback{throughput: float64(throughput), loss: loss}
+		return
+	}
+	fb.throughput += (float64(throughput) - fb.throughput) / 4
+	fb.loss += (loss - fb.loss) / 4
+}
+
+// Forget removes the feedback of a disconnected client
+func (c *BitrateController) Forget(client string) {
+	c.mu.Lock()
+	delete(c.clients, client)
+	c.mu.Unlock()
+}
+
+// Bitrate returns the bitrate currently targeted (bits per second)
+func (c *BitrateController) Bitrate() int32 {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	return int32(c.rate)
+}
+
+// FrameDone must be called for each encoded frame with its buffer flags. At key frames
+// (or every GOP size frames when the encoder does not flag key frames), the controller
+// updates its target from the feedback collected during the GOP and applies the controls
+// that changed.
+func (c *BitrateController) FrameDone(flags v4l2.BufFlag) error {
+	c.mu.Lock()
+	c.frames++
+	if flags&v4l2.BufFlagKeyFrame != 0 {
+		c.flagged = true
+	}
+	boundary := flags&v4l2.BufFlagKeyFrame != 0 || (!c.flagged && c.gop > 0 && c.frames >= c.gop)
+	if !boundary {
+		c.mu.Unlock()
+		return nil
+	}
+	c.frames = 0
+	c.update()
+	ctrls, want := c.controls()
+	c.mu.Unlock()
+
+	if len(ctrls) == 0 {
+		return nil
+	}
+	// controls are recorded as applied once the encoder accepted them, a failed batch
+	// is sent again at the next key frame
+	if err := c.apply(ctrls); err != nil {
+		return err
+	}
+	c.mu.Lock()
+	c.applied = want
+	c.mu.Unlock()
+	return nil
+}
+
+// update computes the target bitrate and GOP size from the feedback of the weakest client
+func (c *BitrateController) update() {
+	if len(c.clients) == 0 {
+		return
+	}
+	var worst clientFeedback
+	first := true
+	for _, fb := range c.clients {
+		if first || fb.loss > worst.loss {
+			worst.loss = fb.loss
+		}
+		if first || fb.throughput < worst.throughput {
+			worst.throughput = fb.throughput
+		}
+		first = false
+	}
+
+	target := c.rate
+	switch {
+	case worst.loss > lossHigh:
+		target = c.rate * (1 - worst.loss/2)
+	case worst.loss < lossLow:
+		target = c.rate * (1 + rateIncrease)
+	}
+	if limit := worst.throughput * headroom; worst.throughput > 0 && target > limit {
+		target = limit
+	}
+
+	// smooth transitions
+	if max := c.rate * (1 + maxStep); target > max {
+		target = max
+	}
+	if min := c.rate * (1 - maxStep); target < min {
+		target = min
+	}
+	if target < float64(c.config.MinBitrate) {
+		target = float64(c.config.MinBitrate)
+	}
+	if c.config.MaxBitrate > 0 && target > float64(c.config.MaxBitrate) {
+		target = float64(c.config.MaxBitrate)
+	}
+	c.rate = target
+
+	c.gop = c.config.GOPSize
+	if worst.loss > lossLow && c.gop > 1 {
+		c.gop = c.config.GOPSize / 2
+	}
+}
+
+// controls returns the codec controls whose values changed since they were last applied,
+// and the values of all the controls
+func (c *BitrateController) controls() (changed, want []v4l2.Control) {
+	want = []v4l2.Control{{ID: v4l2.CtrlMPEGVideoBitrate, Value: int32(c.rate)}}
+	if c.config.MaxQP > 0 {
+		// at low rates, raise the minimum quantizer so the encoder does not spend the
+		// budget on the first macroblocks of a frame
+		span := float64(c.config.MaxBitrate - c.config.MinBitrate)
+		low := 0.0
+		if span > 0 {
+			low = 1 - (c.rate-float64(c.config.MinBitrate))/span
+		}
+		minQP := c.config.MinQP + int32(low*float64(c.config.MaxQP-c.config.MinQP)/3)
+		want = append(want,
+			v4l2.Control{ID: v4l2.CtrlMPEGVideoH264MinQP, Value: minQP},
+			v4l2.Control{ID: v4l2.CtrlMPEGVideoH264MaxQP, Value: c.config.MaxQP},
+		)
+	}
+	if c.gop > 0 {
+		want = append(want, v4l2.Control{ID: v4l2.CtrlMPEGVideoGOPSize, Value: c.gop})
+	}
+
+	for _, ctrl := range want {
+		if !controlApplied(c.applied, ctrl) {
+			changed = append(changed, ctrl)
+		}
+	}
+	return changed, want
+}
+
+func controlApplied(applied []v4l2.Control, ctrl v4l2.Control) bool {
+	for _, a := range applied {
+		if a.ID == ctrl.ID {
+			return a.Value == ctrl.Value
+		}
+	}
+	return false
+}
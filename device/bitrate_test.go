@@ -0,0 +1,174 @@
+package device
+
+import (
+	"errors"
+	"testing"
+
+	"github.com/vladimirvivien/go4vl/v4l2"
+)
+
+func TestBitrateControllerOncePerGOP(t *testing.T) {
+	var batches [][]v4l2.Control
+	c := newBitrateController(BitrateConfig{MinBitrate: 500000, MaxBitrate: 4000000, GOPSize: 30},
+		func(ctrls []v4l2.Control) error {
+			batches = append(batches, ctrls)
+			return nil
+		})
+
+	// a lossy client: the rate drops at each GOP, by at most maxStep
+	prev := float64(c.Bitrate())
+	for gop := 0; gop < 5; gop++ {
+		for i := 0; i < 30; i++ {
+			c.Report("client", 3000000, 0.3)
+			flags := v4l2.BufFlagPFrame
+			if i == 0 {
+				flags = v4l2.BufFlagKeyFrame
+			}
+			if err := c.FrameDone(flags); err != nil {
+				t.Fatal(err)
+			}
+		}
+		if len(batches) != gop+1 {
+			t.Fatalf("GOP %d: %d control batches applied, want %d", gop, len(batches), gop+1)
+		}
+		rate := float64(c.Bitrate())
+		if rate >= prev || rate < prev*(1-maxStep)-1 {
+			t.Fatalf("GOP %d: rate changed from %.0f to %.0f", gop, prev, rate)
+		}
+		prev = rate
+	}
+}
+
+// runGOP reports feedback for each frame of a GOP of size frames starting with a key frame
+func runGOP(t *testing.T, c *BitrateController, size int, throughput int64, loss float64) error {
+	t.Helper()
+	for i := 0; i < size; i++ {
+		c.Report("client", throughput, loss)
+		flags := v4l2.BufFlagPFrame
+		if i == 0 {
+			flags = v4l2.BufFlagKeyFrame
+		}
+		if err := c.FrameDone(flags); err != nil {
+			return err
+		}
+	}
+	return nil
+}
+
+func controlValue(ctrls []v4l2.Control, id v4l2.CtrlID) (int32, bool) {
+	for _, ctrl := range ctrls {
+		if ctrl.ID == id {
+			return ctrl.Value, true
+		}
+	}
+	return 0, false
+}
+
+func TestBitrateControllerRecovery(t *testing.T) {
+	var last []v4l2.Control
+	c := newBitrateController(BitrateConfig{MinBitrate: 500000, MaxBitrate: 4000000, GOPSize: 30},
+		func(ctrls []v4l2.Control) error {
+			last = ctrls
+			return nil
+		})
+
+	// losses reduce the rate and halve the GOP
+	for gop := 0; gop < 6; gop++ {
+		if err := runGOP(t, c, 30, 10000000, 0.3); err != nil {
+			t.Fatal(err)
+		}
+	}
+	low := float64(c.Bitrate())
+	if gop, ok := controlValue(c.applied, v4l2.CtrlMPEGVideoGOPSize); !ok || gop != 15 {
+		t.Fatalf("GOP size %d while lossy, want 15", gop)
+	}
+
+	// the smoothed loss falls below lossLow during the first clean GOP
+	if err := runGOP(t, c, 30, 10000000, 0); err != nil {
+		t.Fatal(err)
+	}
+	low = float64(c.Bitrate())
+
+	// once the network is clean, the rate grows by rateIncrease per GOP up to the maximum,
+	// and the GOP size is restored
+	for gop := 0; ; gop++ {
+		if err := runGOP(t, c, 30, 10000000, 0); err != nil {
+			t.Fatal(err)
+		}
+		rate := float64(c.Bitrate())
+		if rate >= 4000000 {
+			break
+		}
+		if want := low * (1 + rateIncrease); rate < want-1 || rate > want+1 {
+			t.Fatalf("clean GOP %d: rate grew from %.0f to %.0f, want %.0f", gop, low, rate, want)
+		}
+		if v, ok := controlValue(last, v4l2.CtrlMPEGVideoBitrate); !ok || v != int32(rate) {
+			t.Fatalf("clean GOP %d: bitrate control %d, want %d", gop, v, int32(rate))
+		}
+		low = rate
+	}
+	if gop, ok := controlValue(c.applied, v4l2.CtrlMPEGVideoGOPSize); !ok || gop != 30 {
+		t.Fatalf("GOP size %d once clean, want 30", gop)
+	}
+
+	// throughput caps the rate
+	for gop := 0; gop < 20; gop++ {
+		if err := runGOP(t, c, 30, 2000000, 0); err != nil {
+			t.Fatal(err)
+		}
+	}
+	if rate := float64(c.Bitrate()); rate > 2000000*headroom+1 {
+		t.Fatalf("rate %.0f above the throughput headroom", rate)
+	}
+}
+
+func TestBitrateControllerApplyFailure(t *testing.T) {
+	fail := true
+	var batches [][]v4l2.Control
+	c := newBitrateController(BitrateConfig{MinBitrate: 500000, MaxBitrate: 4000000, GOPSize: 30},
+		func(ctrls []v4l2.Control) error {
+			batches = append(batches, ctrls)
+			if fail {
+				return errors.New("busy")
+			}
+			return nil
+		})
+
+	if err := runGOP(t, c, 30, 3000000, 0.3); err == nil {
+		t.Fatal("expected the apply error")
+	}
+	if len(c.applied) != 0 {
+		t.Fatalf("controls recorded as applied after a failure: %v", c.applied)
+	}
+
+	// the controls are sent again (with the updated rate) at the next key frame
+	fail = false
+	if err := runGOP(t, c, 30, 3000000, 0.3); err != nil {
+		t.Fatal(err)
+	}
+	if len(batches) != 2 {
+		t.Fatalf("%d batches applied, want 2", len(batches))
+	}
+	if _, ok := controlValue(batches[1], v4l2.CtrlMPEGVideoGOPSize); !ok {
+		t.Fatalf("GOP size not sent again after the failure: %v", batches[1])
+	}
+	if v, _ := controlValue(c.applied, v4l2.CtrlMPEGVideoBitrate); v != c.Bitrate() {
+		t.Fatalf("applied bitrate %d, want %d", v, c.Bitrate())
+	}
+
+	// unchanged controls are not sent again
+	batches = nil
+	c.Forget("client")
+	for i := 0; i < 60; i++ {
+		flags := v4l2.BufFlagPFrame
+		if i%30 == 0 {
+			flags = v4l2.BufFlagKeyFrame
+		}
+		if err := c.FrameDone(flags); err != nil {
+			t.Fatal(err)
+		}
+	}
+	if len(batches) != 0 {
+		t.Fatalf("unchanged controls applied: %v", batches)
+	}
+}
@@ -0,0 +1,101 @@
+package device
+
+import (
+	"fmt"
+	sys "syscall"
+
+	"github.com/vladimirvivien/go4vl/v4l2"
+)
+
+// bracketing queues each capture buffer in a request (see the V4L2 Request API) carrying
+// the next of a cycle of control sets, so that each set applies to exactly one frame.
+type bracketing struct {
+	mediaPath string
+	sets      [][]v4l2.Control
+
+	mediaFd  uintptr
+	requests []uintptr // one request per buffer
+	setOf    []int     // control set bound to each buffer
+	next     int
+}
+
+// WithBracketing makes the device capture frames in a cycle of control sets (i.e. exposure
+// values for bracketing), each set applied to exactly one frame through the Request API of
+// the media device at mediaPath (i.e. /dev/media0). Frames are delivered as with
+// WithFrameOutput, and Frame.Bracket reports the set each frame was captured with.
+// Bracketing requires a driver supporting requests on capture buffers, and memory mapped IO.
+func WithBracketing(mediaPath string, sets ...[]v4l2.Control) Option {
+	return func(o *config) {
+		o.bracket = &bracketing{mediaPath: mediaPath, sets: sets}
+		o.frames = true
+	}
+}
+
+// open allocates one request per buffer
+func (b *bracketing) open(d *Device) error {
+	if len(b.sets) == 0 {
+		return fmt.Errorf("bracketing: no control set")
+	}
+	if d.config.ioType != v4l2.IOTypeMMAP {
+		return fmt.Errorf("bracketing: io type: %w", v4l2.ErrorUnsupportedFeature)
+	}
+	if d.requestedBuf.Capabilities&v4l2.BufCapSupportsRequests == 0 {
+		return fmt.Errorf("bracketing: requests: %w", v4l2.ErrorUnsupportedFeature)
+	}
+	fd, err := v4l2.OpenDevice(b.mediaPath, sys.O_RDWR, 0)
+	if err != nil {
+		return fmt.Errorf("bracketing: %w", err)
+	}
+	b.mediaFd = fd
+	b.requests = b.requests[:0]
+	b.setOf = make([]int, len(d.buffers))
+	b.next = 0
+	for range d.buffers {
+		req, err := v4l2.AllocRequest(fd)
+		if err != nil {
+			b.close()
+			return fmt.Errorf("bracketing: %w", err)
+		}
+		b.requests = append(b.requests, req)
+	}
+	return nil
+}
+
+// queue queues the buffer at index along with the next control set
+func (b *bracketing) queue(d *Device, index uint32) error {
+	req := b.requests[index]
+	// a request is reusable once completed, which it is by the time its buffer is dequeued
+	if err := v4l2.ReinitRequest(req); err != nil {
+		return err
+	}
+	set := b.next
+	if err := v4l2.SetRequestControlValues(d.fd, req, b.sets[set]); err != nil {
+		return err
+	}
+	if _, err := v4l2.QueueBufferInRequest(d.fd, d.config.ioType, d.bufType, index, req); err != nil {
+		return err
+	}
+	if err := v4l2.QueueRequest(req); err != nil {
+		return err
+	}
+	b.setOf[index] = set
+	b.next = (set + 1) % len(b.sets)
+	return nil
+}
+
+// close frees the requests and closes the media device
+func (b *bracketing) close() {
+	for _, req := range b.requests {
+		v4l2.CloseRequest(req)
+	}
+	b.requests = b.requests[:0]
+	if b.mediaFd != 0 {
+		v4l2.CloseDevice(b.mediaFd)
+		b.mediaFd = 0
+	}
+}
+
+// active reports whether buffers are queued in requests
+func (b *bracketing) active() bool {
+	return b != nil && b.mediaFd != 0
+}
@@ -0,0 +1,188 @@
+package device
+
+import (
+	"errors"
+	"fmt"
+	"sync"
+
+	"github.com/vladimirvivien/go4vl/v4l2"
+)
+
+// ErrControlQueueClosed is the result of control writes pending when the queue is closed
+var ErrControlQueueClosed = errors.New("device: control queue closed")
+
+// ControlFuture is the result of a queued control write
+type ControlFuture struct {
+	done chan struct{}
+	err  error
+}
+
+// Done returns a channel closed once the write is applied (or failed)
+func (f *ControlFuture) Done() <-chan struct{} {
+	return f.done
+}
+
+// Wait waits for the write to be applied and returns its error
+func (f *ControlFuture) Wait() error {
+	<-f.done
+	return f.err
+}
+
+type pendingControl struct {
+	value   v4l2.CtrlValue
+	futures []*ControlFuture
+}
+
+// ControlQueue applies control writes on a goroutine of its own, so that callers (i.e.
+// HTTP handlers, or the capture loop) never wait on the driver: on UVC devices, each write
+// is a USB control transfer that can take tens of milliseconds. Writes queued while the
+// previous ones are applied are coalesced per control (the last value wins, and every
+// future of the control gets the result of that write), then applied with a single
+// VIDIOC_S_EXT_CTRLS call per control class.
+type ControlQueue struct {
+	apply func(class v4l2.CtrlClass, ctrls []v4l2.Control) error
+
+	mu      sync.Mutex
+	pending map[v4l2.CtrlID]*pendingControl
+	order   []v4l2.CtrlID // pending ids in queueing order
+	wake    chan struct{}
+	closed  bool
+	stopped chan struct{}
+}
+
+// ControlQueue returns the control queue of the device, started on first use
+// and stopped when the device is closed.
+func (d *Device) ControlQueue() *ControlQueue {
+	d.ctrlQueueMu.Lock()
+	defer d.ctrlQueueMu.Unlock()
+	if d.ctrlQueue == nil {
+		d.ctrlQueue = newControlQueue(func(class v4l2.CtrlClass, ctrls []v4l2.Control) error {
+			if len(ctrls) == 1 && class == v4l2.CtrlClassUser {
+				return v4l2.SetControlValue(d.fd, ctrls[0].ID, ctrls[0].Value)
+			}
+			return v4l2.SetExtControlValues(d.fd, class, ctrls)
+		})
+	}
+	return d.ctrlQueue
+}
+
+func newControlQueue(apply func(v4l2.CtrlClass, []v4l2.Control) error) *ControlQueue {
+	q := &ControlQueue{
+		apply:   apply,
+		pending: make(map[v4l2.CtrlID]*pendingControl),
+		wake:    make(chan struct{}, 1),
+		stopped: make(chan struct{}),
+	}
+	go q.run()
+	return q
+}
+
+// Set queues a write of val to control id and returns immediately
+func (q *ControlQueue) Set(id v4l2.CtrlID, val v4l2.CtrlValue) *ControlFuture {
+	f := &ControlFuture{done: make(chan struct{})}
+	q.mu.Lock()
+	if q.closed {
+		q.mu.Unlock()
+		f.err = ErrControlQueueClosed
+		close(f.done)
+		return f
+	}
+	p, ok := q.pending[id]
+	if !ok {
+		p = &pendingControl{}
+		q.pending[id] = p
+		q.order = append(q.order, id)
+	}
+	p.value = val
+	p.futures = append(p.futures, f)
+	select {
+	case q.wake <- struct{}{}:
+	default:
+	}
+	q.mu.Unlock()
+	return f
+}
+
+// Close stops the queue once the writes in progress are applied. Writes still pending
+// fail with ErrControlQueueClosed.
+func (q *ControlQueue) Close() {
+	q.mu.Lock()
+	if q.closed {
+		q.mu.Unlock()
+		return
+	}
+	q.closed = true
+	q.mu.Unlock()
+	close(q.wake)
+	<-q.stopped
+
+	q.mu.Lock()
+	defer q.mu.Unlock()
+	for _, p := range q.pending {
+		resolve(p.futures, ErrControlQueueClosed)
+	}
+	q.pending, q.order = nil, nil
+}
+
+func (q *ControlQueue) run() {
+	defer close(q.stopped)
+	for range q.wake {
+		for q.applyPending() {
+		}
+	}
+}
+
+// applyPending applies the pending writes grouped by class, and reports whether there were any
+func (q *ControlQueue) applyPending() bool {
+	q.mu.Lock()
+	if q.closed || len(q.order) == 0 {
+		q.mu.Unlock()
+		return false
+	}
+	pending, order := q.pending, q.order
+	q.pending, q.order = make(map[v4l2.CtrlID]*pendingControl), nil
+	q.mu.Unlock()
+
+	// group by class (in queueing order), a batch can only hold controls of one class
+	var classes []v4l2.CtrlClass
+	batches := make(map[v4l2.CtrlClass][]v4l2.Control)
+	for _, id := range order {
+		class := v4l2.GetControlClass(id)
+		if _, ok := batches[class]; !ok {
+			classes = append(classes, class)
+		}
+		batches[class] = append(batches[class], v4l2.Control{ID: id, Value: pending[id].value})
+	}
+
+	for _, class := range classes {
+		batch := batches[class]
+		err := q.apply(class, batch)
+		if err == nil || len(batch) == 1 {
+			for _, ctrl := range batch {
+				resolve(pending[ctrl.ID].futures, wrapControlErr(ctrl.ID, err))
+			}
+			continue
+		}
+		// the driver rejected the batch as a whole: apply the controls one by one,
+		// so that a single bad value does not fail the others
+		for _, ctrl := range batch {
+			err := q.apply(class, []v4l2.Control{ctrl})
+			resolve(pending[ctrl.ID].futures, wrapControlErr(ctrl.ID, err))
+		}
+	}
+	return true
+}
+
+func wrapControlErr(id v4l2.CtrlID, err error) error {
+	if err == nil {
+		return nil
+	}
+	return fmt.Errorf("device: control %d: %w", id, err)
+}
+
+func resolve(futures []*ControlFuture, err error) {
+	for _, f := range futures {
+		f.err = err
+		close(f.done)
+	}
+}
@@ -0,0 +1,63 @@
+package device
+
+import (
+	"errors"
+	"sync"
+	"testing"
+
+	"github.com/vladimirvivien/go4vl/v4l2"
+)
+
+func TestControlQueueCoalesce(t *testing.T) {
+	var mu sync.Mutex
+	var calls [][]v4l2.Control
+	block := make(chan struct{})
+	applying := make(chan struct{}, 1)
+	q := newControlQueue(func(class v4l2.CtrlClass, ctrls []v4l2.Control) error {
+		select {
+		case applying <- struct{}{}:
+		default:
+		}
+		<-block
+		mu.Lock()
+		defer mu.Unlock()
+		calls = append(calls, ctrls)
+		for _, c := range ctrls {
+			if c.ID == v4l2.CtrlHue {
+				return errors.New("invalid value")
+			}
+		}
+		return nil
+	})
+	defer q.Close()
+
+	// the first write holds the worker until all the next ones pile up behind it
+	first := q.Set(v4l2.CtrlBrightness, 1)
+	<-applying
+	brightness := []*ControlFuture{q.Set(v4l2.CtrlBrightness, 2), q.Set(v4l2.CtrlBrightness, 3)}
+	contrast := q.Set(v4l2.CtrlContrast, 4)
+	hue := q.Set(v4l2.CtrlHue, 5)
+	close(block)
+
+	if err := first.Wait(); err != nil {
+		t.Fatal(err)
+	}
+	for _, f := range append(brightness, contrast) {
+		if err := f.Wait(); err != nil {
+			t.Fatal(err)
+		}
+	}
+	if err := hue.Wait(); err == nil {
+		t.Fatal("expected hue error")
+	}
+
+	// first write, rejected batch, then one write per control of the batch
+	mu.Lock()
+	defer mu.Unlock()
+	if len(calls) != 5 || len(calls[1]) != 3 {
+		t.Fatalf("unexpected calls: %v", calls)
+	}
+	if calls[1][0].ID != v4l2.CtrlBrightness || calls[1][0].Value != 3 {
+		t.Fatalf("brightness not coalesced: %+v", calls[1][0])
+	}
+}
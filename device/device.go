@@ -5,8 +5,11 @@ import (
 	"errors"
 	"fmt"
 	"os"
+	"sync"
 	sys "syscall"
+	"time"
 
+	"github.com/vladimirvivien/go4vl/arena"
 	"github.com/vladimirvivien/go4vl/v4l2"
 )
 
@@ -22,17 +25,40 @@ type Device struct {
 	requestedBuf v4l2.RequestBuffers
 	streaming    bool
 	output       chan []byte
+	frames       chan *Frame
+	userSlabs    []*arena.Slab
+	userArena    *arena.Arena
+	input        int32
+
+	formatChanges chan v4l2.PixFormat
+	watchSource   bool
+	sourceChanged bool
+
+	subs subscribers
+
+	latency latency
+	standby standby
+
+	profile *Profile
+
+	ctrlQueueMu sync.Mutex
+	ctrlQueue   *ControlQueue
+
+	errMu     sync.Mutex
+	streamErr error
 }
 
 // Open creates opens the underlying device at specified path for streaming.
 // It returns a *Device or an error if unable to open device.
 func Open(path string, options ...Option) (*Device, error) {
+	began := time.Now()
 	fd, err := v4l2.OpenDevice(path, sys.O_RDWR|sys.O_NONBLOCK, 0)
 	if err != nil {
 		return nil, fmt.Errorf("device open: %w", err)
 	}
 
-	dev := &Device{path: path, config: config{}, fd: fd}
+	dev := &Device{path: path, config: config{}, fd: fd, formatChanges: make(chan v4l2.PixFormat, 1)}
+	dev.latency.mark = began
 	// apply options
 	if len(options) > 0 {
 		for _, o := range options {
@@ -78,38 +104,84 @@ func Open(path string, options ...Option) (*Device, error) {
 		return nil, fmt.Errorf("device open: does not support buffer stream type")
 	}
 
-	// ensures IOType is set, only MemMap supported now
-	dev.config.ioType = v4l2.IOTypeMMAP
+	// ensures IOType is set, only MemMap and user pointer IO supported now
+	switch dev.config.ioType {
+	case 0:
+		dev.config.ioType = v4l2.IOTypeMMAP
+	case v4l2.IOTypeMMAP, v4l2.IOTypeUserPtr:
+	default:
+		return nil, fmt.Errorf("device open: %s: io type: %w", path, v4l2.ErrorUnsupportedFeature)
+	}
+
+	dev.latency.Open = dev.latency.lap()
+
+	// a cached profile matching the capability just queried saves enumerating the device
+	if dev.config.profiles != nil {
+		dev.profile, _ = dev.config.profiles.Load(cap)
+	}
 
-	// reset crop, only if cropping supported
-	if cropcap, err := v4l2.GetCropCapability(dev.fd, dev.bufType); err == nil {
-		if err := v4l2.SetCropRect(dev.fd, cropcap.DefaultRect); err != nil {
-			// ignore errors
+	// reset crop, only if cropping supported (and not already reset)
+	cropping := false
+	if dev.profile != nil {
+		cropping, dev.cropCap = dev.profile.Cropping, dev.profile.CropCap
+	} else if cropcap, err := v4l2.GetCropCapability(dev.fd, dev.bufType); err == nil {
+		cropping, dev.cropCap = true, cropcap
+	}
+	if cropping {
+		if crop, err := v4l2.GetCropRect(dev.fd, dev.bufType); err != nil || crop != dev.cropCap.DefaultRect {
+			if err := v4l2.SetCropRect(dev.fd, dev.cropCap.DefaultRect); err != nil {
+				// ignore errors
+			}
 		}
 	}
+	dev.latency.Crop = dev.latency.lap()
 
 	// set pix format
-	if dev.config.pixFormat != (v4l2.PixFormat{}) {
-		if err := dev.SetPixFormat(dev.config.pixFormat); err != nil {
-			return nil, fmt.Errorf("device open: %s: set format: %w", path, err)
-		}
-	} else {
-		dev.config.pixFormat, err = v4l2.GetPixFormat(dev.fd)
+	if dev.config.pixFormat == (v4l2.PixFormat{}) {
+		// lock DV receivers (HDMI, SDI) onto the incoming signal before reading the default format
+		dev.applyDetectedTimings()
+	}
+	current, err := v4l2.GetPixFormat(dev.fd)
+	switch {
+	case dev.config.pixFormat == (v4l2.PixFormat{}):
 		if err != nil {
 			return nil, fmt.Errorf("device open: %s: get default format: %w", path, err)
 		}
+		dev.config.pixFormat = current
+	case err == nil && formatMatches(current, dev.config.pixFormat):
+		// the device is already set up (i.e. reopened), S_FMT would only cost time
+		dev.config.pixFormat = current
+	default:
+		if err := dev.SetPixFormat(dev.config.pixFormat); err != nil {
+			return nil, fmt.Errorf("device open: %s: set format: %w", path, err)
+		}
 	}
+	dev.latency.Format = dev.latency.lap()
 
 	// set fps
-	if dev.config.fps != 0 {
-		if err := dev.SetFrameRate(dev.config.fps); err != nil {
-			return nil, fmt.Errorf("device open: %s: set fps: %w", path, err)
-		}
-	} else {
-		if dev.config.fps, err = dev.GetFrameRate(); err != nil {
+	fps := dev.config.fps
+	dev.config.fps = 0
+	currentFPS, err := dev.GetFrameRate()
+	switch {
+	case fps == 0:
+		if err != nil {
 			return nil, fmt.Errorf("device open: %s: get fps: %w", path, err)
 		}
+	case err == nil && currentFPS == fps:
+	default:
+		if err := dev.SetFrameRate(fps); err != nil {
+			return nil, fmt.Errorf("device open: %s: set fps: %w", path, err)
+		}
 	}
+	dev.latency.FrameRate = dev.latency.lap()
+
+	// first open of the device: enumerate it once for the next opens
+	if dev.config.profiles != nil && dev.profile == nil {
+		dev.Profile() // not fatal, the profile is only an optimization
+	}
+
+	// wrap the (non-blocking) fd so it gets registered with the Go runtime poller
+	dev.file = os.NewFile(dev.fd, path)
 
 	return dev, nil
 }
@@ -121,6 +193,15 @@ func (d *Device) Close() error {
 			return err
 		}
 	}
+	d.ctrlQueueMu.Lock()
+	ctrlQueue := d.ctrlQueue
+	d.ctrlQueueMu.Unlock()
+	if ctrlQueue != nil {
+		ctrlQueue.Close()
+	}
+	if d.file != nil {
+		return d.file.Close()
+	}
 	return v4l2.CloseDevice(d.fd)
 }
 
@@ -163,11 +244,18 @@ func (d *Device) MemIOType() v4l2.IOType {
 }
 
 // GetOutput returns the channel that outputs streamed data that is
-// captured from the underlying device driver.
+// captured from the underlying device driver. The data of H.264 streams is not indexed:
+// consumers locating NAL units should use Frame values instead (see WithFrameOutput).
 func (d *Device) GetOutput() <-chan []byte {
 	return d.output
 }
 
+// GetFrames returns the channel that outputs captured frames when the device
+// is opened with WithFrameOutput. Each received frame must be released by the consumer.
+func (d *Device) GetFrames() <-chan *Frame {
+	return d.frames
+}
+
 // SetInput sets up an input channel for data this sent for output to the
 // underlying device driver.
 func (d *Device) SetInput(in <-chan []byte) {
@@ -193,6 +281,16 @@ func (d *Device) SetCropRect(r v4l2.Rect) error {
 	return nil
 }
 
+// formatMatches reports whether the current format of the device satisfies the
+// requested format (unset fields of the request match any value)
+func formatMatches(current, requested v4l2.PixFormat) bool {
+	return current.PixelFormat == requested.PixelFormat &&
+		current.Width == requested.Width &&
+		current.Height == requested.Height &&
+		(requested.Field == v4l2.FieldAny || current.Field == requested.Field) &&
+		(requested.BytesPerLine == 0 || current.BytesPerLine == requested.BytesPerLine)
+}
+
 // GetPixFormat retrieves pixel format info for device
 func (d *Device) GetPixFormat() (v4l2.PixFormat, error) {
 	if !d.cap.IsVideoCaptureSupported() {
@@ -238,6 +336,9 @@ func (d *Device) GetFormatDescriptions() ([]v4l2.FormatDescription, error) {
 		return nil, v4l2.ErrorUnsupportedFeature
 	}
 
+	if d.profile != nil {
+		return d.profile.FormatDescriptions(), nil
+	}
 	return v4l2.GetAllFormatDescriptions(d.fd)
 }
 
@@ -250,6 +351,18 @@ func (d *Device) GetVideoInputIndex() (int32, error) {
 	return v4l2.GetCurrentVideoInputIndex(d.fd)
 }
 
+// SetVideoInput selects the video input (see GetVideoInputInfo) the device captures from
+func (d *Device) SetVideoInput(index int32) error {
+	if !d.cap.IsVideoCaptureSupported() {
+		return v4l2.ErrorUnsupportedFeature
+	}
+	if err := v4l2.SetVideoInputIndex(d.fd, index); err != nil {
+		return fmt.Errorf("device: %w", err)
+	}
+	d.input = index
+	return nil
+}
+
 // GetVideoInputInfo returns video input info for device
 func (d *Device) GetVideoInputInfo(index uint32) (v4l2.InputInfo, error) {
 	if !d.cap.IsVideoCaptureSupported() {
@@ -334,6 +447,7 @@ func (d *Device) Start(ctx context.Context) error {
 	if d.streaming {
 		return fmt.Errorf("device: stream already started")
 	}
+	d.latency.mark = time.Now()
 
 	// allocate device buffers
 	bufReq, err := v4l2.InitBuffers(d)
@@ -344,11 +458,37 @@ func (d *Device) Start(ctx context.Context) error {
 	d.config.bufSize = bufReq.Count
 	d.requestedBuf = bufReq
 
-	// for each allocated device buf, map into local space
-	if d.buffers, err = v4l2.MapMemoryBuffers(d); err != nil {
-		return fmt.Errorf("device: make mapped buffers: %s", err)
+	switch d.config.ioType {
+	case v4l2.IOTypeUserPtr:
+		// allocate page-aligned buffers to be filled by the driver
+		if d.buffers, err = d.allocUserBuffers(); err != nil {
+			return fmt.Errorf("device: make user buffers: %s", err)
+		}
+	default:
+		// for each allocated device buf, map into local space
+		if d.buffers, err = v4l2.MapMemoryBuffers(d); err != nil {
+			return fmt.Errorf("device: make mapped buffers: %s", err)
+		}
+	}
+
+	if d.config.bracket != nil {
+		if err := d.config.bracket.open(d); err != nil {
+			return fmt.Errorf("device: %w", err)
+		}
 	}
 
+	d.latency.Buffers = d.latency.lap()
+
+	// start input scan from the first input
+	if d.config.scan != nil && len(d.config.scan.inputs) > 0 {
+		if err := d.config.scan.switchTo(d, 0, false); err != nil {
+			return fmt.Errorf("device: %w", err)
+		}
+	} else if input, err := v4l2.GetCurrentVideoInputIndex(d.fd); err == nil {
+		d.input = input
+	}
+
+	d.setErr(nil)
 	if err := d.startStreamLoop(ctx); err != nil {
 		return fmt.Errorf("device: start stream loop: %s", err)
 	}
@@ -362,70 +502,256 @@ func (d *Device) Stop() error {
 	if !d.streaming {
 		return nil
 	}
-	if err := v4l2.UnmapMemoryBuffers(d); err != nil {
-		return fmt.Errorf("device: stop: %w", err)
-	}
+	// the stream loop ends at its next dequeue
+	d.standby.mu.Lock()
+	d.standby.stopped = true
+	d.standby.mu.Unlock()
 	if err := v4l2.StreamOff(d); err != nil {
 		return fmt.Errorf("device: stop: %w", err)
 	}
+	if d.watchSource {
+		v4l2.UnsubscribeEvent(d.fd, v4l2.EventSourceChange, uint32(d.input))
+		d.watchSource, d.sourceChanged = false, false
+	}
+	if d.config.bracket.active() {
+		d.config.bracket.close()
+	}
+	switch d.config.ioType {
+	case v4l2.IOTypeUserPtr:
+		d.freeUserBuffers()
+	default:
+		// buffers are released when a source change failed to reallocate them
+		if d.buffers != nil {
+			if err := v4l2.UnmapMemoryBuffers(d); err != nil {
+				return fmt.Errorf("device: stop: %w", err)
+			}
+		}
+	}
 	d.streaming = false
+
+	// end a paused stream loop
+	d.standby.mu.Lock()
+	if d.standby.paused {
+		d.standby.paused = false
+		close(d.standby.resume)
+	}
+	d.standby.mu.Unlock()
 	return nil
 }
 
+// Err returns the error that ended the stream, if any. When the stream loop fails (i.e. the
+// device was unplugged, or could not be reconfigured), the stream is stopped and its output
+// channels closed: consumers seeing their channel closed call Err to tell a failure from a
+// stop. It returns nil when the stream was stopped or its context cancelled.
+func (d *Device) Err() error {
+	d.errMu.Lock()
+	defer d.errMu.Unlock()
+	return d.streamErr
+}
+
+func (d *Device) setErr(err error) {
+	d.errMu.Lock()
+	d.streamErr = err
+	d.errMu.Unlock()
+}
+
+// fail ends the stream loop with err
+func (d *Device) fail(err error) {
+	d.setErr(fmt.Errorf("device: stream loop: %w", err))
+	d.Stop()
+}
+
+// allocUserBuffers draws one slab per requested buffer from the configured arena,
+// or from an arena private to the device when none is configured.
+func (d *Device) allocUserBuffers() ([][]byte, error) {
+	pixFmt, err := v4l2.GetPixFormat(d.fd)
+	if err != nil {
+		return nil, err
+	}
+	size := int(pixFmt.SizeImage)
+	src := d.config.arena
+	if src == nil || src.SlabSize() < size {
+		a, err := d.newLocalArena(size, int(d.config.bufSize))
+		if err != nil {
+			return nil, err
+		}
+		d.userArena, src = a, a
+	}
+
+	buffers := make([][]byte, d.config.bufSize)
+	for i := range buffers {
+		slab, err := src.Alloc()
+		if err != nil {
+			d.freeUserBuffers()
+			return nil, err
+		}
+		d.userSlabs = append(d.userSlabs, slab)
+		buffers[i] = slab.Bytes()[:size]
+	}
+	return buffers, nil
+}
+
+func (d *Device) freeUserBuffers() {
+	for _, slab := range d.userSlabs {
+		slab.Release()
+	}
+	d.userSlabs = nil
+	if d.userArena != nil {
+		d.userArena.Close()
+		d.userArena = nil
+	}
+}
+
+// queueBuffer enqueues the buffer at index for capture
+func (d *Device) queueBuffer(index uint32) error {
+	var err error
+	if d.config.bracket.active() {
+		return d.config.bracket.queue(d, index)
+	}
+	if d.config.ioType == v4l2.IOTypeUserPtr {
+		_, err = v4l2.QueueUserPtrBuffer(d.fd, d.bufType, index, d.buffers[index])
+	} else {
+		_, err = v4l2.QueueBuffer(d.fd, d.config.ioType, d.bufType, index)
+	}
+	return err
+}
+
 // startStreamLoop sets up the loop to run until context is cancelled, and returns immediately
-// and report any errors. The loop runs in a separate goroutine and uses the sys.Select to trigger
-// capture events.
+// and report any errors. The loop runs in a separate goroutine and waits for capture events using
+// the Go runtime poller (or a shared io_uring when configured), so a waiting device parks its
+// goroutine instead of blocking an OS thread.
 func (d *Device) startStreamLoop(ctx context.Context) error {
-	d.output = make(chan []byte, d.config.bufSize)
+	switch {
+	case d.config.subscribe:
+	case d.config.frames:
+		d.frames = make(chan *Frame, d.config.bufSize)
+	default:
+		d.output = make(chan []byte, d.config.bufSize)
+	}
+
+	next, closeWait, err := d.newDequeuer(ctx, d.watchSourceChange())
+	if err != nil {
+		return fmt.Errorf("device: stream loop: %w", err)
+	}
 
 	// Initial enqueue of buffers for capture
+	d.standby.reset(len(d.buffers))
+	d.standby.stopped = false
 	for i := 0; i < int(d.config.bufSize); i++ {
-		_, err := v4l2.QueueBuffer(d.fd, d.config.ioType, d.bufType, uint32(i))
-		if err != nil {
+		if err := d.queueBuffer(uint32(i)); err != nil {
+			closeWait()
 			return fmt.Errorf("device: buffer queueing: %w", err)
 		}
 	}
 
 	if err := v4l2.StreamOn(d); err != nil {
+		closeWait()
 		return fmt.Errorf("device: stream on: %w", err)
 	}
+	d.latency.StreamOn = d.latency.lap()
+	d.latency.streamOn()
 
 	go func() {
-		defer close(d.output)
+		defer func() {
+			switch {
+			case d.config.subscribe:
+				d.subs.close()
+			case d.frames != nil:
+				close(d.frames)
+			default:
+				close(d.output)
+			}
+		}()
+		defer closeWait()
 
-		fd := d.Fd()
 		var frame []byte
-		ioMemType := d.MemIOType()
-		bufType := d.BufferType()
-		waitForRead := v4l2.WaitForRead(d)
 		for {
-			select {
-			// handle stream capture (read from driver)
-			case <-waitForRead:
-				buff, err := v4l2.DequeueBuffer(fd, ioMemType, bufType)
-				if err != nil {
-					if errors.Is(err, sys.EAGAIN) {
+			buff, err := next()
+			if errors.Is(err, errWaitTimeout) || errors.Is(err, errEventPending) {
+				// events pending, or no frame for a while: the source may have changed
+				if err := d.checkSourceChange(); err != nil {
+					d.fail(err)
+					return
+				}
+				continue
+			}
+			if err != nil {
+				if ctx.Err() != nil {
+					d.Stop()
+					return
+				}
+				if errors.Is(err, errStopped) {
+					return
+				}
+				if errors.Is(err, errPaused) {
+					// warm standby: wait for the stream to resume
+					if d.waitResume(ctx.Done()) {
 						continue
 					}
-					panic(fmt.Sprintf("device: stream loop dequeue: %s", err))
+					if ctx.Err() != nil {
+						d.Stop()
+					}
+					return
 				}
+				d.fail(fmt.Errorf("dequeue: %w", err))
+				return
+			}
+			d.latency.frameCaptured()
 
-				// copy mapped buffer (copying avoids polluted data from subsequent dequeue ops)
-				if buff.Flags&v4l2.BufFlagMapped != 0 && buff.Flags&v4l2.BufFlagError == 0 {
-					frame = make([]byte, buff.BytesUsed)
-					if n := copy(frame, d.buffers[buff.Index][:buff.BytesUsed]); n == 0 {
-						d.output <- []byte{}
-					}
-					d.output <- frame
-					frame = nil
-				} else {
+			// mapped (or user pointer) buffer filled without error
+			filled := (buff.Flags&v4l2.BufFlagMapped != 0 || buff.Memory == v4l2.IOTypeUserPtr) && buff.Flags&v4l2.BufFlagError == 0
+
+			// drop frames captured during an input switch
+			if scan := d.config.scan; scan != nil && !scan.accept(buff, len(d.buffers)) {
+				if err := d.requeue(buff.Index); err != nil {
+					d.fail(fmt.Errorf("queue buffer %d: %w", buff.Index, err))
+					return
+				}
+				continue
+			}
+
+			// copy mapped buffer (copying avoids polluted data from subsequent dequeue ops)
+			switch {
+			case d.config.subscribe:
+				if filled {
+					d.subs.deliver(d, buff)
+				}
+			case d.frames != nil:
+				if filled {
+					d.frames <- d.newFrame(buff)
+				}
+			case filled:
+				frame = make([]byte, buff.BytesUsed)
+				if n := copy(frame, d.buffers[buff.Index][:buff.BytesUsed]); n == 0 {
 					d.output <- []byte{}
 				}
+				d.output <- frame
+				frame = nil
+			default:
+				d.output <- []byte{}
+			}
 
-				if _, err := v4l2.QueueBuffer(fd, ioMemType, bufType, buff.Index); err != nil {
-					panic(fmt.Sprintf("device: stream loop queue: %s: buff: %#v", err, buff))
+			if err := d.requeue(buff.Index); err != nil {
+				d.fail(fmt.Errorf("queue buffer %d: %w", buff.Index, err))
+				return
+			}
+
+			if scan := d.config.scan; scan != nil {
+				if err := scan.delivered(d); err != nil {
+					d.fail(err)
+					return
 				}
-			case <-ctx.Done():
+			}
+
+			// receivers flag the buffers captured across a signal change with errors
+			if d.watchSource && buff.Flags&v4l2.BufFlagError != 0 {
+				if err := d.checkSourceChange(); err != nil {
+					d.fail(err)
+					return
+				}
+			}
+
+			if ctx.Err() != nil {
 				d.Stop()
 				return
 			}
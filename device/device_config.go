@@ -1,6 +1,7 @@
 package device
 
 import (
+	"github.com/vladimirvivien/go4vl/arena"
 	"github.com/vladimirvivien/go4vl/v4l2"
 )
 
@@ -10,6 +11,13 @@ type config struct {
 	bufSize   uint32
 	fps       uint32
 	bufType   uint32
+	uring     *URing
+	frames    bool
+	arena     *arena.Arena
+	scan      *inputScan
+	subscribe bool
+	profiles  *ProfileCache
+	bracket   *bracketing
 }
 
 type Option func(*config)
@@ -49,3 +57,56 @@ func WithVideoOutputEnabled() Option {
 		o.bufType = v4l2.BufTypeVideoOutput
 	}
 }
+
+// WithURing makes the device wait for captured buffers using the specified shared io_uring
+// instead of the Go runtime poller. A nil ring keeps the default poller, so the result of
+// NewURing can be passed as is when io_uring is not supported by the kernel.
+func WithURing(ring *URing) Option {
+	return func(o *config) {
+		o.uring = ring
+	}
+}
+
+// WithFrameOutput makes the device deliver captured data as *Frame values (see GetFrames)
+// instead of byte slices (see GetOutput).
+func WithFrameOutput() Option {
+	return func(o *config) {
+		o.frames = true
+	}
+}
+
+// WithSubscriptions makes the device deliver captured frames to its subscriptions only
+// (see Device.Subscribe), each paced at its own frame rate, instead of GetOutput or GetFrames.
+func WithSubscriptions() Option {
+	return func(o *config) {
+		o.subscribe = true
+	}
+}
+
+// WithArena makes the device draw frame copies (when using WithFrameOutput) and
+// user pointer buffers (when using IOTypeUserPtr) from the specified off-heap arena.
+func WithArena(a *arena.Arena) Option {
+	return func(o *config) {
+		o.arena = a
+	}
+}
+
+// WithInputScan makes the device cycle through the specified video inputs (round-robin) while
+// streaming, capturing framesPerInput frames from each input before switching to the next one.
+// Frames captured during a switch are dropped, along with settleFrames additional frames
+// for inputs that need time to stabilize after a switch (0 for most capture cards). With
+// drivers that refuse input changes while buffers are allocated, the stream is restarted
+// with its buffers reallocated around each switch. Frames delivered with WithFrameOutput are tagged with the input they came from.
+func WithInputScan(inputs []int32, framesPerInput, settleFrames int) Option {
+	return func(o *config) {
+		o.scan = newInputScan(inputs, framesPerInput, settleFrames)
+	}
+}
+
+// WithProfileCache makes Open serve the device profile (see Device.Profile) from cache,
+// skipping enumeration when the device was seen before, and store the profile of a new device.
+func WithProfileCache(cache *ProfileCache) Option {
+	return func(o *config) {
+		o.profiles = cache
+	}
+}
@@ -52,3 +52,18 @@ func (d *Device) SetControlSaturation(val v4l2.CtrlValue) error {
 func (d *Device) SetControlHue(val v4l2.CtrlValue) error {
 	return d.SetControlValue(v4l2.CtrlHue, val)
 }
+
+// RequestKeyFrame asks a video encoder to produce a key frame as soon as possible
+// (control v4l2.CtrlMPEGVideoForceKeyFrame)
+func (d *Device) RequestKeyFrame() error {
+	return d.SetControlValue(v4l2.CtrlMPEGVideoForceKeyFrame, 1)
+}
+
+// SetExtControlValues updates the values of several controls of the same class at once
+// (i.e. v4l2.CtrlClassCodec), which the driver applies together.
+func (d *Device) SetExtControlValues(class v4l2.CtrlClass, ctrls []v4l2.Control) error {
+	if err := v4l2.SetExtControlValues(d.fd, class, ctrls); err != nil {
+		return fmt.Errorf("device: %s: %w", d.path, err)
+	}
+	return nil
+}
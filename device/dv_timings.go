@@ -0,0 +1,218 @@
+package device
+
+import (
+	"errors"
+	"fmt"
+	sys "syscall"
+	"time"
+
+	"github.com/vladimirvivien/go4vl/v4l2"
+)
+
+// QueryDVTimings returns the digital video timings detected on the current input (i.e. HDMI, SDI)
+func (d *Device) QueryDVTimings() (v4l2.DVTimings, error) {
+	timings, err := v4l2.QueryDVTimings(d.fd)
+	if err != nil {
+		return v4l2.DVTimings{}, fmt.Errorf("device: %w", err)
+	}
+	return timings, nil
+}
+
+// GetDVTimings returns the digital video timings currently set for the device input
+func (d *Device) GetDVTimings() (v4l2.DVTimings, error) {
+	timings, err := v4l2.GetDVTimings(d.fd)
+	if err != nil {
+		return v4l2.DVTimings{}, fmt.Errorf("device: %w", err)
+	}
+	return timings, nil
+}
+
+// SetDVTimings sets the digital video timings for the device input. This should be done
+// before streaming is started (see also GetFormatChanges for automatic handling).
+func (d *Device) SetDVTimings(timings v4l2.DVTimings) error {
+	if err := v4l2.SetDVTimings(d.fd, timings); err != nil {
+		return fmt.Errorf("device: %w", err)
+	}
+	return nil
+}
+
+// GetFormatChanges returns a channel that receives the new pixel format each time the
+// device stream is reconfigured after its source changed (i.e. an HDMI source switching
+// resolution). Only the latest format is kept when the channel is not drained. When the
+// stream cannot be reconfigured, it ends (its output is closed) and Err reports why.
+func (d *Device) GetFormatChanges() <-chan v4l2.PixFormat {
+	return d.formatChanges
+}
+
+// isDVInput returns true when the current input uses digital video timings
+func (d *Device) isDVInput() bool {
+	index, err := v4l2.GetCurrentVideoInputIndex(d.fd)
+	if err != nil {
+		return false
+	}
+	info, err := v4l2.GetVideoInputInfo(d.fd, uint32(index))
+	if err != nil {
+		return false
+	}
+	return info.GetCapabilities()&v4l2.InputCapDVTimings != 0
+}
+
+// applyDetectedTimings locks a DV receiver onto the timings of its incoming signal,
+// so that the default format matches the source.
+func (d *Device) applyDetectedTimings() {
+	if !d.isDVInput() {
+		return
+	}
+	detected, err := v4l2.QueryDVTimings(d.fd)
+	if err != nil {
+		return // no signal, or signal not locked
+	}
+	if current, err := v4l2.GetDVTimings(d.fd); err == nil && current == detected {
+		return
+	}
+	v4l2.SetDVTimings(d.fd, detected)
+}
+
+// watchSourceChange subscribes to source change events of the current input when it uses
+// DV timings. It returns the wait timeout after which the stream loop looks for events when no
+// frame arrives (when the source goes away, receivers usually stop delivering frames).
+// Otherwise events are only dequeued when they are pending (POLLPRI, see errEventPending), or
+// when a buffer comes back with an error: frames do not cost a DQEVENT each.
+func (d *Device) watchSourceChange() time.Duration {
+	if !d.isDVInput() {
+		return 0
+	}
+	if err := v4l2.SubscribeEvent(d.fd, v4l2.EventSourceChange, uint32(d.input), 0); err != nil {
+		return 0
+	}
+	d.watchSource = true
+	fps := d.config.fps
+	if fps == 0 {
+		return time.Second
+	}
+	return 2 * time.Second / time.Duration(fps)
+}
+
+// checkSourceChange dequeues pending events, and reconfigures the stream when the
+// resolution of the source changed. An error leaves the stream stopped, and ends it.
+func (d *Device) checkSourceChange() error {
+	for {
+		event, err := v4l2.DequeueEvent(d.fd)
+		if err != nil {
+			break // ENOENT: no more events
+		}
+		if event.Type == v4l2.EventSourceChange && event.SourceChanges()&v4l2.SourceChangeResolution != 0 {
+			d.sourceChanged = true
+		}
+	}
+	if !d.sourceChanged {
+		return nil
+	}
+	return d.reconfigureSource()
+}
+
+// reconfigureSource applies the new timings of the source and restarts the stream. Buffers
+// are kept when the driver accepts the timings with buffers allocated and the new image
+// fits into them; otherwise they are released, and reallocated at the new size.
+func (d *Device) reconfigureSource() error {
+	timings, err := v4l2.QueryDVTimings(d.fd)
+	if err != nil {
+		return nil // signal not (yet) stable, retried with the next check
+	}
+	d.sourceChanged = false
+
+	// a paused stream is restarted with the new buffers on Resume
+	d.standby.mu.Lock()
+	defer d.standby.mu.Unlock()
+	if err := v4l2.StreamOff(d); err != nil {
+		return fmt.Errorf("source change: %w", err)
+	}
+
+	released := false
+	if err := v4l2.SetDVTimings(d.fd, timings); errors.Is(err, sys.EBUSY) {
+		if err := d.releaseBuffers(); err != nil {
+			return fmt.Errorf("source change: %w", err)
+		}
+		released = true
+		if err := v4l2.SetDVTimings(d.fd, timings); err != nil {
+			return fmt.Errorf("source change: %w", err)
+		}
+	} else if err != nil {
+		return fmt.Errorf("source change: %w", err)
+	}
+
+	pixFmt, err := v4l2.GetPixFormat(d.fd)
+	if err != nil {
+		return fmt.Errorf("source change: %w", err)
+	}
+	d.config.pixFormat = pixFmt
+
+	if !released && int(pixFmt.SizeImage) > cap(d.buffers[0]) {
+		if err := d.releaseBuffers(); err != nil {
+			return fmt.Errorf("source change: %w", err)
+		}
+		released = true
+	}
+	if released {
+		if err := d.reallocBuffers(); err != nil {
+			return fmt.Errorf("source change: %w", err)
+		}
+		d.standby.reset(len(d.buffers))
+	}
+
+	if !d.standby.paused {
+		if err := d.queueFree(); err != nil {
+			return fmt.Errorf("source change: %w", err)
+		}
+		if err := v4l2.StreamOn(d); err != nil {
+			return fmt.Errorf("source change: %w", err)
+		}
+	}
+
+	// keep only the latest format
+	select {
+	case <-d.formatChanges:
+	default:
+	}
+	d.formatChanges <- pixFmt
+	return nil
+}
+
+// releaseBuffers frees the driver buffers. User pointer buffers are kept for reuse.
+func (d *Device) releaseBuffers() error {
+	if d.config.ioType != v4l2.IOTypeUserPtr {
+		if err := v4l2.UnmapMemoryBuffers(d); err != nil {
+			return err
+		}
+		d.buffers = nil
+	}
+	_, err := v4l2.ResetBuffers(d)
+	return err
+}
+
+// reallocBuffers requests driver buffers again after releaseBuffers, reusing user pointer
+// buffers that are large enough for the current format.
+func (d *Device) reallocBuffers() error {
+	bufReq, err := v4l2.InitBuffers(d)
+	if err != nil {
+		return err
+	}
+	d.config.bufSize = bufReq.Count
+	d.requestedBuf = bufReq
+
+	if d.config.ioType != v4l2.IOTypeUserPtr {
+		d.buffers, err = v4l2.MapMemoryBuffers(d)
+		return err
+	}
+
+	size := int(d.config.pixFormat.SizeImage)
+	if len(d.buffers) == int(bufReq.Count) && size <= cap(d.buffers[0]) {
+		for i := range d.buffers {
+			d.buffers[i] = d.buffers[i][:size]
+		}
+		return nil
+	}
+	d.freeUserBuffers()
+	d.buffers, err = d.allocUserBuffers()
+	return err
+}
@@ -0,0 +1,116 @@
+package device
+
+import (
+	"sync/atomic"
+	"time"
+
+	"github.com/vladimirvivien/go4vl/h264"
+	"github.com/vladimirvivien/go4vl/v4l2"
+)
+
+// Frame is a captured frame along with information about the buffer it was captured in.
+// Frames delivered by GetFrames are reference counted: a consumer must call Release when
+// done with the frame (and Retain before handing it to another consumer). Consumers sharing
+// a frame also share the artifacts they derive from it (see Attachment).
+type Frame struct {
+	// Data holds the captured bytes
+	Data []byte
+
+	// Index of the driver buffer the frame was captured in
+	Index uint32
+
+	// Sequence is the driver's frame counter
+	Sequence uint32
+
+	// Flags are the buffer flags reported by the driver
+	Flags v4l2.BufFlag
+
+	// Timestamp is the capture time reported by the driver (clock monotonic for most drivers)
+	Timestamp time.Duration
+
+	// Input is the video input the frame was captured from
+	Input int32
+
+	// Field reports the field order of interlaced frames, or which field the frame holds
+	// when fields are delivered alternately (see v4l2.FieldAlternate)
+	Field v4l2.FieldType
+
+	// Bracket is the index of the control set the frame was captured with (see WithBracketing)
+	Bracket int
+
+	// NALs indexes the NAL units of H.264 frames (built while the frame is copied from
+	// the driver buffer)
+	NALs h264.Index
+
+	refs     int32
+	release  func(*Frame)
+	attached attachments
+}
+
+// Retain adds a reference to the frame
+func (f *Frame) Retain() {
+	atomic.AddInt32(&f.refs, 1)
+}
+
+// Release drops a reference to the frame. Once unreferenced, the frame's memory is
+// recycled and must not be accessed anymore.
+func (f *Frame) Release() {
+	switch refs := atomic.AddInt32(&f.refs, -1); {
+	case refs == 0:
+		f.attached.release()
+		if f.release != nil {
+			f.release(f)
+		}
+	case refs < 0:
+		panic("device: frame released too many times")
+	}
+}
+
+// NewFrame returns a frame holding data with a single reference, for frames that do not
+// come from a device (i.e. synthetic or recorded frames). release, if not nil, is called
+// once the frame is unreferenced.
+func NewFrame(data []byte, release func(*Frame)) *Frame {
+	return &Frame{Data: data, refs: 1, release: release}
+}
+
+// newFrame copies the content of the dequeued buffer into a new frame. The copy is drawn
+// from the configured arena when one is available, otherwise from the Go heap.
+func (d *Device) newFrame(buff v4l2.Buffer) *Frame {
+	frame := &Frame{
+		Index:     buff.Index,
+		Sequence:  buff.Sequence,
+		Flags:     buff.Flags,
+		Timestamp: time.Duration(buff.Timestamp.Nano()),
+		Input:     d.input,
+		Field:     buff.Field,
+		refs:      1,
+	}
+	if d.config.bracket.active() {
+		frame.Bracket = d.config.bracket.setOf[buff.Index]
+	}
+	src := d.buffers[buff.Index][:buff.BytesUsed]
+
+	if d.config.arena != nil && d.config.arena.SlabSize() >= len(src) {
+		if slab, err := d.config.arena.Alloc(); err == nil {
+			frame.Data = slab.Bytes()[:len(src)]
+			frame.release = func(*Frame) { slab.Release() }
+			d.copyFrame(frame, src)
+			return frame
+		}
+		// arena exhausted, fall back to heap
+	}
+
+	frame.Data = make([]byte, len(src))
+	d.copyFrame(frame, src)
+	return frame
+}
+
+// copyFrame copies src into the frame data. H.264 frames are indexed during the copy,
+// so that their data is read once.
+func (d *Device) copyFrame(frame *Frame, src []byte) {
+	if d.config.pixFormat.PixelFormat == v4l2.PixelFmtH264 {
+		frame.NALs.BuildCopy(frame.Data, src)
+		return
+	}
+	copy(frame.Data, src)
+}
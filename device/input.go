@@ -0,0 +1,135 @@
+package device
+
+import (
+	"errors"
+	"fmt"
+	sys "syscall"
+	"time"
+
+	"github.com/vladimirvivien/go4vl/v4l2"
+	"golang.org/x/sys/unix"
+)
+
+// inputScan cycles a streaming device through several video inputs (round-robin),
+// switching input after a number of delivered frames. Frames captured while an input
+// switch was taking place are discarded (and their buffers queued right back).
+//
+// Inputs are switched on the fly with S_INPUT when the driver allows it. Drivers built on
+// videobuf2 (most of them, i.e. vivid) refuse S_INPUT with EBUSY as long as buffers are
+// allocated: the stream is then stopped and its buffers released around each switch (see
+// restartStream), which costs a buffer reallocation per switch but leaves no frame of the
+// previous input in the queue.
+type inputScan struct {
+	inputs   []int32
+	dwell    int // frames delivered per input
+	settle   int // frames dropped after a switch, beside those captured during the switch
+	pos      int
+	count    int
+	inflight int           // frames dropped that were queued during the switch
+	settled  int           // settle frames dropped
+	switched time.Duration // monotonic time when the last switch completed
+	restart  bool          // the driver refuses S_INPUT while buffers are allocated
+}
+
+func newInputScan(inputs []int32, dwell, settle int) *inputScan {
+	if dwell < 1 {
+		dwell = 1
+	}
+	return &inputScan{inputs: inputs, dwell: dwell, settle: settle}
+}
+
+// accept reports whether the dequeued buffer belongs to the current input. When driver
+// timestamps are monotonic, only buffers that started before the switch completed are
+// dropped (plus the settle frames), otherwise every buffer that was queued during the
+// switch is dropped.
+func (s *inputScan) accept(buff v4l2.Buffer, bufCount int) bool {
+	if buff.Flags&v4l2.BufFlagTimestampMask == v4l2.BufFlagTimestampMonotonic {
+		if time.Duration(buff.Timestamp.Nano()) < s.switched {
+			return false
+		}
+	} else if s.count == 0 && s.inflight < bufCount {
+		s.inflight++
+		return false
+	}
+	if s.settled < s.settle {
+		s.settled++
+		return false
+	}
+	return true
+}
+
+// delivered counts a delivered frame and moves the device to the next input once
+// the current input had its share of frames. It is called by the stream loop, which
+// holds no buffer at that point.
+func (s *inputScan) delivered(d *Device) error {
+	s.count++
+	if s.count < s.dwell || len(s.inputs) < 2 {
+		return nil
+	}
+	s.pos = (s.pos + 1) % len(s.inputs)
+	return s.switchTo(d, s.pos, true)
+}
+
+// switchTo selects the input at pos, restarting the stream when the driver refuses to
+// switch inputs with buffers allocated
+func (s *inputScan) switchTo(d *Device, pos int, streaming bool) error {
+	input := s.inputs[pos]
+	var err error
+	if !streaming || !s.restart {
+		err = d.SetVideoInput(input)
+		s.restart = streaming && errors.Is(err, sys.EBUSY)
+	}
+	if s.restart {
+		err = d.restartStream(func() error { return d.SetVideoInput(input) })
+	}
+	if err != nil {
+		return fmt.Errorf("input scan: %w", err)
+	}
+	s.count, s.inflight, s.settled = 0, 0, 0
+	if s.restart {
+		// no buffer queued before the switch is left to drop
+		s.switched, s.inflight = 0, len(d.buffers)
+		return nil
+	}
+	var now unix.Timespec
+	if err := unix.ClockGettime(unix.CLOCK_MONOTONIC, &now); err == nil {
+		s.switched = time.Duration(now.Nano())
+	}
+	return nil
+}
+
+// restartStream applies change with the stream stopped and its buffers released, as drivers
+// built on videobuf2 refuse input (and format) changes while buffers are allocated. Buffers
+// are then allocated (and mapped) again for the current format, and the stream restarted,
+// also when change fails, so that capture goes on with the previous settings. A paused
+// stream is restarted on Resume. It must not be called while the stream loop holds a
+// buffer.
+func (d *Device) restartStream(change func() error) error {
+	d.standby.mu.Lock()
+	defer d.standby.mu.Unlock()
+	if !d.standby.paused {
+		if err := v4l2.StreamOff(d); err != nil {
+			return err
+		}
+	}
+	if err := d.releaseBuffers(); err != nil {
+		return err
+	}
+	changeErr := change()
+	if pixFmt, err := v4l2.GetPixFormat(d.fd); err == nil {
+		d.config.pixFormat = pixFmt // the format may follow the input
+	}
+	if err := d.reallocBuffers(); err != nil {
+		return err
+	}
+	d.standby.reset(len(d.buffers))
+	if !d.standby.paused {
+		if err := d.queueFree(); err != nil {
+			return err
+		}
+		if err := v4l2.StreamOn(d); err != nil {
+			return err
+		}
+	}
+	return changeErr
+}
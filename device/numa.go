@@ -0,0 +1,131 @@
+package device
+
+import (
+	"fmt"
+	"os"
+	"path/filepath"
+	"regexp"
+	"runtime"
+	"strconv"
+	"strings"
+
+	"github.com/vladimirvivien/go4vl/arena"
+	"golang.org/x/sys/unix"
+)
+
+var (
+	sysfsRoot = "/sys"
+
+	// pciAddrPattern matches a PCI address in bus_info (i.e. "PCI:0000:03:00.0", "usb-0000:00:14.0-1")
+	pciAddrPattern = regexp.MustCompile(`[0-9a-fA-F]{4}:[0-9a-fA-F]{2}:[0-9a-fA-F]{2}\.[0-7]`)
+)
+
+// GetNUMANode returns the NUMA node the device is attached to, or -1 when the
+// device (or system) has no node affinity.
+func (d *Device) GetNUMANode() (int, error) {
+	node, err := NUMANodeOf(d.cap.BusInfo)
+	if err == nil {
+		return node, nil
+	}
+	// fallback to the device's sysfs tree (i.e. platform devices)
+	return numaNodeOfPath(filepath.Join(sysfsRoot, "class/video4linux", filepath.Base(d.path), "device"))
+}
+
+// newLocalArena creates an arena placed on the device's NUMA node when it is known
+func (d *Device) newLocalArena(size, count int) (*arena.Arena, error) {
+	if node, err := d.GetNUMANode(); err == nil && node >= 0 {
+		if a, err := arena.New(size, count, arena.WithNode(node)); err == nil {
+			return a, nil
+		}
+	}
+	return arena.New(size, count)
+}
+
+// NUMANodeOf returns the NUMA node of the PCI device (capture card or USB host controller)
+// named in the specified V4L2 bus_info, or -1 when there is no node affinity.
+func NUMANodeOf(busInfo string) (int, error) {
+	addr := pciAddrPattern.FindString(busInfo)
+	if addr == "" {
+		return -1, fmt.Errorf("numa node: bus info %q: no pci address", busInfo)
+	}
+	return readNUMANode(filepath.Join(sysfsRoot, "bus/pci/devices", strings.ToLower(addr), "numa_node"))
+}
+
+// numaNodeOfPath walks up the sysfs device tree from path until a numa_node attribute is found
+func numaNodeOfPath(path string) (int, error) {
+	dir, err := filepath.EvalSymlinks(path)
+	if err != nil {
+		return -1, fmt.Errorf("numa node: %w", err)
+	}
+	for ; dir != sysfsRoot && dir != "/" && dir != "."; dir = filepath.Dir(dir) {
+		if node, err := readNUMANode(filepath.Join(dir, "numa_node")); err == nil {
+			return node, nil
+		}
+	}
+	return -1, nil
+}
+
+func readNUMANode(file string) (int, error) {
+	data, err := os.ReadFile(file)
+	if err != nil {
+		return -1, fmt.Errorf("numa node: %w", err)
+	}
+	node, err := strconv.Atoi(strings.TrimSpace(string(data)))
+	if err != nil {
+		return -1, fmt.Errorf("numa node: %s: %w", file, err)
+	}
+	return node, nil
+}
+
+// NUMANodeCPUs returns the CPUs local to the specified NUMA node
+func NUMANodeCPUs(node int) ([]int, error) {
+	data, err := os.ReadFile(filepath.Join(sysfsRoot, fmt.Sprintf("devices/system/node/node%d/cpulist", node)))
+	if err != nil {
+		return nil, fmt.Errorf("numa cpus: %w", err)
+	}
+	return parseCPUList(strings.TrimSpace(string(data)))
+}
+
+// parseCPUList parses the sysfs cpu list format (i.e. "0-7,16-23")
+func parseCPUList(list string) ([]int, error) {
+	var cpus []int
+	for _, item := range strings.Split(list, ",") {
+		if item == "" {
+			continue
+		}
+		bounds := strings.SplitN(item, "-", 2)
+		first, err := strconv.Atoi(bounds[0])
+		if err != nil {
+			return nil, fmt.Errorf("cpu list %q: %w", list, err)
+		}
+		last := first
+		if len(bounds) == 2 {
+			if last, err = strconv.Atoi(bounds[1]); err != nil {
+				return nil, fmt.Errorf("cpu list %q: %w", list, err)
+			}
+		}
+		for cpu := first; cpu <= last; cpu++ {
+			cpus = append(cpus, cpu)
+		}
+	}
+	return cpus, nil
+}
+
+// bindThreadToNode locks the calling goroutine to its OS thread and restricts
+// that thread to the CPUs of the specified NUMA node.
+func bindThreadToNode(node int) error {
+	cpus, err := NUMANodeCPUs(node)
+	if err != nil {
+		return err
+	}
+	var set unix.CPUSet
+	for _, cpu := range cpus {
+		set.Set(cpu)
+	}
+	runtime.LockOSThread()
+	if err := unix.SchedSetaffinity(0, &set); err != nil {
+		runtime.UnlockOSThread()
+		return fmt.Errorf("numa bind thread: node %d: %w", node, err)
+	}
+	return nil
+}
@@ -0,0 +1,36 @@
+package device
+
+import (
+	"fmt"
+	"testing"
+
+	"github.com/vladimirvivien/go4vl/arena"
+)
+
+// BenchmarkNUMACopy compares frame copy throughput from a thread bound to node 0
+// with frame memory local to node 0 against memory on a remote node.
+func BenchmarkNUMACopy(b *testing.B) {
+	if _, err := NUMANodeCPUs(1); err != nil {
+		b.Skip("single NUMA node system")
+	}
+	const frameSize = 1920 * 1080 * 4
+	for _, node := range []int{0, 1} {
+		b.Run(fmt.Sprintf("thread=0/memory=%d", node), func(b *testing.B) {
+			if err := bindThreadToNode(0); err != nil {
+				b.Skip(err)
+			}
+			a, err := arena.New(frameSize, 2, arena.WithNode(node))
+			if err != nil {
+				b.Skip(err)
+			}
+			defer a.Close()
+			src, _ := a.Alloc()
+			dst, _ := a.Alloc()
+			b.SetBytes(frameSize)
+			b.ResetTimer()
+			for i := 0; i < b.N; i++ {
+				copy(dst.Bytes(), src.Bytes())
+			}
+		})
+	}
+}
@@ -0,0 +1,96 @@
+package device
+
+import (
+	"context"
+	"errors"
+	"fmt"
+	"os"
+	sys "syscall"
+	"time"
+
+	"github.com/vladimirvivien/go4vl/v4l2"
+	"golang.org/x/sys/unix"
+)
+
+// errWaitTimeout is returned by a dequeueFunc when no buffer was ready before the wait timeout
+var errWaitTimeout = errors.New("wait timeout")
+
+// errEventPending is returned by a dequeueFunc when V4L2 events are pending (POLLPRI). The
+// io_uring backend polls for POLLPRI along with the buffers. The Go runtime poller does not
+// watch POLLPRI: with it, pending events are looked for with a poll(2) that does not wait
+// before each dequeue, and when the wait times out (no frame arrives).
+var errEventPending = errors.New("events pending")
+
+// dequeueFunc blocks until the next buffer is dequeued from the driver.
+type dequeueFunc func() (v4l2.Buffer, error)
+
+// newDequeuer returns the dequeue func used by the stream loop along with a
+// func to release any resource held while waiting. When timeout is not zero, a wait that
+// lasts longer than timeout returns errWaitTimeout.
+func (d *Device) newDequeuer(ctx context.Context, timeout time.Duration) (dequeueFunc, func(), error) {
+	if d.config.uring != nil {
+		next, closeWait, err := d.uringDequeuer(ctx, d.config.uring, timeout)
+		if err == nil {
+			return next, closeWait, nil
+		}
+		// ring closed or full: fall back to runtime poller
+	}
+	return d.netpollDequeuer(ctx, timeout)
+}
+
+// netpollDequeuer dequeues buffers using the fd registered with the Go runtime poller.
+// Dequeue is attempted first, the goroutine is only parked (until the fd is readable)
+// when the driver reports EAGAIN. When the device watches source changes, each dequeue
+// first checks for pending events (see errEventPending).
+func (d *Device) netpollDequeuer(ctx context.Context, timeout time.Duration) (dequeueFunc, func(), error) {
+	rawConn, err := d.file.SyscallConn()
+	if err != nil {
+		return nil, nil, err
+	}
+	// reset deadline, this also fails when the fd could not be registered with the poller
+	if err := d.file.SetReadDeadline(time.Time{}); err != nil {
+		return nil, nil, fmt.Errorf("fd not pollable: %w", err)
+	}
+
+	// wake up a parked dequeue when the context is cancelled
+	done := make(chan struct{})
+	go func() {
+		select {
+		case <-ctx.Done():
+			d.file.SetReadDeadline(time.Now())
+		case <-done:
+		}
+	}()
+
+	var buff v4l2.Buffer
+	var dqErr error
+	ioMemType := d.MemIOType()
+	bufType := d.BufferType()
+	watch := d.watchSource
+	pri := []unix.PollFd{{Events: unix.POLLPRI}}
+	dequeue := func(fd uintptr) bool {
+		if watch {
+			pri[0].Fd, pri[0].Revents = int32(fd), 0
+			if n, err := unix.Poll(pri, 0); err == nil && n > 0 && pri[0].Revents&unix.POLLPRI != 0 {
+				buff, dqErr = v4l2.Buffer{}, errEventPending
+				return true
+			}
+		}
+		buff, dqErr = d.dequeueBuffer(fd, ioMemType, bufType)
+		return !errors.Is(dqErr, sys.EAGAIN)
+	}
+
+	next := func() (v4l2.Buffer, error) {
+		if timeout > 0 && ctx.Err() == nil {
+			d.file.SetReadDeadline(time.Now().Add(timeout))
+		}
+		if err := rawConn.Read(dequeue); err != nil {
+			if errors.Is(err, os.ErrDeadlineExceeded) && ctx.Err() == nil {
+				return v4l2.Buffer{}, errWaitTimeout
+			}
+			return v4l2.Buffer{}, err
+		}
+		return buff, dqErr
+	}
+	return next, func() { close(done) }, nil
+}
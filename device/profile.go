@@ -0,0 +1,276 @@
+package device
+
+import (
+	"encoding/json"
+	"errors"
+	"fmt"
+	"hash/fnv"
+	"io/ioutil"
+	"os"
+	"path/filepath"
+	"sync"
+
+	"github.com/vladimirvivien/go4vl/v4l2"
+)
+
+// Profile holds everything a driver reports about a device that does not change between
+// opens: capabilities, cropping bounds, formats with their frame sizes and intervals, and
+// controls with their menus. Profiles are keyed by driver, card, bus info and driver version
+// (see ProfileCache).
+type Profile struct {
+	Driver             string
+	Card               string
+	BusInfo            string
+	Version            uint32
+	Capabilities       uint32
+	DeviceCapabilities uint32
+
+	// Cropping is set when the device supports cropping (CropCap is valid)
+	Cropping bool
+	CropCap  v4l2.CropCapability
+
+	Formats  []FormatProfile
+	Controls []ControlProfile
+}
+
+// FormatProfile is a format description with its supported frame sizes
+type FormatProfile struct {
+	v4l2.FormatDescription
+	Sizes []SizeProfile
+}
+
+// SizeProfile is a frame size with its supported frame intervals. For stepwise
+// and continuous sizes, intervals are those reported for the largest size.
+type SizeProfile struct {
+	v4l2.FrameSizeEnum
+	Intervals []v4l2.FrameIntervalEnum
+}
+
+// ControlProfile is a control description (Value is the default value) with its menu items
+type ControlProfile struct {
+	v4l2.Control
+	Menu []v4l2.ControlMenuItem
+}
+
+// matches reports whether the profile was built for the device with capability cap
+func (p *Profile) matches(cap v4l2.Capability) bool {
+	return p.Driver == cap.Driver && p.Card == cap.Card && p.BusInfo == cap.BusInfo &&
+		p.Version == cap.Version && p.DeviceCapabilities == cap.DeviceCapabilities
+}
+
+// FormatDescriptions returns the format descriptions held by the profile
+func (p *Profile) FormatDescriptions() []v4l2.FormatDescription {
+	descs := make([]v4l2.FormatDescription, len(p.Formats))
+	for i := range p.Formats {
+		descs[i] = p.Formats[i].FormatDescription
+	}
+	return descs
+}
+
+// FrameSizes returns the frame sizes held by the profile for encoding
+func (p *Profile) FrameSizes(encoding v4l2.FourCCType) []v4l2.FrameSizeEnum {
+	for _, f := range p.Formats {
+		if f.PixelFormat != encoding {
+			continue
+		}
+		sizes := make([]v4l2.FrameSizeEnum, len(f.Sizes))
+		for i := range f.Sizes {
+			sizes[i] = f.Sizes[i].FrameSizeEnum
+		}
+		return sizes
+	}
+	return nil
+}
+
+// FrameIntervals returns the frame intervals held by the profile for encoding at the
+// specified frame size
+func (p *Profile) FrameIntervals(encoding v4l2.FourCCType, width, height uint32) []v4l2.FrameIntervalEnum {
+	for _, f := range p.Formats {
+		if f.PixelFormat != encoding {
+			continue
+		}
+		for _, s := range f.Sizes {
+			if sizeContains(s.Size, width, height) {
+				return s.Intervals
+			}
+		}
+	}
+	return nil
+}
+
+// Menu returns the menu items held by the profile for control id
+func (p *Profile) Menu(id v4l2.CtrlID) []v4l2.ControlMenuItem {
+	for _, c := range p.Controls {
+		if c.ID == id {
+			return c.Menu
+		}
+	}
+	return nil
+}
+
+func sizeContains(s v4l2.FrameSize, width, height uint32) bool {
+	if width < s.MinWidth || width > s.MaxWidth || height < s.MinHeight || height > s.MaxHeight {
+		return false
+	}
+	return (s.StepWidth == 0 || (width-s.MinWidth)%s.StepWidth == 0) &&
+		(s.StepHeight == 0 || (height-s.MinHeight)%s.StepHeight == 0)
+}
+
+// probeProfile enumerates the device once to build its profile
+func probeProfile(fd uintptr, cap v4l2.Capability, bufType v4l2.BufType) (*Profile, error) {
+	p := &Profile{
+		Driver:             cap.Driver,
+		Card:               cap.Card,
+		BusInfo:            cap.BusInfo,
+		Version:            cap.Version,
+		Capabilities:       cap.Capabilities,
+		DeviceCapabilities: cap.DeviceCapabilities,
+	}
+	if cropCap, err := v4l2.GetCropCapability(fd, bufType); err == nil {
+		p.Cropping, p.CropCap = true, cropCap
+	}
+
+	descs, err := v4l2.GetAllFormatDescriptions(fd)
+	if err != nil && len(descs) == 0 {
+		return nil, fmt.Errorf("device: profile: %w", err)
+	}
+	for _, desc := range descs {
+		format := FormatProfile{FormatDescription: desc}
+		sizes, _ := v4l2.GetFormatFrameSizes(fd, desc.PixelFormat)
+		for _, size := range sizes {
+			// stepwise intervals are the same at any size; the largest is the one users want
+			intervals, _ := v4l2.GetFormatFrameIntervals(fd, desc.PixelFormat, size.Size.MaxWidth, size.Size.MaxHeight)
+			format.Sizes = append(format.Sizes, SizeProfile{FrameSizeEnum: size, Intervals: intervals})
+		}
+		p.Formats = append(p.Formats, format)
+	}
+
+	ctrls, _ := v4l2.QueryAllControls(fd)
+	for _, ctrl := range ctrls {
+		ctrl.Value = ctrl.Default
+		control := ControlProfile{Control: ctrl}
+		if ctrl.IsMenu() {
+			control.Menu, _ = ctrl.GetMenuItems()
+		}
+		p.Controls = append(p.Controls, control)
+	}
+	return p, nil
+}
+
+// ProfileCache persists device profiles in a directory, one JSON file per device, so that
+// reopening a known device (see WithProfileCache) skips enumeration. Profiles are validated
+// against the capability reported by the device on open; a driver update or a device moved
+// to another bus is probed again. A ProfileCache can be shared by any number of devices.
+type ProfileCache struct {
+	dir      string
+	mu       sync.Mutex
+	profiles map[string]*Profile
+}
+
+// NewProfileCache returns a cache that stores profiles in dir (created if needed)
+func NewProfileCache(dir string) (*ProfileCache, error) {
+	if err := os.MkdirAll(dir, 0o755); err != nil {
+		return nil, fmt.Errorf("device: profile cache: %w", err)
+	}
+	return &ProfileCache{dir: dir, profiles: make(map[string]*Profile)}, nil
+}
+
+// profileFile returns the file name of the profile for the device with capability cap
+func profileFile(cap v4l2.Capability) string {
+	h := fnv.New64a()
+	fmt.Fprintf(h, "%s\x00%s\x00%s\x00%d", cap.Driver, cap.Card, cap.BusInfo, cap.Version)
+	return fmt.Sprintf("%016x.json", h.Sum64())
+}
+
+// Load returns the cached profile for the device with capability cap, if any
+func (c *ProfileCache) Load(cap v4l2.Capability) (*Profile, bool) {
+	name := profileFile(cap)
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	if p, ok := c.profiles[name]; ok && p.matches(cap) {
+		return p, true
+	}
+
+	data, err := ioutil.ReadFile(filepath.Join(c.dir, name))
+	if err != nil {
+		return nil, false
+	}
+	p := new(Profile)
+	if err := json.Unmarshal(data, p); err != nil || !p.matches(cap) {
+		return nil, false
+	}
+	c.profiles[name] = p
+	return p, true
+}
+
+// Save stores profile p, replacing any previous profile for the same device
+func (c *ProfileCache) Save(p *Profile) error {
+	if p == nil {
+		return errors.New("device: profile cache: nil profile")
+	}
+	name := profileFile(v4l2.Capability{Driver: p.Driver, Card: p.Card, BusInfo: p.BusInfo, Version: p.Version})
+	data, err := json.Marshal(p)
+	if err != nil {
+		return fmt.Errorf("device: profile cache: %w", err)
+	}
+
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	// write then rename, so that concurrent opens never read a partial profile
+	tmp, err := ioutil.TempFile(c.dir, name+".*")
+	if err != nil {
+		return fmt.Errorf("device: profile cache: %w", err)
+	}
+	if _, err := tmp.Write(data); err != nil {
+		tmp.Close()
+		os.Remove(tmp.Name())
+		return fmt.Errorf("device: profile cache: %w", err)
+	}
+	if err := tmp.Close(); err != nil {
+		os.Remove(tmp.Name())
+		return fmt.Errorf("device: profile cache: %w", err)
+	}
+	if err := os.Rename(tmp.Name(), filepath.Join(c.dir, name)); err != nil {
+		os.Remove(tmp.Name())
+		return fmt.Errorf("device: profile cache: %w", err)
+	}
+	c.profiles[name] = p
+	return nil
+}
+
+// Profile returns the device profile, served from the profile cache when the device was
+// opened with WithProfileCache, or enumerated from the device (once) otherwise.
+func (d *Device) Profile() (*Profile, error) {
+	if d.profile != nil {
+		return d.profile, nil
+	}
+	p, err := probeProfile(d.fd, d.cap, d.bufType)
+	if err != nil {
+		return nil, err
+	}
+	d.profile = p
+	if d.config.profiles != nil {
+		if err := d.config.profiles.Save(p); err != nil {
+			return p, err
+		}
+	}
+	return p, nil
+}
+
+// GetFormatFrameSizes returns all supported frame sizes for the specified encoding
+func (d *Device) GetFormatFrameSizes(encoding v4l2.FourCCType) ([]v4l2.FrameSizeEnum, error) {
+	if d.profile != nil {
+		return d.profile.FrameSizes(encoding), nil
+	}
+	return v4l2.GetFormatFrameSizes(d.fd, encoding)
+}
+
+// GetFormatFrameIntervals returns all supported frame intervals for the specified encoding and frame size
+func (d *Device) GetFormatFrameIntervals(encoding v4l2.FourCCType, width, height uint32) ([]v4l2.FrameIntervalEnum, error) {
+	if d.profile != nil {
+		if intervals := d.profile.FrameIntervals(encoding, width, height); intervals != nil {
+			return intervals, nil
+		}
+	}
+	return v4l2.GetFormatFrameIntervals(d.fd, encoding, width, height)
+}
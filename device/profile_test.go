@@ -0,0 +1,59 @@
+package device
+
+import (
+	"io/ioutil"
+	"os"
+	"testing"
+
+	"github.com/vladimirvivien/go4vl/v4l2"
+)
+
+func TestProfileCache(t *testing.T) {
+	dir, err := ioutil.TempDir("", "profiles")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer os.RemoveAll(dir)
+
+	cap := v4l2.Capability{Driver: "uvcvideo", Card: "cam", BusInfo: "usb-0000:00:14.0-1", Version: 0x050f00}
+	p := &Profile{Driver: cap.Driver, Card: cap.Card, BusInfo: cap.BusInfo, Version: cap.Version, Cropping: true}
+	p.CropCap.DefaultRect = v4l2.Rect{Width: 640, Height: 480}
+	p.Formats = []FormatProfile{{
+		FormatDescription: v4l2.FormatDescription{PixelFormat: v4l2.PixelFmtMJPEG},
+		Sizes: []SizeProfile{{
+			FrameSizeEnum: v4l2.FrameSizeEnum{Size: v4l2.FrameSize{MinWidth: 640, MaxWidth: 640, MinHeight: 480, MaxHeight: 480}},
+			Intervals:     []v4l2.FrameIntervalEnum{{Interval: v4l2.FrameInterval{Min: v4l2.Fract{Numerator: 1, Denominator: 30}}}},
+		}},
+	}}
+	p.Controls = []ControlProfile{{Control: v4l2.Control{ID: v4l2.CtrlPowerlineFrequency, Type: v4l2.CtrlTypeMenu}, Menu: []v4l2.ControlMenuItem{{Name: "50 Hz"}}}}
+
+	cache, err := NewProfileCache(dir)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if err := cache.Save(p); err != nil {
+		t.Fatal(err)
+	}
+
+	// a new cache reads from disk
+	cache, _ = NewProfileCache(dir)
+	loaded, ok := cache.Load(cap)
+	if !ok {
+		t.Fatal("profile not found")
+	}
+	if loaded.CropCap.DefaultRect != p.CropCap.DefaultRect || len(loaded.FrameSizes(v4l2.PixelFmtMJPEG)) != 1 {
+		t.Fatalf("unexpected profile: %+v", loaded)
+	}
+	if got := loaded.FrameIntervals(v4l2.PixelFmtMJPEG, 640, 480); len(got) != 1 || got[0].Interval.Min.Denominator != 30 {
+		t.Fatalf("unexpected intervals: %+v", got)
+	}
+	if got := loaded.Menu(v4l2.CtrlPowerlineFrequency); len(got) != 1 || got[0].Name != "50 Hz" {
+		t.Fatalf("unexpected menu: %+v", got)
+	}
+
+	// a driver update invalidates the profile
+	cap.Version++
+	if _, ok := cache.Load(cap); ok {
+		t.Fatal("stale profile loaded")
+	}
+}
@@ -0,0 +1,52 @@
+package device
+
+import (
+	"fmt"
+
+	"github.com/vladimirvivien/go4vl/v4l2"
+)
+
+// GetStandard returns the analog video standard (i.e. PAL, NTSC) selected for the current input
+func (d *Device) GetStandard() (v4l2.StandardId, error) {
+	std, err := v4l2.GetStandard(d.fd)
+	if err != nil {
+		return 0, fmt.Errorf("device: %w", err)
+	}
+	return std, nil
+}
+
+// QueryStandard returns the set of analog video standards matching the signal on the current input
+func (d *Device) QueryStandard() (v4l2.StandardId, error) {
+	std, err := v4l2.QueryStandard(d.fd)
+	if err != nil {
+		return 0, fmt.Errorf("device: %w", err)
+	}
+	return std, nil
+}
+
+// GetStandards returns the analog video standards supported by the current input
+func (d *Device) GetStandards() ([]v4l2.Standard, error) {
+	stds, err := v4l2.GetAllStandards(d.fd)
+	if err != nil {
+		return nil, fmt.Errorf("device: %w", err)
+	}
+	return stds, nil
+}
+
+// SetStandard selects the analog video standard of the current input. The standard
+// determines the frame size and rate, so it must be set before streaming is started;
+// the device pixel format is refreshed accordingly.
+func (d *Device) SetStandard(std v4l2.StandardId) error {
+	if d.streaming {
+		return fmt.Errorf("device: set standard: stream already started")
+	}
+	if err := v4l2.SetStandard(d.fd, std); err != nil {
+		return fmt.Errorf("device: %w", err)
+	}
+	pixFmt, err := v4l2.GetPixFormat(d.fd)
+	if err != nil {
+		return fmt.Errorf("device: set standard: %w", err)
+	}
+	d.config.pixFormat = pixFmt
+	return nil
+}
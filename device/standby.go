@@ -0,0 +1,224 @@
+package device
+
+import (
+	"errors"
+	"fmt"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/vladimirvivien/go4vl/v4l2"
+)
+
+// StartupLatency breaks down the time it took to get the first frame out of the device
+type StartupLatency struct {
+	// Open stages: open and capability query, crop reset, format and frame rate setup
+	Open      time.Duration
+	Crop      time.Duration
+	Format    time.Duration
+	FrameRate time.Duration
+
+	// Start (or Resume) stages: buffer allocation and mapping, buffer queueing and stream on,
+	// and the wait for the first frame
+	Buffers    time.Duration
+	StreamOn   time.Duration
+	FirstFrame time.Duration
+}
+
+// Total returns the sum of all stages
+func (l StartupLatency) Total() time.Duration {
+	return l.Open + l.Crop + l.Format + l.FrameRate + l.Buffers + l.StreamOn + l.FirstFrame
+}
+
+// Restart returns the time from Start (or Resume) to the first frame. After Resume, it is
+// the failover time of a camera in warm standby.
+func (l StartupLatency) Restart() time.Duration {
+	return l.Buffers + l.StreamOn + l.FirstFrame
+}
+
+func (l StartupLatency) String() string {
+	var b strings.Builder
+	fmt.Fprintf(&b, "total %v (open %v, crop %v, format %v, frame rate %v, ", l.Total(), l.Open, l.Crop, l.Format, l.FrameRate)
+	fmt.Fprintf(&b, "buffers %v, stream on %v, first frame %v)", l.Buffers, l.StreamOn, l.FirstFrame)
+	return b.String()
+}
+
+// latency records the startup stages of the device
+type latency struct {
+	StartupLatency
+	mark       time.Time
+	streamOnAt time.Time
+	firstFrame int64 // time to first frame (ns), set by the stream loop
+}
+
+// lap returns the time elapsed since the last lap
+func (l *latency) lap() time.Duration {
+	now := time.Now()
+	elapsed := now.Sub(l.mark)
+	l.mark = now
+	return elapsed
+}
+
+// streamOn marks the time the stream was (re)started, and resets the first frame wait
+func (l *latency) streamOn() {
+	l.streamOnAt = time.Now()
+	atomic.StoreInt64(&l.firstFrame, 0)
+}
+
+// frameCaptured records the wait for the first frame since the stream was started
+func (l *latency) frameCaptured() {
+	if atomic.LoadInt64(&l.firstFrame) == 0 {
+		atomic.CompareAndSwapInt64(&l.firstFrame, 0, int64(time.Since(l.streamOnAt)))
+	}
+}
+
+// StartupLatency returns the time spent in each stage from Open to the first captured
+// frame (the start stages are those of the last Start or Resume)
+func (d *Device) StartupLatency() StartupLatency {
+	l := d.latency.StartupLatency
+	l.FirstFrame = time.Duration(atomic.LoadInt64(&d.latency.firstFrame))
+	return l
+}
+
+// errors reported by dequeueBuffer once the stream is paused, or stopped
+var (
+	errPaused  = errors.New("stream paused")
+	errStopped = errors.New("stream stopped")
+)
+
+// standby holds the paused state of a stream in warm standby, and the buffers held by the
+// stream loop (dequeued and not queued back yet), which Resume must not queue.
+type standby struct {
+	mu      sync.Mutex
+	paused  bool
+	resume  chan struct{} // closed on Resume (or Stop)
+	held    []bool
+	stopped bool
+}
+
+// reset clears the held state of n buffers
+func (s *standby) reset(n int) {
+	s.held = make([]bool, n)
+}
+
+// Pause stops the stream but keeps the device configured with its buffers allocated and
+// mapped (warm standby), so that Resume delivers frames again within a few frame periods,
+// without the setup cost of Start (StartupLatency().Restart() reports the time it took).
+// The stream loop (and its output channel) stays open.
+func (d *Device) Pause() error {
+	d.standby.mu.Lock()
+	defer d.standby.mu.Unlock()
+	if !d.streaming {
+		return fmt.Errorf("device: pause: stream not started")
+	}
+	if d.standby.paused {
+		return nil
+	}
+	// set before stream off, as it makes the pending wait of the stream loop fail
+	d.standby.paused = true
+	d.standby.resume = make(chan struct{})
+	// stream off returns all buffers to the application
+	if err := v4l2.StreamOff(d); err != nil {
+		d.standby.paused = false
+		return fmt.Errorf("device: pause: %w", err)
+	}
+	return nil
+}
+
+// Resume restarts a stream paused with Pause
+func (d *Device) Resume() error {
+	d.standby.mu.Lock()
+	defer d.standby.mu.Unlock()
+	if !d.standby.paused {
+		return nil
+	}
+	d.latency.mark = time.Now()
+	d.latency.Buffers = 0
+	if err := d.queueFree(); err != nil {
+		return fmt.Errorf("device: resume: %w", err)
+	}
+	if err := v4l2.StreamOn(d); err != nil {
+		return fmt.Errorf("device: resume: %w", err)
+	}
+	d.latency.StreamOn = d.latency.lap()
+	d.latency.streamOn()
+	d.standby.paused = false
+	close(d.standby.resume)
+	return nil
+}
+
+// IsPaused returns true when the stream is in warm standby (see Pause)
+func (d *Device) IsPaused() bool {
+	d.standby.mu.Lock()
+	defer d.standby.mu.Unlock()
+	return d.standby.paused
+}
+
+// queueFree queues the buffers not held by the stream loop after a stream off, which
+// returned all buffers to the application. Must be called with standby.mu held.
+func (d *Device) queueFree() error {
+	for i := range d.buffers {
+		if i < len(d.standby.held) && d.standby.held[i] {
+			continue // queued by the stream loop once done with it
+		}
+		if err := d.queueBuffer(uint32(i)); err != nil {
+			return err
+		}
+	}
+	return nil
+}
+
+// dequeueBuffer dequeues a filled buffer, which is held by the stream loop until requeue.
+// Dequeuing is checked against Pause and Stop atomically: once the stream is paused (or
+// stopped), errPaused (or errStopped) is reported instead of the error of the driver,
+// even when the stream is resumed right after.
+func (d *Device) dequeueBuffer(fd uintptr, ioMemType v4l2.IOType, bufType v4l2.BufType) (v4l2.Buffer, error) {
+	d.standby.mu.Lock()
+	defer d.standby.mu.Unlock()
+	switch {
+	case d.standby.stopped:
+		return v4l2.Buffer{}, errStopped
+	case d.standby.paused:
+		return v4l2.Buffer{}, errPaused
+	}
+	buff, err := v4l2.DequeueBuffer(fd, ioMemType, bufType)
+	if err != nil {
+		return buff, err
+	}
+	if int(buff.Index) < len(d.standby.held) {
+		d.standby.held[buff.Index] = true
+	}
+	return buff, nil
+}
+
+// requeue gives the buffer held by the stream loop back to the driver, unless the stream
+// is paused (it is queued again on Resume)
+func (d *Device) requeue(index uint32) error {
+	d.standby.mu.Lock()
+	defer d.standby.mu.Unlock()
+	if int(index) < len(d.standby.held) {
+		d.standby.held[index] = false
+	}
+	if d.standby.paused {
+		return nil
+	}
+	return d.queueBuffer(index)
+}
+
+// waitResume blocks the stream loop while the stream is paused. It returns false if the
+// stream ended instead of resuming.
+func (d *Device) waitResume(done <-chan struct{}) bool {
+	d.standby.mu.Lock()
+	paused, resume := d.standby.paused, d.standby.resume
+	d.standby.mu.Unlock()
+	if !paused {
+		return true
+	}
+	select {
+	case <-resume:
+		return d.streaming
+	case <-done:
+		return false
+	}
+}
@@ -0,0 +1,164 @@
+package device
+
+import (
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/vladimirvivien/go4vl/v4l2"
+)
+
+// Subscription receives the frames of a device stream decimated to a target frame rate
+// (see Device.Subscribe). Frames are reference counted, and must be released by the
+// subscriber (see Frame.Release).
+type Subscription struct {
+	frames  chan *Frame
+	pace    pacer
+	dropped uint64
+	closed  bool
+}
+
+// Frames returns the channel on which the subscription receives frames. The channel is
+// closed when the stream stops or the subscription is cancelled.
+func (s *Subscription) Frames() <-chan *Frame {
+	return s.frames
+}
+
+// Dropped returns the number of paced frames that could not be delivered because the
+// subscriber did not keep up (its channel was full).
+func (s *Subscription) Dropped() uint64 {
+	return atomic.LoadUint64(&s.dropped)
+}
+
+// pacer decimates a stream of capture timestamps to a target interval. Deadlines advance
+// by exactly one interval per accepted frame (instead of being reset from the accepted
+// frame's timestamp), so rounding errors do not accumulate into drift: over time, the
+// delivered rate converges to the target rate for any source rate above it.
+type pacer struct {
+	interval time.Duration
+	next     time.Duration
+	started  bool
+}
+
+// due reports whether the frame captured at ts should be delivered. A frame is due when it
+// is the closest source frame to the next deadline, i.e. when it was captured less than
+// half a source period before it.
+func (p *pacer) due(ts, srcPeriod time.Duration) bool {
+	if p.interval == 0 {
+		return true
+	}
+	if !p.started {
+		p.started = true
+		p.next = ts + p.interval
+		return true
+	}
+	if ts+srcPeriod/2 < p.next {
+		return false
+	}
+	p.next += p.interval
+	if p.next <= ts {
+		// fell behind (i.e. the source stalled), restart the cadence instead of bursting
+		p.next = ts + p.interval
+	}
+	return true
+}
+
+// subscribers is the set of subscriptions fed by the stream loop
+type subscribers struct {
+	mu     sync.Mutex
+	subs   []*Subscription
+	last   time.Duration // timestamp of the previous frame
+	period time.Duration // smoothed source frame period
+}
+
+// Subscribe adds a subscriber receiving the device stream decimated to fps frames per
+// second (0 receives every frame), using the capture timestamps of the frames. The
+// subscription buffers up to depth frames (at least one, as frames are delivered without
+// blocking the stream loop); frames are dropped for a subscriber that falls further behind.
+// Subscriptions are fed when the device is opened with WithSubscriptions, and may be added
+// before or while streaming.
+func (d *Device) Subscribe(fps float64, depth int) *Subscription {
+	if depth < 1 {
+		depth = 1
+	}
+	sub := &Subscription{frames: make(chan *Frame, depth)}
+	if fps > 0 {
+		sub.pace.interval = time.Duration(float64(time.Second) / fps)
+	}
+	d.subs.mu.Lock()
+	d.subs.subs = append(d.subs.subs, sub)
+	d.subs.mu.Unlock()
+	return sub
+}
+
+// Unsubscribe removes the subscription from the device, closes its channel and releases
+// the frames still pending in it.
+func (d *Device) Unsubscribe(sub *Subscription) {
+	d.subs.mu.Lock()
+	defer d.subs.mu.Unlock()
+	for i, s := range d.subs.subs {
+		if s == sub {
+			d.subs.subs = append(d.subs.subs[:i], d.subs.subs[i+1:]...)
+			break
+		}
+	}
+	if !sub.closed {
+		sub.closed = true
+		close(sub.frames)
+	}
+	for frame := range sub.frames {
+		frame.Release()
+	}
+}
+
+// deliver hands the dequeued buffer to the subscribers it is due for. The buffer is copied
+// once, into a frame shared by these subscribers; when no subscriber is due, nothing is copied
+// and the buffer can be queued back right away.
+func (s *subscribers) deliver(d *Device, buff v4l2.Buffer) {
+	ts := time.Duration(buff.Timestamp.Nano())
+	s.mu.Lock()
+	defer s.mu.Unlock()
+
+	if s.last != 0 && ts > s.last {
+		if s.period == 0 {
+			s.period = ts - s.last
+		} else {
+			s.period += (ts - s.last - s.period) / 8
+		}
+	}
+	s.last = ts
+
+	var frame *Frame
+	for _, sub := range s.subs {
+		if !sub.pace.due(ts, s.period) {
+			continue
+		}
+		if frame == nil {
+			frame = d.newFrame(buff)
+		}
+		frame.Retain()
+		select {
+		case sub.frames <- frame:
+		default:
+			atomic.AddUint64(&sub.dropped, 1)
+			frame.Release()
+		}
+	}
+	if frame != nil {
+		frame.Release()
+	}
+}
+
+// close closes the channels of all subscriptions at the end of the stream
+func (s *subscribers) close() {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	for _, sub := range s.subs {
+		if !sub.closed {
+			sub.closed = true
+			close(sub.frames)
+		}
+	}
+	s.subs = nil
+	s.last, s.period = 0, 0
+}
@@ -0,0 +1,37 @@
+package device
+
+import (
+	"math/rand"
+	"testing"
+	"time"
+)
+
+func TestPacerRate(t *testing.T) {
+	tests := []struct {
+		srcFPS, fps float64
+	}{
+		{srcFPS: 30, fps: 15},
+		{srcFPS: 30, fps: 5},
+		{srcFPS: 30, fps: 25},
+		{srcFPS: 29.97, fps: 10},
+		{srcFPS: 60, fps: 24},
+	}
+	for _, test := range tests {
+		src := time.Duration(float64(time.Second) / test.srcFPS)
+		p := pacer{interval: time.Duration(float64(time.Second) / test.fps)}
+		rnd := rand.New(rand.NewSource(1))
+
+		// ten minutes of capture timestamps with up to 2ms of jitter
+		frames := int(600 * test.srcFPS)
+		delivered := 0
+		for i := 0; i < frames; i++ {
+			ts := time.Second + time.Duration(i)*src + time.Duration(rnd.Int63n(int64(4*time.Millisecond))) - 2*time.Millisecond
+			if p.due(ts, src) {
+				delivered++
+			}
+		}
+		if want := int(600 * test.fps); delivered < want-1 || delivered > want+1 {
+			t.Errorf("%v fps from %v fps: delivered %d frames, want %d", test.fps, test.srcFPS, delivered, want)
+		}
+	}
+}
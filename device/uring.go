@@ -0,0 +1,429 @@
+package device
+
+import (
+	"context"
+	"errors"
+	"fmt"
+	"sync"
+	"sync/atomic"
+	sys "syscall"
+	"time"
+	"unsafe"
+
+	"github.com/vladimirvivien/go4vl/v4l2"
+)
+
+// io_uring ABI values, see https://elixir.bootlin.com/linux/latest/source/include/uapi/linux/io_uring.h
+// (the vendored headers only cover V4L2, so the few values needed are declared here).
+const (
+	sysIOURingSetup = 425
+	sysIOURingEnter = 426
+
+	uringOffSQRing = 0
+	uringOffCQRing = 0x8000000
+	uringOffSQEs   = 0x10000000
+
+	uringFeatSingleMmap = 1 << 0
+	uringEnterGetEvents = 1 << 0
+
+	uringOpNop        = 0
+	uringOpPollAdd    = 6
+	uringOpPollRemove = 7
+
+	uringPollAddMulti = 1 << 0 // IORING_POLL_ADD_MULTI (sqe.len), kernel 5.13+
+	uringCQEFMore     = 1 << 1 // IORING_CQE_F_MORE
+
+	uringPollIn  = 0x1 // POLLIN
+	uringPollPri = 0x2 // POLLPRI, V4L2 events pending
+
+	// user data values with the high bit set are internal to the ring
+	uringInternal = 1 << 63
+	uringCloseID  = uringInternal | 1
+	uringRemoveID = uringInternal | 2
+	uringProbeID  = uringInternal | 3
+)
+
+type uringSQOffsets struct {
+	head, tail, ringMask, ringEntries, flags, dropped, array, resv1 uint32
+	resv2                                                           uint64
+}
+
+type uringCQOffsets struct {
+	head, tail, ringMask, ringEntries, overflow, cqes, flags, resv1 uint32
+	resv2                                                           uint64
+}
+
+type uringParams struct {
+	sqEntries, cqEntries, flags, sqThreadCPU, sqThreadIdle, features, wqFd uint32
+	resv                                                                   [3]uint32
+	sqOff                                                                  uringSQOffsets
+	cqOff                                                                  uringCQOffsets
+}
+
+// uringSQE (io_uring_sqe) is a 64-byte submission entry
+type uringSQE struct {
+	opcode      uint8
+	flags       uint8
+	ioprio      uint16
+	fd          int32
+	off         uint64
+	addr        uint64
+	len         uint32
+	opFlags     uint32 // poll32_events for POLL_ADD
+	userData    uint64
+	bufIndex    uint16
+	personality uint16
+	spliceFdIn  int32
+	_           [2]uint64
+}
+
+// uringCQE (io_uring_cqe) is a 16-byte completion entry
+type uringCQE struct {
+	userData uint64
+	res      int32
+	flags    uint32
+}
+
+// URing is an experimental, io_uring-based wait backend that can be shared by many devices.
+// Each registered device gets a multi-shot poll request, and a single goroutine collects
+// the readiness completions of all devices with one io_uring_enter call per wakeup. Buffers
+// are still dequeued and queued with ioctl (V4L2 does not implement io_uring commands).
+//
+// Use NewURing to create a ring, and WithURing to attach it to a device.
+type URing struct {
+	fd     int
+	sqRing []byte
+	cqRing []byte
+	sqeMem []byte
+
+	sqHead  *uint32
+	sqTail  *uint32
+	sqMask  uint32
+	sqArray []uint32
+	sqes    []uringSQE
+
+	cqHead *uint32
+	cqTail *uint32
+	cqMask uint32
+	cqes   []uringCQE
+
+	mu      sync.Mutex // guards SQ and waiters
+	waiters map[uint64]*uringWaiter
+	nextID  uint64
+	closed  bool
+	done    chan struct{}
+	node    int
+}
+
+type uringWaiter struct {
+	id     uint64
+	fd     int32
+	mask   uint32
+	ready  chan struct{}
+	events uint32 // set (atomically) when a completion reported POLLPRI
+}
+
+// NewURing sets up an io_uring with room for the specified number of entries (rounded up to
+// a power of two by the kernel). It returns an error wrapping v4l2.ErrorUnsupportedFeature
+// when the running kernel does not provide io_uring with multi-shot poll (5.13+) or when
+// io_uring is disabled, in which case devices should keep using the default poller.
+func NewURing(entries uint32) (*URing, error) {
+	return newURing(entries, -1)
+}
+
+// NewURingOnNode is similar to NewURing, but the thread that waits for completions is
+// restricted to the CPUs of the specified NUMA node (i.e. the node local to the capture devices).
+func NewURingOnNode(entries uint32, node int) (*URing, error) {
+	return newURing(entries, node)
+}
+
+func newURing(entries uint32, node int) (*URing, error) {
+	var params uringParams
+	fd, _, errno := sys.Syscall(sysIOURingSetup, uintptr(entries), uintptr(unsafe.Pointer(&params)), 0)
+	if errno != 0 {
+		return nil, fmt.Errorf("device: io_uring setup: %w: %s", v4l2.ErrorUnsupportedFeature, errno)
+	}
+
+	r := &URing{fd: int(fd), waiters: make(map[uint64]*uringWaiter), done: make(chan struct{}), node: node}
+	if err := r.mapRings(&params); err != nil {
+		r.unmap()
+		return nil, fmt.Errorf("device: io_uring: %w", err)
+	}
+
+	if err := r.probeMultishot(); err != nil {
+		r.unmap()
+		return nil, fmt.Errorf("device: io_uring: %w: %s", v4l2.ErrorUnsupportedFeature, err)
+	}
+
+	go r.loop()
+	return r, nil
+}
+
+func (r *URing) mapRings(p *uringParams) error {
+	sqSize := int(p.sqOff.array + p.sqEntries*4)
+	cqSize := int(p.cqOff.cqes + p.cqEntries*uint32(unsafe.Sizeof(uringCQE{})))
+	if p.features&uringFeatSingleMmap != 0 && cqSize > sqSize {
+		sqSize = cqSize
+	}
+
+	var err error
+	if r.sqRing, err = sys.Mmap(r.fd, uringOffSQRing, sqSize, sys.PROT_READ|sys.PROT_WRITE, sys.MAP_SHARED|sys.MAP_POPULATE); err != nil {
+		return fmt.Errorf("map sq ring: %w", err)
+	}
+	if p.features&uringFeatSingleMmap != 0 {
+		r.cqRing = r.sqRing
+	} else if r.cqRing, err = sys.Mmap(r.fd, uringOffCQRing, cqSize, sys.PROT_READ|sys.PROT_WRITE, sys.MAP_SHARED|sys.MAP_POPULATE); err != nil {
+		return fmt.Errorf("map cq ring: %w", err)
+	}
+	sqeSize := int(p.sqEntries) * int(unsafe.Sizeof(uringSQE{}))
+	if r.sqeMem, err = sys.Mmap(r.fd, uringOffSQEs, sqeSize, sys.PROT_READ|sys.PROT_WRITE, sys.MAP_SHARED|sys.MAP_POPULATE); err != nil {
+		return fmt.Errorf("map sqes: %w", err)
+	}
+
+	r.sqHead = (*uint32)(unsafe.Pointer(&r.sqRing[p.sqOff.head]))
+	r.sqTail = (*uint32)(unsafe.Pointer(&r.sqRing[p.sqOff.tail]))
+	r.sqMask = *(*uint32)(unsafe.Pointer(&r.sqRing[p.sqOff.ringMask]))
+	r.sqArray = (*[1 << 16]uint32)(unsafe.Pointer(&r.sqRing[p.sqOff.array]))[:p.sqEntries:p.sqEntries]
+	r.sqes = (*[1 << 16]uringSQE)(unsafe.Pointer(&r.sqeMem[0]))[:p.sqEntries:p.sqEntries]
+
+	r.cqHead = (*uint32)(unsafe.Pointer(&r.cqRing[p.cqOff.head]))
+	r.cqTail = (*uint32)(unsafe.Pointer(&r.cqRing[p.cqOff.tail]))
+	r.cqMask = *(*uint32)(unsafe.Pointer(&r.cqRing[p.cqOff.ringMask]))
+	r.cqes = (*[1 << 16]uringCQE)(unsafe.Pointer(&r.cqRing[p.cqOff.cqes]))[:p.cqEntries:p.cqEntries]
+	return nil
+}
+
+func (r *URing) unmap() {
+	if r.sqeMem != nil {
+		sys.Munmap(r.sqeMem)
+	}
+	if r.cqRing != nil && &r.cqRing[0] != &r.sqRing[0] {
+		sys.Munmap(r.cqRing)
+	}
+	if r.sqRing != nil {
+		sys.Munmap(r.sqRing)
+	}
+	sys.Close(r.fd)
+}
+
+// enter wraps io_uring_enter
+func (r *URing) enter(toSubmit, minComplete, flags uint32) error {
+	for {
+		_, _, errno := sys.Syscall6(sysIOURingEnter, uintptr(r.fd), uintptr(toSubmit), uintptr(minComplete), uintptr(flags), 0, 0)
+		switch errno {
+		case 0:
+			return nil
+		case sys.EINTR:
+			continue // only returned before any submission takes place
+		default:
+			return errno
+		}
+	}
+}
+
+// submit places the entry in the submission queue and submits it right away.
+// Caller must hold r.mu.
+func (r *URing) submit(sqe uringSQE) error {
+	tail := *r.sqTail
+	if tail-atomic.LoadUint32(r.sqHead) > r.sqMask {
+		return fmt.Errorf("submission queue full")
+	}
+	idx := tail & r.sqMask
+	r.sqes[idx] = sqe
+	r.sqArray[idx] = idx
+	atomic.StoreUint32(r.sqTail, tail+1)
+	return r.enter(1, 0, 0)
+}
+
+// reap consumes all available completions with handle, and returns the number consumed.
+func (r *URing) reap(handle func(cqe uringCQE)) int {
+	head := *r.cqHead
+	tail := atomic.LoadUint32(r.cqTail)
+	n := int(tail - head)
+	for ; head != tail; head++ {
+		handle(r.cqes[head&r.cqMask])
+	}
+	atomic.StoreUint32(r.cqHead, head)
+	return n
+}
+
+// probeMultishot checks that the kernel supports multi-shot poll by polling a readable pipe.
+// Older kernels reject the request with EINVAL.
+func (r *URing) probeMultishot() error {
+	var pipe [2]int
+	if err := sys.Pipe2(pipe[:], sys.O_NONBLOCK|sys.O_CLOEXEC); err != nil {
+		return err
+	}
+	defer sys.Close(pipe[0])
+	defer sys.Close(pipe[1])
+	if _, err := sys.Write(pipe[1], []byte{1}); err != nil {
+		return err
+	}
+
+	if err := r.submit(uringSQE{opcode: uringOpPollAdd, fd: int32(pipe[0]), len: uringPollAddMulti, opFlags: uringPollIn, userData: uringProbeID}); err != nil {
+		return err
+	}
+	armed, removed := true, false
+	var probeErr error
+	for first := true; armed || !removed; first = false {
+		if err := r.enter(0, 1, uringEnterGetEvents); err != nil {
+			return err
+		}
+		r.reap(func(cqe uringCQE) {
+			switch cqe.userData {
+			case uringProbeID:
+				if cqe.flags&uringCQEFMore == 0 {
+					armed = false
+				}
+				if first && (cqe.res < 0 || cqe.flags&uringCQEFMore == 0) {
+					probeErr = fmt.Errorf("multi-shot poll: %s", sys.Errno(-cqe.res))
+					removed = true
+				}
+			case uringRemoveID:
+				removed = true
+			}
+		})
+		if first && probeErr == nil {
+			if err := r.submit(uringSQE{opcode: uringOpPollRemove, fd: -1, addr: uringProbeID, userData: uringRemoveID}); err != nil {
+				return err
+			}
+		}
+	}
+	return probeErr
+}
+
+// loop waits for, and dispatches, the completions of all registered devices.
+func (r *URing) loop() {
+	defer close(r.done)
+	if r.node >= 0 {
+		// best effort, the thread is left unbound when the node's cpus can't be set
+		bindThreadToNode(r.node)
+	}
+	closing := false
+	for !closing {
+		if err := r.enter(0, 1, uringEnterGetEvents); err != nil {
+			return
+		}
+		r.mu.Lock()
+		r.reap(func(cqe uringCQE) {
+			if cqe.userData == uringCloseID {
+				closing = true
+				return
+			}
+			if cqe.userData&uringInternal != 0 {
+				return
+			}
+			w, ok := r.waiters[cqe.userData]
+			if !ok {
+				return // unregistered
+			}
+			if cqe.res > 0 && uint32(cqe.res)&uringPollPri != 0 {
+				atomic.StoreUint32(&w.events, 1)
+			}
+			select {
+			case w.ready <- struct{}{}:
+			default: // wakeup pending already
+			}
+			// poll terminated (i.e. cq overflow), arm it again
+			if cqe.flags&uringCQEFMore == 0 {
+				r.submit(uringSQE{opcode: uringOpPollAdd, fd: w.fd, len: uringPollAddMulti, opFlags: w.mask, userData: w.id})
+			}
+		})
+		r.mu.Unlock()
+	}
+}
+
+// register adds a multi-shot poll for fd. The returned waiter's ready channel
+// receives a value each time fd may be readable (or, when events is true, has V4L2
+// events pending).
+func (r *URing) register(fd uintptr, events bool) (*uringWaiter, error) {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	if r.closed {
+		return nil, fmt.Errorf("io_uring closed")
+	}
+	r.nextID++
+	w := &uringWaiter{id: r.nextID, fd: int32(fd), mask: uringPollIn, ready: make(chan struct{}, 1)}
+	if events {
+		w.mask |= uringPollPri
+	}
+	if err := r.submit(uringSQE{opcode: uringOpPollAdd, fd: w.fd, len: uringPollAddMulti, opFlags: w.mask, userData: w.id}); err != nil {
+		return nil, fmt.Errorf("io_uring register: %w", err)
+	}
+	r.waiters[w.id] = w
+	return w, nil
+}
+
+// unregister removes the poll request added for w
+func (r *URing) unregister(w *uringWaiter) {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	delete(r.waiters, w.id)
+	if !r.closed {
+		r.submit(uringSQE{opcode: uringOpPollRemove, fd: -1, addr: w.id, userData: uringRemoveID})
+	}
+}
+
+// Close stops the completion loop and releases the ring. Devices using the ring
+// should be stopped first.
+func (r *URing) Close() error {
+	r.mu.Lock()
+	if r.closed {
+		r.mu.Unlock()
+		return nil
+	}
+	r.closed = true
+	err := r.submit(uringSQE{opcode: uringOpNop, fd: -1, userData: uringCloseID})
+	r.mu.Unlock()
+	if err != nil {
+		return fmt.Errorf("device: io_uring close: %w", err)
+	}
+	<-r.done
+	r.unmap()
+	return nil
+}
+
+// uringDequeuer dequeues buffers, waiting on the shared ring when the driver reports EAGAIN.
+// When the device watches source changes, the ring also polls for POLLPRI, and the wait
+// returns errEventPending once events are queued.
+func (d *Device) uringDequeuer(ctx context.Context, r *URing, timeout time.Duration) (dequeueFunc, func(), error) {
+	w, err := r.register(d.fd, d.watchSource)
+	if err != nil {
+		return nil, nil, err
+	}
+	var expired <-chan time.Time
+	timer := time.NewTimer(timeout)
+	if timeout > 0 {
+		expired = timer.C
+	}
+	ioMemType := d.MemIOType()
+	bufType := d.BufferType()
+	next := func() (v4l2.Buffer, error) {
+		for {
+			if atomic.LoadUint32(&w.events) != 0 && atomic.SwapUint32(&w.events, 0) != 0 {
+				return v4l2.Buffer{}, errEventPending
+			}
+			buff, err := d.dequeueBuffer(d.fd, ioMemType, bufType)
+			if !errors.Is(err, sys.EAGAIN) {
+				return buff, err
+			}
+			if timeout > 0 {
+				if !timer.Stop() {
+					select {
+					case <-timer.C:
+					default:
+					}
+				}
+				timer.Reset(timeout)
+			}
+			select {
+			case <-w.ready:
+			case <-expired:
+				return v4l2.Buffer{}, errWaitTimeout
+			case <-ctx.Done():
+				return v4l2.Buffer{}, ctx.Err()
+			}
+		}
+	}
+	return next, func() { timer.Stop(); r.unregister(w) }, nil
+}
@@ -0,0 +1,112 @@
+package device
+
+import (
+	"fmt"
+	"os"
+	"sync"
+	sys "syscall"
+	"testing"
+)
+
+// The wait benchmarks use pipes as stand-in devices: each round makes all
+// devices readable once, and waits until every device consumer drained its fd.
+
+func BenchmarkWaitNetpoll(b *testing.B) {
+	for _, n := range []int{16, 32, 64} {
+		b.Run(fmt.Sprintf("devices=%d", n), func(b *testing.B) {
+			benchmarkWait(b, n, func(fd int, consume func() bool) {
+				f := os.NewFile(uintptr(fd), "pipe")
+				rc, err := f.SyscallConn()
+				if err != nil {
+					b.Error(err)
+					return
+				}
+				done := false
+				for !done {
+					rc.Read(func(uintptr) bool {
+						ready, eof := consumeOnce(fd, consume)
+						done = eof
+						return ready || eof
+					})
+				}
+				f.Close()
+			})
+		})
+	}
+}
+
+func BenchmarkWaitURing(b *testing.B) {
+	ring, err := NewURing(256)
+	if err != nil {
+		b.Skip(err)
+	}
+	defer ring.Close()
+	for _, n := range []int{16, 32, 64} {
+		b.Run(fmt.Sprintf("devices=%d", n), func(b *testing.B) {
+			benchmarkWait(b, n, func(fd int, consume func() bool) {
+				w, err := ring.register(uintptr(fd), false)
+				if err != nil {
+					b.Error(err)
+					return
+				}
+				defer ring.unregister(w)
+				defer sys.Close(fd)
+				for {
+					ready, eof := consumeOnce(fd, consume)
+					if eof {
+						return
+					}
+					if !ready {
+						<-w.ready
+					}
+				}
+			})
+		})
+	}
+}
+
+// consumeOnce reads one byte, reporting whether data was consumed or the pipe was closed.
+func consumeOnce(fd int, consume func() bool) (ready, eof bool) {
+	var buf [1]byte
+	n, err := sys.Read(fd, buf[:])
+	switch {
+	case err == sys.EAGAIN:
+		return false, false
+	case err != nil || n == 0:
+		return false, true
+	}
+	consume()
+	return true, false
+}
+
+func benchmarkWait(b *testing.B, devices int, run func(fd int, consume func() bool)) {
+	var round, consumers sync.WaitGroup
+	writers := make([]int, devices)
+	for i := range writers {
+		var p [2]int
+		if err := sys.Pipe2(p[:], sys.O_NONBLOCK|sys.O_CLOEXEC); err != nil {
+			b.Fatal(err)
+		}
+		writers[i] = p[1]
+		consumers.Add(1)
+		go func(fd int) {
+			defer consumers.Done()
+			run(fd, func() bool { round.Done(); return true })
+		}(p[0])
+	}
+
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		round.Add(devices)
+		for _, fd := range writers {
+			sys.Write(fd, []byte{1})
+		}
+		round.Wait()
+	}
+	b.StopTimer()
+
+	for _, fd := range writers {
+		sys.Close(fd)
+	}
+	consumers.Wait()
+}
@@ -69,7 +69,7 @@ func main() {
 	}
 	log.Printf("Found preferred fmt: %s", fmtDesc)
 
-	frameSizes, err := v4l2.GetFormatFrameSizes(device.Fd(), fmtDesc.PixelFormat)
+	frameSizes, err := device.GetFormatFrameSizes(fmtDesc.PixelFormat)
 	if err != nil {
 		log.Fatalf("failed to get framesize info: %s", err)
 	}
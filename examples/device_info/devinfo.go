@@ -201,7 +201,7 @@ func printFormatDesc(dev *device2.Device) error {
 	}
 	fmt.Println("Supported formats:")
 	for i, desc := range descs {
-		frmSizes, err := v4l2.GetFormatFrameSizes(dev.Fd(), desc.PixelFormat)
+		frmSizes, err := dev.GetFormatFrameSizes(desc.PixelFormat)
 		if err != nil {
 			return fmt.Errorf("format desc: %w", err)
 		}
@@ -22,12 +22,14 @@ import (
 	pigo "github.com/esimov/pigo/core"
 	"github.com/fogleman/gg"
 	"github.com/vladimirvivien/go4vl/device"
+	"github.com/vladimirvivien/go4vl/imgsupport"
+	"github.com/vladimirvivien/go4vl/rtp"
 	"github.com/vladimirvivien/go4vl/v4l2"
+	"github.com/vladimirvivien/go4vl/wsstream"
 )
 
 var (
 	camera      *device.Device
-	frames      <-chan []byte
 	fps         uint32 = 30
 	pixfmt      v4l2.FourCCType
 	width       = 640
@@ -35,6 +37,8 @@ var (
 	streamInfo  string
 	faceEnabled bool
 	faceFinder  *pigo.Pigo
+	staticDelta int
+	wsServer    *wsstream.Server
 )
 
 type PageData struct {
@@ -79,35 +83,89 @@ func servePage(w http.ResponseWriter, r *http.Request) {
 
 // start http service
 func serveVideoStream(w http.ResponseWriter, req *http.Request) {
+	// each client gets its own subscription to the camera stream
+	sub := camera.Subscribe(0, 2)
+	defer camera.Unsubscribe(sub)
+
 	mimeWriter := multipart.NewWriter(w)
 	w.Header().Set("Content-Type", fmt.Sprintf("multipart/x-mixed-replace; boundary=%s", mimeWriter.Boundary()))
 	partHeader := make(textproto.MIMEHeader)
 	partHeader.Add("Content-Type", "image/jpeg")
 
-	var frame []byte
-	for frame = range frames {
-		if len(frame) == 0 {
-			log.Print("skipping empty frame")
-			continue
-		}
+	// frames of a static scene are skipped (with a heartbeat frame every second)
+	grid := imgsupport.NewLumaGrid(16, 12)
+	static := imgsupport.StaticFilter{Threshold: staticDelta, Heartbeat: time.Second}
+	start := time.Now()
 
-		partWriter, err := mimeWriter.CreatePart(partHeader)
+	for f := range sub.Frames() {
+		err := writeFramePart(mimeWriter, partHeader, f.Data, grid, &static, time.Since(start))
+		f.Release()
 		if err != nil {
 			log.Printf("failed to create multi-part writer: %s", err)
 			return
 		}
+	}
+}
 
-		if faceEnabled {
-			if err := runFaceDetect(partWriter, frame); err != nil {
-				log.Printf("face detection failed: %s", err)
-				continue
-			}
-		} else {
-			if _, err := partWriter.Write(frame); err != nil {
-				log.Printf("failed to write image: %s", err)
-			}
+// writeFramePart writes the frame as a part of the multipart stream, unless it is empty or
+// shows a static scene
+func writeFramePart(mimeWriter *multipart.Writer, partHeader textproto.MIMEHeader, frame []byte, grid *imgsupport.LumaGrid, static *imgsupport.StaticFilter, elapsed time.Duration) error {
+	if len(frame) == 0 {
+		log.Print("skipping empty frame")
+		return nil
+	}
+
+	if staticDelta > 0 && pixfmt == v4l2.PixelFmtMJPEG {
+		if err := grid.FromMJPEG(frame); err == nil && !static.Keep(grid, elapsed) {
+			return nil
 		}
+	}
+
+	partWriter, err := mimeWriter.CreatePart(partHeader)
+	if err != nil {
+		return err
+	}
+
+	if faceEnabled {
+		if err := runFaceDetect(partWriter, frame); err != nil {
+			log.Printf("face detection failed: %s", err)
+		}
+	} else {
+		if _, err := partWriter.Write(frame); err != nil {
+			log.Printf("failed to write image: %s", err)
+		}
+	}
+	return nil
+}
+
+// publishFrames sends captured frames to the websocket clients, from a subscription of
+// its own. Frames are published without being copied, and released once all clients
+// have sent (or skipped) them.
+func publishFrames(sub *device.Subscription) {
+	start := time.Now()
+	var seq uint32
+	for f := range sub.Frames() {
+		if len(f.Data) == 0 {
+			f.Release()
+			continue
+		}
+		seq++
+		header := wsstream.Header{Sequence: seq, Format: pixfmt, Timestamp: time.Since(start)}
+		wsServer.Publish("", header, f.Data, f.Release)
+	}
+}
 
+// sendFrames sends captured h264 frames to the rtp peer, from a subscription of its own (so
+// that it gets every access unit). Frames come with their NAL units indexed.
+func sendFrames(peer *rtp.Peer, sub *device.Subscription) {
+	start := time.Now()
+	for f := range sub.Frames() {
+		if len(f.Data) > 0 {
+			if err := peer.WriteIndexedFrame(f.Data, &f.NALs, time.Since(start)); err != nil {
+				log.Printf("rtp output: %s", err)
+			}
+		}
+		f.Release()
 	}
 }
 
@@ -214,26 +272,28 @@ func controlVideo(w http.ResponseWriter, req *http.Request) {
 		return
 	}
 
+	var id v4l2.CtrlID
 	switch ctrl.Name {
 	case "brightness":
-		if err := camera.SetControlBrightness(int32(val)); err != nil {
-			log.Printf("failed to set brightness: %s", err)
-			return
-		}
+		id = v4l2.CtrlBrightness
 	case "contrast":
-		if err := camera.SetControlContrast(int32(val)); err != nil {
-			log.Printf("failed to set contrast: %s", err)
-			return
-		}
+		id = v4l2.CtrlContrast
 	case "saturation":
-		if err := camera.SetControlSaturation(int32(val)); err != nil {
-			log.Printf("failed to set saturation: %s", err)
-			return
-		}
+		id = v4l2.CtrlSaturation
+	default:
+		return
 	}
 
-	log.Printf("applied control %#v", ctrl)
-
+	// queued writes are applied off the request (and capture) goroutines, and coalesced
+	// while a slider is dragged faster than the camera applies them
+	result := camera.ControlQueue().Set(id, int32(val))
+	go func() {
+		if err := result.Wait(); err != nil {
+			log.Printf("failed to set %s: %s", ctrl.Name, err)
+			return
+		}
+		log.Printf("applied control %#v", ctrl)
+	}()
 }
 
 func main() {
@@ -277,6 +337,13 @@ func main() {
 	flag.IntVar(&frameRate, "r", frameRate, "frames per second (fps)")
 	flag.IntVar(&buffSize, "b", buffSize, "device buffer size")
 	flag.BoolVar(&face, "face", face, "turns on face detection mode")
+	rtpAddr := ""
+	flag.StringVar(&rtpAddr, "rtp", rtpAddr, "also sends the h264 stream (-f h264) over RTP to this address (host:port)")
+	rtpBitrate := 0
+	flag.IntVar(&rtpBitrate, "rtp-bitrate", rtpBitrate, "encoder bitrate (bits/s) the RTP output is paced for (read from the camera when 0)")
+	wsEnabled := false
+	flag.BoolVar(&wsEnabled, "ws", wsEnabled, "also streams frames to WebSocket clients (path /ws)")
+	flag.IntVar(&staticDelta, "static", staticDelta, "skips frames whose brightness changed less than this (0 sends all frames)")
 	flag.Parse()
 
 	// if face enabled, force fmt, buff size, and frame rate to low.
@@ -289,12 +356,17 @@ func main() {
 		frameRate = 5
 	}
 
+	if rtpAddr != "" && getFormatType(format) != v4l2.PixelFmtH264 {
+		log.Fatalf("rtp output needs the h264 format (-f h264), not %s", format)
+	}
+
 	// open camera and setup camera
 	camera, err = device.Open(devName,
 		device.WithIOType(v4l2.IOTypeMMAP),
 		device.WithPixFormat(v4l2.PixFormat{PixelFormat: getFormatType(format), Width: uint32(width), Height: uint32(height), Field: v4l2.FieldAny}),
 		device.WithFPS(uint32(frameRate)),
 		device.WithBufferSize(uint32(buffSize)),
+		device.WithSubscriptions(),
 	)
 
 	if err != nil {
@@ -313,6 +385,9 @@ func main() {
 	}
 	log.Printf("Current format: %s", currFmt)
 	pixfmt = currFmt.PixelFormat
+	if rtpAddr != "" && pixfmt != v4l2.PixelFmtH264 {
+		log.Fatalf("rtp output: device captures %s, not h264", v4l2.PixelFormats[pixfmt])
+	}
 	streamInfo = fmt.Sprintf("%s - %s [%dx%d] %d fps",
 		caps.Card,
 		v4l2.PixelFormats[currFmt.PixelFormat],
@@ -329,13 +404,46 @@ func main() {
 		camera.Close()
 	}()
 
-	// video stream
-	frames = camera.GetOutput()
-
 	log.Printf("device capture started (buffer size set %d)", camera.BufferCount())
 	log.Printf("starting server on port %s", port)
 	log.Println("use url path /webcam")
 
+	// with websocket streaming, frames are published to all ws clients (alongside the
+	// /stream clients, every consumer has its own subscription to the camera stream)
+	if wsEnabled {
+		wsServer = wsstream.NewServer()
+		go publishFrames(camera.Subscribe(0, 2))
+		http.Handle("/ws", wsServer)
+		log.Println("use url path /ws for websocket streaming")
+	}
+
+	// with rtp output, the h264 stream is sent to the peer; picture loss reported by the
+	// peer forces a key frame from the camera encoder
+	if rtpAddr != "" {
+		// packets are paced above the encoder bitrate, so that key frames do not fall behind
+		if rtpBitrate == 0 {
+			if ctrl, err := camera.GetControl(v4l2.CtrlMPEGVideoBitrate); err == nil {
+				rtpBitrate = int(ctrl.Value)
+			} else {
+				log.Printf("rtp output: encoder bitrate unknown (%s), packets are not paced (see -rtp-bitrate)", err)
+			}
+		}
+		peer, err := rtp.Dial(rtpAddr,
+			rtp.WithPacing(rtpBitrate*3/2),
+			rtp.WithKeyFrameRequest(func() {
+				if err := camera.RequestKeyFrame(); err != nil {
+					log.Printf("key frame request failed: %s", err)
+				}
+			}, time.Second),
+		)
+		if err != nil {
+			log.Fatalf("rtp output: %s", err)
+		}
+		defer peer.Close()
+		go sendFrames(peer, camera.Subscribe(0, 2))
+		log.Printf("sending rtp stream to %s", rtpAddr)
+	}
+
 	// setup http service
 	http.HandleFunc("/webcam", servePage)        // returns an html page
 	http.HandleFunc("/stream", serveVideoStream) // returns video feed
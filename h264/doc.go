@@ -0,0 +1,3 @@
+// Package h264 provides helpers to inspect H.264 (Annex B) streams produced by capture
+// devices and encoders.
+package h264
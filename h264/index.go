@@ -0,0 +1,139 @@
+package h264
+
+import "bytes"
+
+// MaxNALUnits is the number of NAL units an Index holds
+const MaxNALUnits = 32
+
+// IndexFlag summarizes the content of an indexed access unit
+type IndexFlag = uint8
+
+const (
+	IndexHasSPS   IndexFlag = 1 << iota // holds a sequence parameter set
+	IndexHasPPS                         // holds a picture parameter set
+	IndexHasIDR                         // holds an IDR slice (key frame)
+	IndexOverflow                       // holds more than MaxNALUnits units (only the first are indexed)
+)
+
+// NALUnit locates a NAL unit (without its start code) within an access unit
+type NALUnit struct {
+	Offset uint32
+	Size   uint32
+	Type   NALType
+}
+
+// Index locates the NAL units of an access unit, so that the stages handling the
+// access unit (packetizers, muxers, key frame detection) do not scan it again.
+// It is a fixed size value: building it does not allocate.
+type Index struct {
+	Units [MaxNALUnits]NALUnit
+	Count int
+	Flags IndexFlag
+}
+
+// Build indexes the NAL units of Annex B data. Start codes are located by searching
+// their final 0x01 byte with bytes.IndexByte (vectorized by the Go runtime), then
+// checking the zero bytes preceding it.
+func (x *Index) Build(data []byte) {
+	x.Count, x.Flags = 0, 0
+	_, start := x.scan(data, 0, len(data), -1)
+	x.finish(data, start)
+}
+
+// copyChunk is the size of the chunks BuildCopy scans right after copying them, small
+// enough that the chunk is still in the L1/L2 cache when it is scanned
+const copyChunk = 16 << 10
+
+// BuildCopy copies Annex B data from src into dst (like copy, and returns the number of
+// bytes copied) and indexes the NAL units of the copy. The copy is done in chunks, each
+// scanned while it is still cached, so that the data is read from memory once.
+func (x *Index) BuildCopy(dst, src []byte) int {
+	n := len(src)
+	if len(dst) < n {
+		n = len(dst)
+	}
+	data := dst[:n]
+	x.Count, x.Flags = 0, 0
+	pos, start := 0, -1
+	for off := 0; off < n; off += copyChunk {
+		end := off + copyChunk
+		if end > n {
+			end = n
+		}
+		copy(data[off:end], src[off:end])
+		// start codes straddling chunks are found once their 0x01 byte is copied
+		pos, start = x.scan(data, pos, end, start)
+	}
+	x.finish(data, start)
+	return n
+}
+
+// scan indexes the units ending before limit, searching start codes from pos. start is
+// the offset of the current unit (-1 before the first start code). It returns where the
+// search stopped and the offset of the current unit.
+func (x *Index) scan(data []byte, pos, limit, start int) (int, int) {
+	for pos < limit {
+		i := bytes.IndexByte(data[pos:limit], 1)
+		if i < 0 {
+			return limit, start
+		}
+		p := pos + i
+		if p >= 2 && data[p-1] == 0 && data[p-2] == 0 {
+			if start >= 0 {
+				x.add(data, start, p-2)
+			}
+			start = p + 1
+		}
+		pos = p + 1
+	}
+	return pos, start
+}
+
+// finish indexes the last unit of data
+func (x *Index) finish(data []byte, start int) {
+	if start >= 0 {
+		x.add(data, start, len(data))
+	}
+}
+
+func (x *Index) add(data []byte, start, end int) {
+	// zero bytes before a start code belong to it (or are trailing padding)
+	for end > start && data[end-1] == 0 {
+		end--
+	}
+	if end == start {
+		return
+	}
+	if x.Count == MaxNALUnits {
+		x.Flags |= IndexOverflow
+		return
+	}
+	unit := NALUnit{Offset: uint32(start), Size: uint32(end - start), Type: data[start] & 0x1F}
+	switch unit.Type {
+	case NALSPS:
+		x.Flags |= IndexHasSPS
+	case NALPPS:
+		x.Flags |= IndexHasPPS
+	case NALSliceIDR:
+		x.Flags |= IndexHasIDR
+	}
+	x.Units[x.Count] = unit
+	x.Count++
+}
+
+// IsKeyFrame reports whether the indexed access unit holds an IDR slice
+func (x *Index) IsKeyFrame() bool {
+	return x.Flags&IndexHasIDR != 0
+}
+
+// NALUnits appends to dst the indexed NAL units of data (the access unit the index was
+// built from), as slices of data. When the index overflowed, data is split again.
+func (x *Index) NALUnits(dst [][]byte, data []byte) [][]byte {
+	if x.Flags&IndexOverflow != 0 {
+		return SplitNALUnits(dst, data)
+	}
+	for _, unit := range x.Units[:x.Count] {
+		dst = append(dst, data[unit.Offset:unit.Offset+unit.Size])
+	}
+	return dst
+}
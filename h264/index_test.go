@@ -0,0 +1,105 @@
+package h264
+
+import (
+	"bytes"
+	"math/rand"
+	"testing"
+)
+
+// testAccessUnit returns an access unit made of SPS, PPS and slices of random data
+func testAccessUnit(sliceSize, slices int) []byte {
+	rnd := rand.New(rand.NewSource(1))
+	au := []byte{0, 0, 0, 1, 0x67, 0x42, 0xC0, 0x1F, 0, 0, 1, 0x68, 0xCE, 0x3C, 0x80}
+	for i := 0; i < slices; i++ {
+		slice := make([]byte, sliceSize)
+		rnd.Read(slice)
+		slice[0] = 0x65
+		// emulation prevention: no start code within units
+		for j := 2; j < len(slice); j++ {
+			if slice[j] <= 3 && slice[j-1] == 0 && slice[j-2] == 0 {
+				slice[j] = 4
+			}
+		}
+		slice[len(slice)-1] = 0x80
+		au = append(append(au, 0, 0, 1), slice...)
+	}
+	return au
+}
+
+func TestIndex(t *testing.T) {
+	au := testAccessUnit(4096, 4)
+	var x Index
+	x.Build(au)
+	units := x.NALUnits(nil, au)
+	want := SplitNALUnits(nil, au)
+	if len(units) != len(want) || x.Flags != IndexHasSPS|IndexHasPPS|IndexHasIDR {
+		t.Fatalf("indexed %d units (flags %#x), want %d", len(units), x.Flags, len(want))
+	}
+	for i := range want {
+		if !bytes.Equal(units[i], want[i]) {
+			t.Fatalf("unit %d differs", i)
+		}
+	}
+}
+
+func TestIndexBuildCopy(t *testing.T) {
+	// slice sizes placing start codes across the chunk boundaries
+	for size := copyChunk - 20; size < copyChunk-8; size++ {
+		au := testAccessUnit(size, 5)
+		var want, x Index
+		want.Build(au)
+		dst := make([]byte, len(au))
+		if n := x.BuildCopy(dst, au); n != len(au) || !bytes.Equal(dst, au) {
+			t.Fatalf("slice size %d: copied %d bytes, want %d", size, n, len(au))
+		}
+		if x != want {
+			t.Fatalf("slice size %d: index %+v, want %+v", size, x.Units[:x.Count], want.Units[:want.Count])
+		}
+	}
+
+	// a short destination truncates the copy like copy does
+	au := testAccessUnit(4096, 2)
+	var x Index
+	if n := x.BuildCopy(make([]byte, 100), au); n != 100 {
+		t.Fatalf("copied %d bytes, want 100", n)
+	}
+}
+
+func BenchmarkIndexBuild(b *testing.B) {
+	au := testAccessUnit(256*1024, 4)
+	var x Index
+	b.SetBytes(int64(len(au)))
+	for i := 0; i < b.N; i++ {
+		x.Build(au)
+	}
+}
+
+func BenchmarkSplitNALUnits(b *testing.B) {
+	au := testAccessUnit(256*1024, 4)
+	var units [][]byte
+	b.SetBytes(int64(len(au)))
+	for i := 0; i < b.N; i++ {
+		units = SplitNALUnits(units[:0], au)
+	}
+}
+
+func BenchmarkIndexCopyThenBuild(b *testing.B) {
+	au := testAccessUnit(256*1024, 4)
+	dst := make([]byte, len(au))
+	var x Index
+	b.SetBytes(int64(len(au)))
+	for i := 0; i < b.N; i++ {
+		copy(dst, au)
+		x.Build(dst)
+	}
+}
+
+func BenchmarkIndexBuildCopy(b *testing.B) {
+	au := testAccessUnit(256*1024, 4)
+	dst := make([]byte, len(au))
+	var x Index
+	b.SetBytes(int64(len(au)))
+	for i := 0; i < b.N; i++ {
+		x.BuildCopy(dst, au)
+	}
+}
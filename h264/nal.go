@@ -0,0 +1,66 @@
+package h264
+
+import "bytes"
+
+// NALType is the type of a NAL unit (nal_unit_type)
+type NALType = uint8
+
+const (
+	NALSlice         NALType = 1
+	NALSliceDataA    NALType = 2
+	NALSliceDataB    NALType = 3
+	NALSliceDataC    NALType = 4
+	NALSliceIDR      NALType = 5
+	NALSEI           NALType = 6
+	NALSPS           NALType = 7
+	NALPPS           NALType = 8
+	NALAccessUnit    NALType = 9
+	NALEndOfSequence NALType = 10
+	NALEndOfStream   NALType = 11
+	NALFiller        NALType = 12
+)
+
+var startCode = []byte{0, 0, 1}
+
+// Type returns the type of the NAL unit
+func Type(nal []byte) NALType {
+	if len(nal) == 0 {
+		return 0
+	}
+	return nal[0] & 0x1F
+}
+
+// NextNALUnit returns the first NAL unit of Annex B data (without its start code), and
+// the data following it. The unit is a slice of data, not a copy.
+func NextNALUnit(data []byte) (nal, rest []byte) {
+	start := bytes.Index(data, startCode)
+	if start < 0 {
+		return nil, nil
+	}
+	data = data[start+3:]
+	end := bytes.Index(data, startCode)
+	if end < 0 {
+		return trimZeros(data), nil
+	}
+	// zero bytes before a start code belong to it (or are trailing padding)
+	return trimZeros(data[:end]), data[end:]
+}
+
+// SplitNALUnits appends the NAL units of Annex B data to dst (as slices of data)
+func SplitNALUnits(dst [][]byte, data []byte) [][]byte {
+	for len(data) > 0 {
+		var nal []byte
+		nal, data = NextNALUnit(data)
+		if len(nal) > 0 {
+			dst = append(dst, nal)
+		}
+	}
+	return dst
+}
+
+func trimZeros(nal []byte) []byte {
+	for len(nal) > 0 && nal[len(nal)-1] == 0 {
+		nal = nal[:len(nal)-1]
+	}
+	return nal
+}
@@ -39,3 +39,41 @@ func Yuyv2Jpeg(width, height int, frame []byte) ([]byte, error) {
 
 	return jpgBuf.Bytes(), nil
 }
+
+// Yuyv2RGBA converts the YUYV (4:2:2) frame into RGBA pixels (BT.601, limited range) stored in dst.
+// When dst is too small a new buffer is allocated, otherwise the conversion output reuses dst
+// (which can be memory drawn from an arena slab for instance). It returns the RGBA pixels.
+func Yuyv2RGBA(width, height int, frame, dst []byte) ([]byte, error) {
+	size := width * height * 4
+	if len(frame) < width*height*2 {
+		return nil, fmt.Errorf("yuyv2rgba: frame too small: %d bytes", len(frame))
+	}
+	if cap(dst) < size {
+		dst = make([]byte, size)
+	}
+	dst = dst[:size]
+	yuyvToRGBA(dst, frame)
+	return dst, nil
+}
+
+// yuyvToRGBA converts the YUYV pixels of frame into the RGBA pixels of dst (as many as dst holds)
+func yuyvToRGBA(dst, frame []byte) {
+	size := len(dst)
+	for i, j := 0, 0; j+8 <= size; i, j = i+4, j+8 {
+		y0, u, y1, v := int32(frame[i])-16, int32(frame[i+1])-128, int32(frame[i+2])-16, int32(frame[i+3])-128
+		ruv, guv, buv := 409*v, -100*u-208*v, 516*u
+		y0, y1 = 298*y0+128, 298*y1+128
+		dst[j], dst[j+1], dst[j+2], dst[j+3] = clamp8((y0+ruv)>>8), clamp8((y0+guv)>>8), clamp8((y0+buv)>>8), 0xff
+		dst[j+4], dst[j+5], dst[j+6], dst[j+7] = clamp8((y1+ruv)>>8), clamp8((y1+guv)>>8), clamp8((y1+buv)>>8), 0xff
+	}
+}
+
+func clamp8(v int32) byte {
+	if uint32(v) <= 0xff {
+		return byte(v)
+	}
+	if v < 0 {
+		return 0
+	}
+	return 0xff
+}
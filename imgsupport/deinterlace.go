@@ -0,0 +1,126 @@
+package imgsupport
+
+import (
+	"encoding/binary"
+	"fmt"
+)
+
+// The deinterlacers below work on one plane of 8-bit samples: the whole buffer for packed
+// formats (i.e. YUYV), or each plane in turn for planar formats (i.e. NV12, I420).
+// Samples are averaged eight at a time within uint64 words (SWAR), which is the
+// vectorization available to plain Go code.
+
+const lowBitsClear = 0xFEFEFEFEFEFEFEFE
+
+// avgFloor returns the per-byte average of a and b, rounded down
+func avgFloor(a, b uint64) uint64 {
+	return (a & b) + ((a^b)&lowBitsClear)>>1
+}
+
+// avgCeil returns the per-byte average of a and b, rounded up
+func avgCeil(a, b uint64) uint64 {
+	return (a | b) - ((a^b)&lowBitsClear)>>1
+}
+
+// averageLine stores the average of lines a and b into dst
+func averageLine(dst, a, b []byte) {
+	n := len(dst) &^ 7
+	for i := 0; i < n; i += 8 {
+		binary.LittleEndian.PutUint64(dst[i:], avgFloor(binary.LittleEndian.Uint64(a[i:]), binary.LittleEndian.Uint64(b[i:])))
+	}
+	for i := n; i < len(dst); i++ {
+		dst[i] = byte((uint(a[i]) + uint(b[i])) >> 1)
+	}
+}
+
+// blendLine stores (prev + 2*cur + next)/4 into dst, which may be cur
+func blendLine(dst, prev, cur, next []byte) {
+	n := len(dst) &^ 7
+	for i := 0; i < n; i += 8 {
+		pn := avgFloor(binary.LittleEndian.Uint64(prev[i:]), binary.LittleEndian.Uint64(next[i:]))
+		binary.LittleEndian.PutUint64(dst[i:], avgCeil(binary.LittleEndian.Uint64(cur[i:]), pn))
+	}
+	for i := n; i < len(dst); i++ {
+		dst[i] = byte((uint(prev[i]) + 2*uint(cur[i]) + uint(next[i]) + 2) >> 2)
+	}
+}
+
+func checkPlane(frame []byte, stride, lineLen, height int) error {
+	if stride <= 0 || lineLen <= 0 || lineLen > stride || height < 2 {
+		return fmt.Errorf("deinterlace: invalid geometry: stride %d, line %d, height %d", stride, lineLen, height)
+	}
+	if len(frame) < stride*(height-1)+lineLen {
+		return fmt.Errorf("deinterlace: buffer too small: %d bytes for %d lines of %d", len(frame), height, stride)
+	}
+	return nil
+}
+
+// DeinterlaceBob deinterlaces the plane in place by keeping one field and replacing each
+// line of the other field with the average of the kept lines above and below it.
+// The top field (even lines) is kept when keepTop is true, otherwise the bottom field.
+// Bytes between lineLen and stride are left untouched.
+func DeinterlaceBob(frame []byte, stride, lineLen, height int, keepTop bool) error {
+	if err := checkPlane(frame, stride, lineLen, height); err != nil {
+		return err
+	}
+	line := func(y int) []byte { return frame[y*stride : y*stride+lineLen] }
+
+	first := 1 // first line to replace
+	if !keepTop {
+		// the first line has no kept line above it
+		copy(line(0), line(1))
+		first = 2
+	}
+	for y := first; y < height; y += 2 {
+		if y+1 < height {
+			averageLine(line(y), line(y-1), line(y+1))
+		} else {
+			copy(line(y), line(y-1))
+		}
+	}
+	return nil
+}
+
+// DeinterlaceBlend deinterlaces the plane in place by blending each line with its
+// neighbours ((above + 2*line + below)/4), which merges both fields at the cost of
+// some vertical softness. Bytes between lineLen and stride are left untouched.
+func DeinterlaceBlend(frame []byte, stride, lineLen, height int) error {
+	if err := checkPlane(frame, stride, lineLen, height); err != nil {
+		return err
+	}
+	line := func(y int) []byte { return frame[y*stride : y*stride+lineLen] }
+
+	// lines are blended top to bottom, so the original of the line above is saved
+	prev := make([]byte, lineLen)
+	saved := make([]byte, lineLen)
+	copy(prev, line(0))
+	for y := 0; y < height; y++ {
+		cur := line(y)
+		next := cur
+		if y+1 < height {
+			next = line(y + 1)
+		}
+		copy(saved, cur)
+		blendLine(cur, prev, cur, next)
+		prev, saved = saved, prev
+	}
+	return nil
+}
+
+// WeaveFields merges two fields captured alternately (see v4l2.FieldAlternate) into the
+// interlaced frame dst: the lines of top become the even lines of dst, the lines of bottom
+// the odd lines. Both fields have fieldHeight lines of stride bytes.
+func WeaveFields(dst, top, bottom []byte, stride, fieldHeight int) error {
+	size := stride * fieldHeight
+	if stride <= 0 || fieldHeight <= 0 {
+		return fmt.Errorf("weave fields: invalid geometry: stride %d, height %d", stride, fieldHeight)
+	}
+	if len(top) < size || len(bottom) < size || len(dst) < 2*size {
+		return fmt.Errorf("weave fields: buffers too small for %d lines of %d", fieldHeight, stride)
+	}
+	for y := 0; y < fieldHeight; y++ {
+		copy(dst[2*y*stride:(2*y+1)*stride], top[y*stride:(y+1)*stride])
+		copy(dst[(2*y+1)*stride:(2*y+2)*stride], bottom[y*stride:(y+1)*stride])
+	}
+	return nil
+}
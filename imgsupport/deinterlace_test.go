@@ -0,0 +1,70 @@
+package imgsupport
+
+import (
+	"bytes"
+	"math/rand"
+	"testing"
+)
+
+func TestDeinterlaceBlend(t *testing.T) {
+	const stride, lineLen, height = 37, 35, 9
+	frame := make([]byte, stride*height)
+	rand.Read(frame)
+	orig := append([]byte(nil), frame...)
+
+	if err := DeinterlaceBlend(frame, stride, lineLen, height); err != nil {
+		t.Fatal(err)
+	}
+	for y := 0; y < height; y++ {
+		p, n := y-1, y+1
+		if p < 0 {
+			p = 0
+		}
+		if n == height {
+			n = y
+		}
+		for x := 0; x < stride; x++ {
+			if x < lineLen {
+				// SWAR averaging may round either way
+				sum := int(orig[p*stride+x]) + 2*int(orig[y*stride+x]) + int(orig[n*stride+x])
+				if got := int(frame[y*stride+x]); got < sum/4 || got > (sum+3)/4 {
+					t.Fatalf("line %d, byte %d: got %d, want about %d", y, x, got, sum/4)
+				}
+				continue
+			}
+			if frame[y*stride+x] != orig[y*stride+x] {
+				t.Fatalf("line %d, byte %d: padding modified", y, x)
+			}
+		}
+	}
+}
+
+func TestWeaveFields(t *testing.T) {
+	top := []byte{1, 1, 3, 3}
+	bottom := []byte{2, 2, 4, 4}
+	dst := make([]byte, 8)
+	if err := WeaveFields(dst, top, bottom, 2, 2); err != nil {
+		t.Fatal(err)
+	}
+	if !bytes.Equal(dst, []byte{1, 1, 2, 2, 3, 3, 4, 4}) {
+		t.Fatalf("unexpected frame %v", dst)
+	}
+}
+
+func BenchmarkDeinterlaceBob(b *testing.B) {
+	const stride, height = 720 * 2, 576 // PAL YUYV
+	frame := make([]byte, stride*height)
+	b.SetBytes(int64(len(frame)))
+	for i := 0; i < b.N; i++ {
+		DeinterlaceBob(frame, stride, stride, height, true)
+	}
+}
+
+func BenchmarkDeinterlaceBlend(b *testing.B) {
+	const stride, height = 720 * 2, 576
+	frame := make([]byte, stride*height)
+	b.SetBytes(int64(len(frame)))
+	for i := 0; i < b.N; i++ {
+		DeinterlaceBlend(frame, stride, stride, height)
+	}
+}
@@ -0,0 +1,80 @@
+package imgsupport
+
+import (
+	"fmt"
+	"math"
+)
+
+// Exposure fusion merges frames of a same scene captured with different exposures (i.e.
+// bracketed with device.WithBracketing) into one frame, weighting each sample by how well
+// exposed it is: mid-range luma weighs most, clipped shadows and highlights least (the
+// well-exposedness term of Mertens et al., without the multi-resolution blending).
+// Weights come from a lookup table and sums are normalized with a fixed-point reciprocal,
+// so the inner loop has neither floating point nor divisions.
+
+const (
+	fusionMaxExposures = 16
+	fusionShift        = 24
+)
+
+// fusionWeight maps a luma value to its well-exposedness weight (1 to 255)
+var fusionWeight [256]uint32
+
+// fusionRecip holds 2^fusionShift / s for every possible sum of weights s
+var fusionRecip [fusionMaxExposures*255 + 1]uint64
+
+func init() {
+	const sigma = 0.2 * 255
+	for v := range fusionWeight {
+		d := float64(v) - 128
+		w := math.Round(255 * math.Exp(-d*d/(2*sigma*sigma)))
+		if w < 1 {
+			w = 1
+		}
+		fusionWeight[v] = uint32(w)
+	}
+	for s := 1; s < len(fusionRecip); s++ {
+		fusionRecip[s] = (1 << fusionShift) / uint64(s)
+	}
+}
+
+// FuseExposuresYUYV merges YUYV frames of the same size captured with different exposures
+// into dst, which is grown as needed and returned. Each luma sample is weighted by its own
+// well-exposedness, each chroma sample by the mean weight of the two pixels it covers.
+func FuseExposuresYUYV(dst []byte, exposures [][]byte) ([]byte, error) {
+	if len(exposures) == 0 || len(exposures) > fusionMaxExposures {
+		return dst, fmt.Errorf("fuse exposures: %d exposures, expected 1 to %d", len(exposures), fusionMaxExposures)
+	}
+	size := len(exposures[0]) &^ 3
+	for _, e := range exposures[1:] {
+		if len(e)&^3 != size {
+			return dst, fmt.Errorf("fuse exposures: frame sizes differ: %d and %d bytes", size, len(e))
+		}
+	}
+	if cap(dst) < size {
+		dst = make([]byte, size)
+	}
+	dst = dst[:size]
+
+	for j := 0; j < size; j += 4 {
+		var w0s, w1s, wcs, y0s, us, y1s, vs uint64
+		for _, e := range exposures {
+			px := e[j : j+4 : j+4]
+			w0, w1 := uint64(fusionWeight[px[0]]), uint64(fusionWeight[px[2]])
+			wc := (w0 + w1 + 1) >> 1
+			w0s += w0
+			w1s += w1
+			wcs += wc
+			y0s += w0 * uint64(px[0])
+			us += wc * uint64(px[1])
+			y1s += w1 * uint64(px[2])
+			vs += wc * uint64(px[3])
+		}
+		out := dst[j : j+4 : j+4]
+		out[0] = byte((y0s*fusionRecip[w0s] + 1<<(fusionShift-1)) >> fusionShift)
+		out[1] = byte((us*fusionRecip[wcs] + 1<<(fusionShift-1)) >> fusionShift)
+		out[2] = byte((y1s*fusionRecip[w1s] + 1<<(fusionShift-1)) >> fusionShift)
+		out[3] = byte((vs*fusionRecip[wcs] + 1<<(fusionShift-1)) >> fusionShift)
+	}
+	return dst, nil
+}
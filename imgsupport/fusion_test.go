@@ -0,0 +1,52 @@
+package imgsupport
+
+import "testing"
+
+func TestFuseExposuresYUYV(t *testing.T) {
+	// dark, mid and clipped exposures of the same pixel pair
+	exposures := [][]byte{
+		{10, 120, 20, 130},
+		{120, 110, 140, 140},
+		{255, 128, 255, 128},
+	}
+	out, err := FuseExposuresYUYV(nil, exposures)
+	if err != nil {
+		t.Fatal(err)
+	}
+	// the well exposed frame dominates
+	for i, v := range out {
+		mid := int(exposures[1][i])
+		if d := int(v) - mid; d < -8 || d > 8 {
+			t.Fatalf("byte %d: got %d, expected close to %d", i, v, mid)
+		}
+	}
+
+	// fusing identical frames is the identity
+	same := []byte{0, 255, 77, 128, 200, 3, 128, 64}
+	out, _ = FuseExposuresYUYV(out, [][]byte{same, same})
+	for i := range same {
+		if out[i] != same[i] {
+			t.Fatalf("byte %d: got %d, want %d", i, out[i], same[i])
+		}
+	}
+
+	if _, err := FuseExposuresYUYV(nil, [][]byte{make([]byte, 8), make([]byte, 12)}); err == nil {
+		t.Fatal("expected size mismatch error")
+	}
+}
+
+func BenchmarkFuseExposuresYUYV(b *testing.B) {
+	const size = 1280 * 720 * 2
+	exposures := make([][]byte, 3)
+	for i := range exposures {
+		exposures[i] = make([]byte, size)
+		for j := range exposures[i] {
+			exposures[i][j] = byte(j*7 + i*60)
+		}
+	}
+	dst := make([]byte, size)
+	b.SetBytes(size)
+	for i := 0; i < b.N; i++ {
+		FuseExposuresYUYV(dst, exposures)
+	}
+}
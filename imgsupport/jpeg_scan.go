@@ -0,0 +1,547 @@
+package imgsupport
+
+import (
+	"errors"
+	"fmt"
+)
+
+// This file holds a minimal baseline JPEG (MJPEG) entropy decoder. It parses the frame
+// headers and walks the Huffman coded scan block by block, yielding the quantized DCT
+// coefficients without dequantizing or transforming them: enough to inspect (DC values)
+// or rewrite (AC values) compressed frames at a fraction of the cost of a full decode.
+
+var (
+	errJPEGFormat      = errors.New("jpeg: invalid format")
+	errJPEGUnsupported = errors.New("jpeg: unsupported format")
+)
+
+// jpegHuffman is a canonical Huffman table, with a lookup table for codes up to
+// jpegLookupBits long and code tables for encoding.
+type jpegHuffman struct {
+	lookup  [1 << jpegLookupBits]uint16 // (code size << 8) | value, 0 for longer codes
+	maxCode [17]int32                   // largest code of each size, -1 when none
+	valPtr  [17]int32                   // index in vals of the codes of each size, less the first code
+	vals    [256]byte
+
+	code [256]uint16 // code of each value
+	size [256]uint8  // code size of each value, 0 when not in the table
+}
+
+const jpegLookupBits = 9
+
+// init builds the table from its DHT specification: the number of codes of each
+// size (1 to 16 bits) followed by the values in code order.
+func (h *jpegHuffman) init(counts []byte, vals []byte) error {
+	total := 0
+	for _, n := range counts {
+		total += int(n)
+	}
+	if total == 0 || total > 256 || total != len(vals) {
+		return errJPEGFormat
+	}
+	h.lookup = [1 << jpegLookupBits]uint16{}
+	h.size = [256]uint8{}
+	copy(h.vals[:], vals)
+
+	code, k := int32(0), 0
+	for size := 1; size <= 16; size++ {
+		n := int(counts[size-1])
+		h.valPtr[size] = int32(k) - code
+		for i := 0; i < n; i++ {
+			// more codes than the size allows: checked before they are written
+			if code >= 1<<uint(size) {
+				return errJPEGFormat
+			}
+			v := vals[k]
+			h.code[v], h.size[v] = uint16(code), uint8(size)
+			if size <= jpegLookupBits {
+				shift := uint(jpegLookupBits - size)
+				for j := int32(0); j < 1<<shift; j++ {
+					h.lookup[code<<shift|j] = uint16(size)<<8 | uint16(v)
+				}
+			}
+			code++
+			k++
+		}
+		h.maxCode[size] = code - 1
+		if n == 0 {
+			h.maxCode[size] = -1
+		}
+		code <<= 1
+	}
+	return nil
+}
+
+// Default Huffman tables (ITU T.81, annex K.3), used by MJPEG frames without DHT segment
+var jpegDefaultDC, jpegDefaultAC [2]jpegHuffman
+
+func init() {
+	dcCounts := [2][]byte{
+		{0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0},
+		{0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0},
+	}
+	dcVals := []byte{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11}
+	acCounts := [2][]byte{
+		{0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 125},
+		{0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 119},
+	}
+	acVals := [2][]byte{
+		{
+			0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+			0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+			0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+			0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+			0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+			0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+			0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+			0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+			0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+			0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+			0xf9, 0xfa,
+		},
+		{
+			0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+			0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+			0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+			0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+			0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+			0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+			0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+			0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+			0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+			0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+			0xf9, 0xfa,
+		},
+	}
+	for i := 0; i < 2; i++ {
+		if err := jpegDefaultDC[i].init(dcCounts[i], dcVals); err != nil {
+			panic(err)
+		}
+		if err := jpegDefaultAC[i].init(acCounts[i], acVals[i]); err != nil {
+			panic(err)
+		}
+	}
+}
+
+// jpegBits reads the entropy coded segment of a scan. Stuffed bytes (0xFF00) are
+// removed, and zero bits are fed once a marker is reached.
+type jpegBits struct {
+	data     []byte
+	pos      int
+	acc      uint64 // buffered bits, in the low n bits
+	n        uint
+	atMarker bool // pos is at a marker
+	padding  int  // zero bytes fed past the end of the segment
+}
+
+func (r *jpegBits) reset(data []byte) {
+	*r = jpegBits{data: data}
+}
+
+func (r *jpegBits) fill() {
+	for r.n <= 56 {
+		var b byte
+		switch {
+		case r.atMarker || r.pos >= len(r.data):
+			r.padding++
+		case r.data[r.pos] != 0xFF:
+			b = r.data[r.pos]
+			r.pos++
+		case r.pos+1 < len(r.data) && r.data[r.pos+1] == 0:
+			b = 0xFF
+			r.pos += 2
+		default:
+			r.atMarker = true
+			r.padding++
+		}
+		r.acc = r.acc<<8 | uint64(b)
+		r.n += 8
+	}
+}
+
+// decode reads a Huffman coded value
+func (r *jpegBits) decode(h *jpegHuffman) (byte, error) {
+	if r.n < 16 {
+		r.fill()
+	}
+	if e := h.lookup[(r.acc>>(r.n-jpegLookupBits))&(1<<jpegLookupBits-1)]; e != 0 {
+		r.n -= uint(e >> 8)
+		return byte(e), nil
+	}
+	code := int32(0)
+	for size := uint(1); size <= 16; size++ {
+		code = code<<1 | int32((r.acc>>(r.n-size))&1)
+		if code <= h.maxCode[size] {
+			r.n -= size
+			return h.vals[code+h.valPtr[size]], nil
+		}
+	}
+	return 0, errJPEGFormat
+}
+
+// receive reads an s bits long value and extends its sign (ITU T.81, F.2.2.1)
+func (r *jpegBits) receive(s uint) int32 {
+	if s == 0 {
+		return 0
+	}
+	if r.n < s {
+		r.fill()
+	}
+	v := int32((r.acc >> (r.n - s)) & (1<<s - 1))
+	r.n -= s
+	if v < 1<<(s-1) {
+		v += -1<<s + 1
+	}
+	return v
+}
+
+// skip discards s bits
+func (r *jpegBits) skip(s uint) {
+	if r.n < s {
+		r.fill()
+	}
+	r.n -= s
+}
+
+// restart skips the restart marker expected at the end of a restart interval
+func (r *jpegBits) restart() error {
+	if !r.atMarker {
+		// the marker was not reached yet: remaining bits (if any) are padding
+		for r.pos < len(r.data) && r.data[r.pos] != 0xFF {
+			r.pos++
+		}
+	}
+	if r.pos+1 >= len(r.data) || r.data[r.pos+1] < 0xD0 || r.data[r.pos+1] > 0xD7 {
+		return fmt.Errorf("jpeg: missing restart marker: %w", errJPEGFormat)
+	}
+	r.pos += 2
+	r.acc, r.n, r.atMarker, r.padding = 0, 0, false, 0
+	return nil
+}
+
+type jpegComponent struct {
+	id      byte
+	h, v    int // sampling factors
+	tq      int // quantization table
+	td, ta  int // DC and AC Huffman tables (for the scan)
+	blocksX int // blocks per line
+	blocksY int // blocks per column
+	pred    int32
+}
+
+// jpegScan holds the decoding state of a baseline JPEG frame. It can be reused across
+// frames to avoid allocations.
+type jpegScan struct {
+	width, height int
+	comps         [4]jpegComponent
+	ncomps        int
+	hmax, vmax    int
+	quant         [4][64]uint16 // quantization tables (zigzag order)
+	restartEvery  int
+	scan          [4]int // components of the scan (indices in comps)
+	nscan         int
+
+	dcStore, acStore [4]jpegHuffman
+	dc, ac           [4]*jpegHuffman
+
+	entropy int // offset of the entropy coded segment in the frame
+	bits    jpegBits
+	block   [64]int32
+	dcOnly  bool // skip AC coefficients instead of storing them in block
+}
+
+// parse reads the frame headers up to the start of the (first) scan
+func (s *jpegScan) parse(data []byte) error {
+	if len(data) < 4 || data[0] != 0xFF || data[1] != 0xD8 {
+		return errJPEGFormat
+	}
+	s.ncomps, s.nscan, s.restartEvery = 0, 0, 0
+	s.dc, s.ac = [4]*jpegHuffman{}, [4]*jpegHuffman{}
+
+	pos := 2
+	for {
+		// markers may be preceded by fill bytes
+		for pos < len(data) && data[pos] == 0xFF {
+			pos++
+		}
+		if pos+2 >= len(data) || data[pos-1] != 0xFF {
+			return errJPEGFormat
+		}
+		marker := data[pos]
+		pos++
+		if marker >= 0xD0 && marker <= 0xD7 || marker == 0x01 {
+			continue // standalone markers
+		}
+		length := int(data[pos])<<8 | int(data[pos+1])
+		if length < 2 || pos+length > len(data) {
+			return errJPEGFormat
+		}
+		seg := data[pos+2 : pos+length]
+		pos += length
+
+		var err error
+		switch marker {
+		case 0xC0, 0xC1: // baseline, extended sequential (Huffman)
+			err = s.parseFrameHeader(seg)
+		case 0xC2, 0xC3, 0xC5, 0xC6, 0xC7, 0xC9, 0xCA, 0xCB, 0xCD, 0xCE, 0xCF:
+			return errJPEGUnsupported // progressive, lossless, arithmetic
+		case 0xC4:
+			err = s.parseHuffmanTables(seg)
+		case 0xDB:
+			err = s.parseQuantTables(seg)
+		case 0xDD:
+			if len(seg) < 2 {
+				return errJPEGFormat
+			}
+			s.restartEvery = int(seg[0])<<8 | int(seg[1])
+		case 0xDA:
+			if err := s.parseScanHeader(seg); err != nil {
+				return err
+			}
+			s.entropy = pos
+			return nil
+		case 0xD9:
+			return errJPEGFormat
+		}
+		if err != nil {
+			return err
+		}
+	}
+}
+
+func (s *jpegScan) parseFrameHeader(seg []byte) error {
+	if len(seg) < 6 || seg[0] != 8 {
+		return errJPEGUnsupported // 12-bit samples
+	}
+	s.height = int(seg[1])<<8 | int(seg[2])
+	s.width = int(seg[3])<<8 | int(seg[4])
+	s.ncomps = int(seg[5])
+	if s.width == 0 || s.height == 0 || s.ncomps == 0 || s.ncomps > 4 || len(seg) < 6+3*s.ncomps {
+		return errJPEGUnsupported
+	}
+	s.hmax, s.vmax = 1, 1
+	for i := 0; i < s.ncomps; i++ {
+		c := &s.comps[i]
+		c.id = seg[6+3*i]
+		c.h, c.v = int(seg[7+3*i]>>4), int(seg[7+3*i]&15)
+		c.tq = int(seg[8+3*i] & 3)
+		if c.h < 1 || c.h > 4 || c.v < 1 || c.v > 4 {
+			return errJPEGFormat
+		}
+		if c.h > s.hmax {
+			s.hmax = c.h
+		}
+		if c.v > s.vmax {
+			s.vmax = c.v
+		}
+	}
+	for i := 0; i < s.ncomps; i++ {
+		c := &s.comps[i]
+		c.blocksX = ((s.width*c.h+s.hmax-1)/s.hmax + 7) / 8
+		c.blocksY = ((s.height*c.v+s.vmax-1)/s.vmax + 7) / 8
+	}
+	return nil
+}
+
+func (s *jpegScan) parseHuffmanTables(seg []byte) error {
+	for len(seg) > 17 {
+		class, index := seg[0]>>4, int(seg[0]&3)
+		counts := seg[1:17]
+		total := 0
+		for _, n := range counts {
+			total += int(n)
+		}
+		if len(seg) < 17+total || class > 1 {
+			return errJPEGFormat
+		}
+		table := &s.dcStore[index]
+		if class == 1 {
+			table = &s.acStore[index]
+		}
+		if err := table.init(counts, seg[17:17+total]); err != nil {
+			return err
+		}
+		if class == 0 {
+			s.dc[index] = table
+		} else {
+			s.ac[index] = table
+		}
+		seg = seg[17+total:]
+	}
+	return nil
+}
+
+func (s *jpegScan) parseQuantTables(seg []byte) error {
+	for len(seg) > 0 {
+		precision, index := seg[0]>>4, int(seg[0]&3)
+		q := &s.quant[index]
+		switch {
+		case precision == 0 && len(seg) >= 65:
+			for i := 0; i < 64; i++ {
+				q[i] = uint16(seg[1+i])
+			}
+			seg = seg[65:]
+		case precision == 1 && len(seg) >= 129:
+			for i := 0; i < 64; i++ {
+				q[i] = uint16(seg[1+2*i])<<8 | uint16(seg[2+2*i])
+			}
+			seg = seg[129:]
+		default:
+			return errJPEGFormat
+		}
+	}
+	return nil
+}
+
+func (s *jpegScan) parseScanHeader(seg []byte) error {
+	if s.ncomps == 0 || len(seg) < 1 {
+		return errJPEGFormat
+	}
+	s.nscan = int(seg[0])
+	if s.nscan < 1 || s.nscan > s.ncomps || len(seg) < 1+2*s.nscan+3 {
+		return errJPEGFormat
+	}
+	for i := 0; i < s.nscan; i++ {
+		id, tables := seg[1+2*i], seg[2+2*i]
+		found := false
+		for j := 0; j < s.ncomps; j++ {
+			if s.comps[j].id == id {
+				s.scan[i] = j
+				s.comps[j].td, s.comps[j].ta = int(tables>>4&3), int(tables&3)
+				found = true
+			}
+		}
+		if !found {
+			return errJPEGFormat
+		}
+	}
+	// MJPEG frames usually omit the (standard) Huffman tables
+	for i := 0; i < 2; i++ {
+		if s.dc[i] == nil {
+			s.dc[i] = &jpegDefaultDC[i]
+		}
+		if s.ac[i] == nil {
+			s.ac[i] = &jpegDefaultAC[i]
+		}
+	}
+	for i := 0; i < s.nscan; i++ {
+		c := &s.comps[s.scan[i]]
+		if s.dc[c.td] == nil || s.ac[c.ta] == nil {
+			return errJPEGFormat
+		}
+	}
+	return nil
+}
+
+// decodeBlock decodes the quantized coefficients (zigzag order) of the next block of component c
+func (s *jpegScan) decodeBlock(c *jpegComponent) error {
+	blk := &s.block
+	if !s.dcOnly {
+		*blk = [64]int32{}
+	}
+
+	t, err := s.bits.decode(s.dc[c.td])
+	if err != nil {
+		return err
+	}
+	if t > 11 {
+		return errJPEGFormat
+	}
+	c.pred += s.bits.receive(uint(t))
+	blk[0] = c.pred
+
+	ac := s.ac[c.ta]
+	for k := 1; k < 64; {
+		rs, err := s.bits.decode(ac)
+		if err != nil {
+			return err
+		}
+		run, size := int(rs>>4), uint(rs&15)
+		if size == 0 {
+			if run != 15 {
+				break // end of block
+			}
+			k += 16
+			continue
+		}
+		k += run
+		if k > 63 {
+			return errJPEGFormat
+		}
+		if s.dcOnly {
+			s.bits.skip(size)
+		} else {
+			blk[k] = s.bits.receive(size)
+		}
+		k++
+	}
+	if s.bits.padding > 8 {
+		return fmt.Errorf("jpeg: truncated scan: %w", errJPEGFormat)
+	}
+	return nil
+}
+
+// jpegBlockFunc is called for each block of a scan, in stream order, with the index of
+// the block component, the block position within the component, and its quantized
+// coefficients in zigzag order (with the DC value resolved, not differential). Only the
+// DC coefficient is set when the scan is walked with dcOnly.
+type jpegBlockFunc func(comp, bx, by int, blk *[64]int32)
+
+// walk decodes the scan of the parsed frame data, calling block for each block. When not
+// nil, restart is called at each restart marker with its number (0 to 7).
+func (s *jpegScan) walk(data []byte, block jpegBlockFunc, restart func(n int)) error {
+	s.bits.reset(data[s.entropy:])
+	for i := 0; i < s.ncomps; i++ {
+		s.comps[i].pred = 0
+	}
+
+	var mcusX, mcusY int
+	if s.nscan == 1 {
+		c := &s.comps[s.scan[0]]
+		mcusX, mcusY = c.blocksX, c.blocksY
+	} else {
+		mcusX = (s.width + 8*s.hmax - 1) / (8 * s.hmax)
+		mcusY = (s.height + 8*s.vmax - 1) / (8 * s.vmax)
+	}
+
+	mcu, rst := 0, 0
+	for my := 0; my < mcusY; my++ {
+		for mx := 0; mx < mcusX; mx++ {
+			if s.restartEvery > 0 && mcu > 0 && mcu%s.restartEvery == 0 {
+				if err := s.bits.restart(); err != nil {
+					return err
+				}
+				for i := 0; i < s.ncomps; i++ {
+					s.comps[i].pred = 0
+				}
+				if restart != nil {
+					restart(rst)
+				}
+				rst = (rst + 1) & 7
+			}
+			mcu++
+
+			if s.nscan == 1 {
+				index := s.scan[0]
+				if err := s.decodeBlock(&s.comps[index]); err != nil {
+					return err
+				}
+				block(index, mx, my, &s.block)
+				continue
+			}
+			for i := 0; i < s.nscan; i++ {
+				index := s.scan[i]
+				c := &s.comps[index]
+				for v := 0; v < c.v; v++ {
+					for h := 0; h < c.h; h++ {
+						if err := s.decodeBlock(c); err != nil {
+							return err
+						}
+						block(index, mx*c.h+h, my*c.v+v, &s.block)
+					}
+				}
+			}
+		}
+	}
+	return nil
+}
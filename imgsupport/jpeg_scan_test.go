@@ -0,0 +1,74 @@
+package imgsupport
+
+import (
+	"bytes"
+	"errors"
+	"image"
+	"image/jpeg"
+	"math/rand"
+	"testing"
+)
+
+func TestJPEGHuffmanMalformed(t *testing.T) {
+	vals := make([]byte, 256)
+	for i := range vals {
+		vals[i] = byte(i)
+	}
+	for _, counts := range [][]byte{
+		{3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},   // 3 codes of 1 bit
+		{0, 5, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},   // 5 codes of 2 bits
+		{1, 1, 1, 1, 1, 1, 1, 1, 3, 0, 0, 0, 0, 0, 0, 0},   // overflows at 9 bits
+		{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 255}, // fits, 16 bits
+		{2, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},   // 1 bit codes full, no room left
+	} {
+		total := 0
+		for _, n := range counts {
+			total += int(n)
+		}
+		var h jpegHuffman
+		err := h.init(counts, vals[:total])
+		if fits := counts[15] == 255; fits != (err == nil) {
+			t.Fatalf("counts %v: %v", counts, err)
+		}
+		if err != nil && !errors.Is(err, errJPEGFormat) {
+			t.Fatalf("counts %v: unexpected error %v", counts, err)
+		}
+	}
+}
+
+// TestJPEGScanCorrupt feeds corrupted frames to the MJPEG entry points: they must fail
+// (or succeed) without panicking
+func TestJPEGScanCorrupt(t *testing.T) {
+	var buf bytes.Buffer
+	if err := jpeg.Encode(&buf, testYCbCr(64, 48), &jpeg.Options{Quality: 75}); err != nil {
+		t.Fatal(err)
+	}
+	frame := buf.Bytes()
+	dht := bytes.Index(frame, []byte{0xFF, 0xC4})
+	if dht < 0 {
+		t.Fatal("no DHT segment")
+	}
+	mask, err := NewPrivacyMask(64, 48, PrivacyMaskConfig{}, rect(8, 8, 24, 24))
+	if err != nil {
+		t.Fatal(err)
+	}
+	grid := NewLumaGrid(4, 3)
+
+	rnd := rand.New(rand.NewSource(1))
+	corrupt := make([]byte, len(frame))
+	var out []byte
+	for i := 0; i < 2000; i++ {
+		copy(corrupt, frame)
+		if i%2 == 0 {
+			// code counts of the first table (after marker, length and class/index)
+			corrupt[dht+5+rnd.Intn(16)] = byte(rnd.Intn(256))
+		} else {
+			for n := 0; n < 4; n++ {
+				corrupt[2+rnd.Intn(len(corrupt)-2)] = byte(rnd.Intn(256))
+			}
+		}
+		grid.FromMJPEG(corrupt)
+		SharpnessMJPEG(corrupt, image.Rect(0, 0, 64, 48))
+		out, _ = mask.ApplyMJPEG(out[:0], corrupt)
+	}
+}
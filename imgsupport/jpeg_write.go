@@ -0,0 +1,113 @@
+package imgsupport
+
+import (
+	"fmt"
+	"math/bits"
+)
+
+// jpegWriter Huffman codes quantized blocks into an entropy coded segment, the inverse of
+// jpegBits: 0xFF bytes are stuffed, and the last byte before a marker is padded with 1 bits.
+type jpegWriter struct {
+	out []byte
+	acc uint32 // pending bits, in the low n bits
+	n   uint
+	err error
+}
+
+// bits writes the low size bits of v
+func (w *jpegWriter) bits(v uint32, size uint) {
+	w.acc = w.acc<<size | v&(1<<size-1)
+	w.n += size
+	for w.n >= 8 {
+		b := byte(w.acc >> (w.n - 8))
+		w.out = append(w.out, b)
+		if b == 0xFF {
+			w.out = append(w.out, 0)
+		}
+		w.n -= 8
+	}
+}
+
+// emit writes the Huffman code of value v
+func (w *jpegWriter) emit(h *jpegHuffman, v byte) {
+	if h.size[v] == 0 {
+		if w.err == nil {
+			w.err = fmt.Errorf("jpeg: no Huffman code for %#x: %w", v, errJPEGUnsupported)
+		}
+		return
+	}
+	w.bits(uint32(h.code[v]), uint(h.size[v]))
+}
+
+// flush pads the pending bits to a byte boundary
+func (w *jpegWriter) flush() {
+	if w.n > 0 {
+		w.bits(0xff, 8-w.n)
+	}
+}
+
+// marker flushes pending bits and writes a marker
+func (w *jpegWriter) marker(m byte) {
+	w.flush()
+	w.out = append(w.out, 0xFF, m)
+}
+
+// magnitude returns the size category of v and the bits coding it (ITU T.81, F.1.2.1)
+func magnitude(v int32) (uint, uint32) {
+	if v < 0 {
+		return uint(bits.Len32(uint32(-v))), uint32(v - 1)
+	}
+	return uint(bits.Len32(uint32(v))), uint32(v)
+}
+
+// encodeBlock writes the quantized coefficients (zigzag order, DC resolved) of a block,
+// coding the DC value as a difference with pred, which is then updated
+func (w *jpegWriter) encodeBlock(blk *[64]int32, dc, ac *jpegHuffman, pred *int32) {
+	size, v := magnitude(blk[0] - *pred)
+	*pred = blk[0]
+	w.emit(dc, byte(size))
+	w.bits(v, size)
+
+	run := 0
+	for k := 1; k < 64; k++ {
+		if blk[k] == 0 {
+			run++
+			continue
+		}
+		for ; run > 15; run -= 16 {
+			w.emit(ac, 0xF0) // run of 16 zeros
+		}
+		size, v := magnitude(blk[k])
+		w.emit(ac, byte(run<<4)|byte(size))
+		w.bits(v, size)
+		run = 0
+	}
+	if run > 0 {
+		w.emit(ac, 0x00) // end of block
+	}
+}
+
+// rewrite re-encodes the parsed frame into dst (which must not overlap frame), calling
+// edit on the quantized coefficients of each block before it is encoded. Headers are
+// copied as is, and the scan is coded with the frame's own Huffman tables.
+func (s *jpegScan) rewrite(dst, frame []byte, edit jpegBlockFunc) ([]byte, error) {
+	s.dcOnly = false
+	w := jpegWriter{out: append(dst[:0], frame[:s.entropy]...)}
+	var preds [4]int32
+	err := s.walk(frame, func(comp, bx, by int, blk *[64]int32) {
+		edit(comp, bx, by, blk)
+		c := &s.comps[comp]
+		w.encodeBlock(blk, s.dc[c.td], s.ac[c.ta], &preds[comp])
+	}, func(n int) {
+		w.marker(0xD0 + byte(n))
+		preds = [4]int32{}
+	})
+	if err == nil {
+		err = w.err
+	}
+	if err != nil {
+		return dst, err
+	}
+	w.marker(0xD9) // end of image
+	return w.out, nil
+}
@@ -0,0 +1,246 @@
+package imgsupport
+
+import (
+	"fmt"
+	"image"
+)
+
+// On-screen display: text burned into YUV frames in place. Glyphs are rendered once into
+// coverage masks (a GlyphAtlas), from which an Overlay derives, once per glyph, the blend
+// table of the cell in the frame layout: burning a line of text into a frame is then one
+// multiply-add per sample of the cells, with no color conversion.
+
+// GlyphAtlas holds the coverage masks (0 to 255) of a set of glyphs, all of one cell size
+type GlyphAtlas struct {
+	width, height int
+	masks         map[rune][]byte
+	fallback      rune // glyph drawn for runes not in the atlas (none if 0)
+}
+
+// NewGlyphAtlas renders the glyphs of runes with render, which draws a rune into a mask
+// of the cell size (i.e. with golang.org/x/image/font). Cell sizes must be even.
+func NewGlyphAtlas(width, height int, runes string, render func(r rune, mask *image.Alpha)) (*GlyphAtlas, error) {
+	if width <= 0 || height <= 0 || width%2 != 0 || height%2 != 0 {
+		return nil, fmt.Errorf("glyph atlas: invalid cell size %dx%d", width, height)
+	}
+	a := &GlyphAtlas{width: width, height: height, masks: make(map[rune][]byte)}
+	for _, r := range runes {
+		mask := image.NewAlpha(image.Rect(0, 0, width, height))
+		render(r, mask)
+		a.masks[r] = mask.Pix
+	}
+	return a, nil
+}
+
+// CellSize returns the size of the glyph cells
+func (a *GlyphAtlas) CellSize() (width, height int) {
+	return a.width, a.height
+}
+
+// OverlayStyle sets the colors (Y, U, V) of overlay text
+type OverlayStyle struct {
+	Foreground [3]byte
+
+	// Outline draws a one pixel border of the OutlineColor around glyphs, for legibility
+	// on any background
+	Outline      bool
+	OutlineColor [3]byte
+
+	// BackgroundAlpha blends the Background color into the cells (0 for none, 255 for an opaque box)
+	Background      [3]byte
+	BackgroundAlpha byte
+}
+
+// DefaultOverlayStyle is white text outlined in black (limited range YUV)
+var DefaultOverlayStyle = OverlayStyle{
+	Foreground:   [3]byte{235, 128, 128},
+	Outline:      true,
+	OutlineColor: [3]byte{16, 128, 128},
+}
+
+// overlayCell is the blend table of a glyph: a sample s of the cell becomes (s*k + c) >> 8
+type overlayCell struct {
+	blank      bool // leaves the frame untouched
+	lumaK      []uint16
+	lumaC      []uint16
+	chromaK    []uint16
+	chromaC    [2][]uint16
+	chromaW    int
+	chromaRows int
+}
+
+// Overlay is a line of text burned into frames of one layout and size, at a fixed position
+type Overlay struct {
+	atlas         *GlyphAtlas
+	style         OverlayStyle
+	width, height int
+	size          int // frame size
+	at            image.Point
+	planes        [3]plane
+	cx, cy        int // chroma subsampling
+
+	cells map[rune]*overlayCell
+	runes []rune
+	text  []*overlayCell
+}
+
+// NewOverlay returns an overlay drawing text with the glyphs of atlas into width x height
+// frames of a YUV layout, with the top left corner of the first cell at (even) point at
+func NewOverlay(atlas *GlyphAtlas, style OverlayStyle, layout Layout, width, height int, at image.Point) (*Overlay, error) {
+	if layout == LayoutRGBA || layout.FrameSize(2, 2) == 0 {
+		return nil, fmt.Errorf("overlay: unsupported layout %s", layout)
+	}
+	if at.X < 0 || at.Y < 0 || at.X%2 != 0 || at.Y%2 != 0 || at.Y+atlas.height > height || at.X+atlas.width > width {
+		return nil, fmt.Errorf("overlay: invalid position %v in %dx%d frames", at, width, height)
+	}
+	planes := layout.planes(width, height)
+	return &Overlay{
+		atlas:  atlas,
+		style:  style,
+		width:  width,
+		height: height,
+		size:   layout.FrameSize(width, height),
+		at:     at,
+		planes: planes,
+		cx:     width / planes[1].w,
+		cy:     height / planes[1].h,
+		cells:  make(map[rune]*overlayCell),
+	}, nil
+}
+
+// Set sets the text drawn. Only the cells of the characters that changed are updated,
+// and the blend table of a glyph is only computed the first time it is drawn.
+func (o *Overlay) Set(text string) {
+	i := 0
+	for _, r := range text {
+		if i < len(o.runes) {
+			if o.runes[i] != r {
+				o.runes[i], o.text[i] = r, o.cell(r)
+			}
+		} else {
+			o.runes = append(o.runes, r)
+			o.text = append(o.text, o.cell(r))
+		}
+		i++
+	}
+	o.runes, o.text = o.runes[:i], o.text[:i]
+}
+
+// Draw burns the text into frame. Characters past the right edge of the frame are not drawn.
+func (o *Overlay) Draw(frame []byte) error {
+	if len(frame) < o.size {
+		return fmt.Errorf("overlay: frame too small: %d bytes", len(frame))
+	}
+	cw := o.atlas.width
+	for i, c := range o.text {
+		x := o.at.X + i*cw
+		if x+cw > o.width {
+			break
+		}
+		if c.blank {
+			continue
+		}
+		luma := o.planes[0]
+		blendCell(frame, luma.off+o.at.Y*luma.stride+x*luma.step, luma.step, luma.stride, c.lumaK, c.lumaC, cw, o.atlas.height)
+		for j, p := range o.planes[1:] {
+			off := p.off + o.at.Y/o.cy*p.stride + x/o.cx*p.step
+			blendCell(frame, off, p.step, p.stride, c.chromaK, c.chromaC[j], c.chromaW, c.chromaRows)
+		}
+	}
+	return nil
+}
+
+func blendCell(frame []byte, off, step, stride int, k, c []uint16, w, h int) {
+	for y := 0; y < h; y++ {
+		row := frame[off+y*stride : off+y*stride+(w-1)*step+1]
+		rk, rc := k[y*w:y*w+w], c[y*w:y*w+w]
+		for x, o := 0, 0; x < w; x, o = x+1, o+step {
+			row[o] = byte((uint32(row[o])*uint32(rk[x]) + uint32(rc[x]) + 128) >> 8)
+		}
+	}
+}
+
+// cell returns the blend table of the glyph of r, computing it on first use
+func (o *Overlay) cell(r rune) *overlayCell {
+	if c, ok := o.cells[r]; ok {
+		return c
+	}
+	mask, ok := o.atlas.masks[r]
+	if !ok {
+		mask = o.atlas.masks[o.atlas.fallback]
+	}
+	c := o.render(mask)
+	o.cells[r] = c
+	return c
+}
+
+// render computes the blend table of a glyph mask (nil for an empty glyph)
+func (o *Overlay) render(mask []byte) *overlayCell {
+	w, h := o.atlas.width, o.atlas.height
+	cw, crows := w/o.cx, h/o.cy
+	c := &overlayCell{
+		blank:      true,
+		lumaK:      make([]uint16, w*h),
+		lumaC:      make([]uint16, w*h),
+		chromaK:    make([]uint16, cw*crows),
+		chromaC:    [2][]uint16{make([]uint16, cw*crows), make([]uint16, cw*crows)},
+		chromaW:    cw,
+		chromaRows: crows,
+	}
+
+	s := o.style
+	block := uint32(o.cx * o.cy)
+	for y := 0; y < h; y++ {
+		for x := 0; x < w; x++ {
+			// layers from the bottom up: background box, outline, glyph
+			a, col := over(coverage(s.BackgroundAlpha), s.Background, 0, [3]uint32{})
+			if s.Outline {
+				a, col = over(coverage(dilate(mask, w, h, x, y)), s.OutlineColor, a, col)
+			}
+			if mask != nil {
+				a, col = over(coverage(mask[y*w+x]), s.Foreground, a, col)
+			}
+			if a != 0 {
+				c.blank = false
+			}
+
+			c.lumaK[y*w+x], c.lumaC[y*w+x] = uint16(256-a), uint16(col[0])
+			// chroma samples average the pixels they cover
+			ci := y/o.cy*cw + x/o.cx
+			c.chromaK[ci] += uint16((256 - a) / block)
+			c.chromaC[0][ci] += uint16(col[1] / block)
+			c.chromaC[1][ci] += uint16(col[2] / block)
+		}
+	}
+	return c
+}
+
+// coverage maps a mask value to 0 to 256
+func coverage(v byte) uint32 {
+	return uint32(v) + uint32(v)>>7
+}
+
+// over composites a layer of color and coverage a (0 to 256) over layers of coverage
+// underA and premultiplied color underC, and returns the coverage and color of the result
+func over(a uint32, color [3]byte, underA uint32, underC [3]uint32) (uint32, [3]uint32) {
+	for ch := range underC {
+		underC[ch] = uint32(color[ch])*a + underC[ch]*(256-a)>>8
+	}
+	return a + underA*(256-a)>>8, underC
+}
+
+// dilate returns the maximum coverage of the 3x3 neighborhood of (x, y) in mask
+func dilate(mask []byte, w, h, x, y int) byte {
+	var m byte
+	if mask == nil {
+		return 0
+	}
+	for yy := y - 1; yy <= y+1; yy++ {
+		for xx := x - 1; xx <= x+1; xx++ {
+			if xx >= 0 && yy >= 0 && xx < w && yy < h && mask[yy*w+xx] > m {
+				m = mask[yy*w+xx]
+			}
+		}
+	}
+	return m
+}
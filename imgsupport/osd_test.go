@@ -0,0 +1,109 @@
+package imgsupport
+
+import (
+	"image"
+	"testing"
+)
+
+func TestOverlay(t *testing.T) {
+	atlas := BasicAtlas(2)
+	cw, ch := atlas.CellSize()
+	for _, layout := range []Layout{LayoutYUYV, LayoutNV12, LayoutI420} {
+		const w, h = 160, 40
+		frame := make([]byte, layout.FrameSize(w, h))
+		if err := Fill(frame, layout, w, h, image.Rect(0, 0, w, h), [4]byte{100, 128, 128}); err != nil {
+			t.Fatal(err)
+		}
+		o, err := NewOverlay(atlas, DefaultOverlayStyle, layout, w, h, image.Pt(4, 2))
+		if err != nil {
+			t.Fatal(err)
+		}
+		o.Set("1 1")
+		if err := o.Draw(frame); err != nil {
+			t.Fatal(err)
+		}
+
+		planes := layout.planes(w, h)
+		luma := planes[0]
+		at := func(x, y int) byte { return frame[luma.off+y*luma.stride+x*luma.step] }
+		// the stem of the '1' (glyph column 2, rows 2 to 5 of the font) is white, and outlined
+		stem := 4 + 1 + 2*2
+		for y := 2 + 2 + 2*2; y < 2+2+2*6; y++ {
+			if v := at(stem, y); v != 235 {
+				t.Fatalf("%s: stem luma at (%d,%d): %d", layout, stem, y, v)
+			}
+			if v := at(stem-1, y); v != 16 {
+				t.Fatalf("%s: outline luma at (%d,%d): %d", layout, stem-1, y, v)
+			}
+		}
+		// the space and the frame past the text are untouched
+		for y := 0; y < h; y++ {
+			for x := 4 + cw; x < 4+2*cw; x++ {
+				if v := at(x, y); v != 100 {
+					t.Fatalf("%s: luma at (%d,%d) under a space: %d", layout, x, y, v)
+				}
+			}
+			for x := 4 + 3*cw; x < w; x++ {
+				if v := at(x, y); v != 100 {
+					t.Fatalf("%s: luma at (%d,%d) past the text: %d", layout, x, y, v)
+				}
+			}
+		}
+		if at(stem, 2+ch) != 100 {
+			t.Fatalf("%s: luma below the text changed", layout)
+		}
+		// chroma stays neutral for gray text
+		for _, p := range planes[1:] {
+			for y := 0; y < p.h; y++ {
+				for x := 0; x < p.w; x++ {
+					if v := frame[p.off+y*p.stride+x*p.step]; v < 127 || v > 129 {
+						t.Fatalf("%s: chroma at (%d,%d): %d", layout, x, y, v)
+					}
+				}
+			}
+		}
+	}
+}
+
+func TestOverlaySet(t *testing.T) {
+	o, err := NewOverlay(BasicAtlas(1), DefaultOverlayStyle, LayoutYUYV, 320, 20, image.Pt(0, 0))
+	if err != nil {
+		t.Fatal(err)
+	}
+	o.Set("12:00:00")
+	first := append([]*overlayCell(nil), o.text...)
+	o.Set("12:00:01 cam")
+	for i := 0; i < 7; i++ {
+		if o.text[i] != first[i] {
+			t.Fatalf("unchanged character %d updated", i)
+		}
+	}
+	if o.text[0] != o.text[7] || o.text[0] != o.cells['1'] {
+		t.Fatal("glyph tables not shared")
+	}
+	if o.text[9] != o.cells['C'] && o.text[9] != o.cells['c'] {
+		t.Fatal("lower case glyph missing")
+	}
+	if len(o.text) != 12 {
+		t.Fatalf("%d cells", len(o.text))
+	}
+	o.Set("~")
+	if len(o.text) != 1 || o.text[0].blank {
+		t.Fatal("fallback glyph not drawn")
+	}
+}
+
+// BenchmarkOverlayDraw burns a timestamp into a 720p YUYV frame
+func BenchmarkOverlayDraw(b *testing.B) {
+	frame := make([]byte, LayoutYUYV.FrameSize(1280, 720))
+	o, err := NewOverlay(BasicAtlas(2), DefaultOverlayStyle, LayoutYUYV, 1280, 720, image.Pt(16, 16))
+	if err != nil {
+		b.Fatal(err)
+	}
+	o.Set("2026-10-18 12:00:00.000")
+	for i := 0; i < b.N; i++ {
+		if err := o.Draw(frame); err != nil {
+			b.Fatal(err)
+		}
+	}
+}
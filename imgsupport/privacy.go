@@ -0,0 +1,348 @@
+package imgsupport
+
+import (
+	"fmt"
+	"image"
+	"math"
+	"sort"
+	"sync"
+)
+
+// MaskMode selects how a PrivacyMask obscures its regions
+type MaskMode int
+
+const (
+	// MaskFill paints the masked regions with a solid color
+	MaskFill MaskMode = iota
+	// MaskPixelate replaces the masked regions by blocks of their average color
+	MaskPixelate
+)
+
+// PrivacyMaskConfig tunes a PrivacyMask
+type PrivacyMaskConfig struct {
+	Mode MaskMode
+
+	// Color is the fill color (Y, U, V), black when zero
+	Color [3]byte
+
+	// Block is the size of the pixelation blocks, in pixels (16 by default)
+	Block int
+}
+
+// maskSpan is a run of masked samples [x0, x1) of a row
+type maskSpan struct{ x0, x1 int }
+
+// maskRun is a run of n masked samples of a channel, the first at offset off of the frame
+type maskRun struct{ off, n int }
+
+// maskChannel lists the masked samples of a channel of a frame layout
+type maskChannel struct {
+	step   int
+	runs   []maskRun   // all masked runs (fill)
+	blocks [][]maskRun // masked runs of each pixelation block
+	fill   byte
+}
+
+// PrivacyMask is a set of regions of the frames of a camera (i.e. windows of neighbors)
+// to obscure before frames leave the host. Its polygons are rasterized once into spans of
+// masked pixels per row, from which the masked runs of each layout are derived on first
+// use: masking a frame then costs in proportion to the masked area, not the frame size.
+// Raw frames are masked in place (see Apply); MJPEG frames are rewritten at the entropy
+// coding level, without a decode to pixels (see ApplyMJPEG). Masks are conservative: a
+// chroma sample (or an MJPEG MCU) covering a masked pixel is masked.
+type PrivacyMask struct {
+	width, height int
+	config        PrivacyMaskConfig
+	rows          [][]maskSpan // masked pixels of each row
+
+	mu       sync.Mutex
+	channels map[Layout]*[3]maskChannel
+	grids    map[image.Point]*maskGrid
+}
+
+// maskGrid tells which cells of a grid (of MCUs) hold masked pixels
+type maskGrid struct {
+	cols   int
+	masked []bool
+}
+
+// NewPrivacyMask returns a mask of the polygons of width x height frames. Polygons are
+// filled with the even-odd rule; their points are pixel corners, so that the polygon
+// (0,0) (2,0) (2,2) (0,2) covers four pixels.
+func NewPrivacyMask(width, height int, config PrivacyMaskConfig, polygons ...[]image.Point) (*PrivacyMask, error) {
+	if width <= 0 || height <= 0 || width%2 != 0 || height%2 != 0 {
+		return nil, fmt.Errorf("privacy mask: invalid frame size %dx%d", width, height)
+	}
+	if config.Color == [3]byte{} {
+		config.Color = [3]byte{16, 128, 128}
+	}
+	if config.Block <= 0 {
+		config.Block = 16
+	}
+	m := &PrivacyMask{
+		width:    width,
+		height:   height,
+		config:   config,
+		rows:     make([][]maskSpan, height),
+		channels: make(map[Layout]*[3]maskChannel),
+		grids:    make(map[image.Point]*maskGrid),
+	}
+	for _, p := range polygons {
+		if len(p) < 3 {
+			return nil, fmt.Errorf("privacy mask: polygon of %d points", len(p))
+		}
+		m.rasterize(p)
+	}
+	for y, spans := range m.rows {
+		m.rows[y] = mergeSpans(spans)
+	}
+	return m, nil
+}
+
+// rasterize adds the spans of the pixels of polygon p (the pixels whose center is inside)
+func (m *PrivacyMask) rasterize(p []image.Point) {
+	var xs []float64
+	for y := 0; y < m.height; y++ {
+		yc := float64(y) + 0.5
+		xs = xs[:0]
+		for i, a := range p {
+			b := p[(i+1)%len(p)]
+			if (float64(a.Y) <= yc) == (float64(b.Y) <= yc) {
+				continue
+			}
+			xs = append(xs, float64(a.X)+(yc-float64(a.Y))*float64(b.X-a.X)/float64(b.Y-a.Y))
+		}
+		sort.Float64s(xs)
+		for i := 0; i+1 < len(xs); i += 2 {
+			// pixels with their center in [xs[i], xs[i+1])
+			x0 := int(math.Ceil(xs[i] - 0.5))
+			x1 := int(math.Ceil(xs[i+1] - 0.5))
+			if x0 < 0 {
+				x0 = 0
+			}
+			if x1 > m.width {
+				x1 = m.width
+			}
+			if x0 < x1 {
+				m.rows[y] = append(m.rows[y], maskSpan{x0, x1})
+			}
+		}
+	}
+}
+
+// mergeSpans sorts spans and merges those overlapping or adjacent
+func mergeSpans(spans []maskSpan) []maskSpan {
+	if len(spans) < 2 {
+		return spans
+	}
+	sort.Slice(spans, func(i, j int) bool { return spans[i].x0 < spans[j].x0 })
+	merged := spans[:1]
+	for _, s := range spans[1:] {
+		last := &merged[len(merged)-1]
+		if s.x0 <= last.x1 {
+			if s.x1 > last.x1 {
+				last.x1 = s.x1
+			}
+			continue
+		}
+		merged = append(merged, s)
+	}
+	return merged
+}
+
+// Area returns the number of masked pixels
+func (m *PrivacyMask) Area() int {
+	n := 0
+	for _, spans := range m.rows {
+		for _, s := range spans {
+			n += s.x1 - s.x0
+		}
+	}
+	return n
+}
+
+// channelsOf returns the masked runs of the channels of layout, derived on first use
+func (m *PrivacyMask) channelsOf(layout Layout) *[3]maskChannel {
+	m.mu.Lock()
+	defer m.mu.Unlock()
+	if c, ok := m.channels[layout]; ok {
+		return c
+	}
+
+	var channels [3]maskChannel
+	for i, p := range layout.planes(m.width, m.height) {
+		cx, cy := m.width/p.w, m.height/p.h
+		bw, bh := (m.config.Block+cx-1)/cx, (m.config.Block+cy-1)/cy
+		blocks := make(map[image.Point]int)
+		c := &channels[i]
+		c.step, c.fill = p.step, m.config.Color[i]
+
+		var spans []maskSpan
+		for sy := 0; sy < p.h; sy++ {
+			// a sample is masked if one of the pixels it covers is
+			spans = spans[:0]
+			for y := sy * cy; y < sy*cy+cy; y++ {
+				for _, s := range m.rows[y] {
+					spans = append(spans, maskSpan{s.x0 / cx, (s.x1 + cx - 1) / cx})
+				}
+			}
+			for _, s := range mergeSpans(spans) {
+				row := p.off + sy*p.stride
+				c.runs = append(c.runs, maskRun{row + s.x0*p.step, s.x1 - s.x0})
+				// split at block boundaries
+				for x := s.x0; x < s.x1; {
+					end := (x/bw + 1) * bw
+					if end > s.x1 {
+						end = s.x1
+					}
+					key := image.Pt(x/bw, sy/bh)
+					b, ok := blocks[key]
+					if !ok {
+						b = len(c.blocks)
+						blocks[key] = b
+						c.blocks = append(c.blocks, nil)
+					}
+					c.blocks[b] = append(c.blocks[b], maskRun{row + x*p.step, end - x})
+					x = end
+				}
+			}
+		}
+	}
+	m.channels[layout] = &channels
+	return &channels
+}
+
+// Apply obscures the masked regions of a raw frame of a YUV layout, in place
+func (m *PrivacyMask) Apply(frame []byte, layout Layout) error {
+	if layout == LayoutRGBA || layout.FrameSize(2, 2) == 0 {
+		return fmt.Errorf("privacy mask: unsupported layout %s", layout)
+	}
+	if len(frame) < layout.FrameSize(m.width, m.height) {
+		return fmt.Errorf("privacy mask: %s frame too small: %d bytes", layout, len(frame))
+	}
+	for _, c := range m.channelsOf(layout) {
+		if m.config.Mode == MaskFill {
+			for _, r := range c.runs {
+				fillRun(frame, r, c.step, c.fill)
+			}
+			continue
+		}
+		for _, runs := range c.blocks {
+			sum, n := 0, 0
+			for _, r := range runs {
+				end := r.off + r.n*c.step
+				for i := r.off; i < end; i += c.step {
+					sum += int(frame[i])
+				}
+				n += r.n
+			}
+			avg := byte((sum + n/2) / n)
+			for _, r := range runs {
+				fillRun(frame, r, c.step, avg)
+			}
+		}
+	}
+	return nil
+}
+
+func fillRun(frame []byte, r maskRun, step int, v byte) {
+	if step == 1 {
+		// contiguous samples: fill by doubling copies, which run on the vectorized memmove
+		run := frame[r.off : r.off+r.n]
+		run[0] = v
+		for n := 1; n < len(run); n *= 2 {
+			copy(run[n:], run[:n])
+		}
+		return
+	}
+	end := r.off + r.n*step
+	for i := r.off; i < end; i += step {
+		frame[i] = v
+	}
+}
+
+// gridOf returns the cells of a grid of cell size holding masked pixels, computed on first use
+func (m *PrivacyMask) gridOf(cell image.Point) *maskGrid {
+	m.mu.Lock()
+	defer m.mu.Unlock()
+	if g, ok := m.grids[cell]; ok {
+		return g
+	}
+	cols, rows := (m.width+cell.X-1)/cell.X, (m.height+cell.Y-1)/cell.Y
+	g := &maskGrid{cols: cols, masked: make([]bool, cols*rows)}
+	for y, spans := range m.rows {
+		for _, s := range spans {
+			for cx := s.x0 / cell.X; cx <= (s.x1-1)/cell.X; cx++ {
+				g.masked[y/cell.Y*cols+cx] = true
+			}
+		}
+	}
+	m.grids[cell] = g
+	return g
+}
+
+// ApplyMJPEG writes to dst (grown as needed, and not overlapping frame) the baseline JPEG
+// frame with its masked MCUs obscured, and returns it. The scan is decoded to quantized
+// coefficients and re-encoded, without dequantization nor DCT: the AC coefficients of
+// masked MCUs are zeroed, which flattens each 8x8 block to its average (MaskPixelate), and
+// their DC coefficients set to the fill color (MaskFill, the color being full range
+// YCbCr, as in JFIF).
+func (m *PrivacyMask) ApplyMJPEG(dst, frame []byte) ([]byte, error) {
+	s := jpegScanPool.Get().(*jpegScan)
+	defer jpegScanPool.Put(s)
+	if err := s.parse(frame); err != nil {
+		return dst, fmt.Errorf("privacy mask: %w", err)
+	}
+	if s.width != m.width || s.height != m.height {
+		return dst, fmt.Errorf("privacy mask: %dx%d frame, mask of %dx%d", s.width, s.height, m.width, m.height)
+	}
+
+	// MCUs of interleaved scans span all components, single component scans have one block MCUs
+	interleaved := s.nscan > 1
+	var grid *maskGrid
+	if interleaved {
+		grid = m.gridOf(image.Pt(8*s.hmax, 8*s.vmax))
+	} else {
+		c := &s.comps[s.scan[0]]
+		grid = m.gridOf(image.Pt(8*s.hmax/c.h, 8*s.vmax/c.v))
+	}
+	var fill [4]int32
+	for i := 0; i < s.ncomps; i++ {
+		v := int32(128)
+		if i < 3 {
+			v = int32(m.config.Color[i])
+		}
+		// the DC coefficient is 8 times the mean of the level shifted samples
+		q := int32(s.quant[s.comps[i].tq][0])
+		if q == 0 {
+			q = 1
+		}
+		dc := (v - 128) * 8
+		if dc < 0 {
+			fill[i] = (dc - q/2) / q
+		} else {
+			fill[i] = (dc + q/2) / q
+		}
+	}
+
+	out, err := s.rewrite(dst, frame, func(comp, bx, by int, blk *[64]int32) {
+		mx, my := bx, by
+		if interleaved {
+			c := &s.comps[comp]
+			mx, my = bx/c.h, by/c.v
+		}
+		if i := my*grid.cols + mx; mx >= grid.cols || i >= len(grid.masked) || !grid.masked[i] {
+			return
+		}
+		for k := 1; k < 64; k++ {
+			blk[k] = 0
+		}
+		if m.config.Mode == MaskFill {
+			blk[0] = fill[comp]
+		}
+	})
+	if err != nil {
+		return dst, fmt.Errorf("privacy mask: %w", err)
+	}
+	return out, nil
+}
@@ -0,0 +1,201 @@
+package imgsupport
+
+import (
+	"bytes"
+	"image"
+	"image/jpeg"
+	"testing"
+)
+
+func rect(x0, y0, x1, y1 int) []image.Point {
+	return []image.Point{{x0, y0}, {x1, y0}, {x1, y1}, {x0, y1}}
+}
+
+func TestPrivacyMaskFill(t *testing.T) {
+	const w, h = 64, 32
+	// a rectangle and a triangle overlapping it
+	m, err := NewPrivacyMask(w, h, PrivacyMaskConfig{}, rect(10, 4, 20, 12), []image.Point{{16, 8}, {40, 8}, {16, 30}})
+	if err != nil {
+		t.Fatal(err)
+	}
+	inside := func(x, y int) bool {
+		if x >= 10 && x < 20 && y >= 4 && y < 12 {
+			return true
+		}
+		// pixel center in the triangle
+		fx, fy := float64(x)+0.5, float64(y)+0.5
+		return fx >= 16 && fy >= 8 && (fx-16)/24+(fy-8)/22 < 1
+	}
+
+	for _, layout := range []Layout{LayoutYUYV, LayoutNV12, LayoutI420} {
+		frame := make([]byte, layout.FrameSize(w, h))
+		for i := range frame {
+			frame[i] = 200
+		}
+		if err := m.Apply(frame, layout); err != nil {
+			t.Fatal(err)
+		}
+		planes := layout.planes(w, h)
+		luma := planes[0]
+		for y := 0; y < h; y++ {
+			for x := 0; x < w; x++ {
+				want := byte(200)
+				if inside(x, y) {
+					want = 16
+				}
+				if got := frame[luma.off+y*luma.stride+x*luma.step]; got != want {
+					t.Fatalf("%s: luma (%d,%d): got %d, want %d", layout, x, y, got, want)
+				}
+			}
+		}
+		// chroma samples covering masked pixels are masked
+		for _, p := range planes[1:] {
+			cx, cy := w/p.w, h/p.h
+			for y := 0; y < p.h; y++ {
+				for x := 0; x < p.w; x++ {
+					masked := false
+					for py := y * cy; py < (y+1)*cy; py++ {
+						for px := x * cx; px < (x+1)*cx; px++ {
+							masked = masked || inside(px, py)
+						}
+					}
+					want := byte(200)
+					if masked {
+						want = 128
+					}
+					if got := frame[p.off+y*p.stride+x*p.step]; got != want {
+						t.Fatalf("%s: chroma (%d,%d): got %d, want %d", layout, x, y, got, want)
+					}
+				}
+			}
+		}
+	}
+}
+
+func TestPrivacyMaskPixelate(t *testing.T) {
+	const w, h = 32, 16
+	m, err := NewPrivacyMask(w, h, PrivacyMaskConfig{Mode: MaskPixelate, Block: 8}, rect(0, 0, 16, 8))
+	if err != nil {
+		t.Fatal(err)
+	}
+	frame := make([]byte, LayoutI420.FrameSize(w, h))
+	for y := 0; y < h; y++ {
+		for x := 0; x < w; x++ {
+			frame[y*w+x] = byte(x * 4)
+		}
+	}
+	if err := m.Apply(frame, LayoutI420); err != nil {
+		t.Fatal(err)
+	}
+	// each 8x8 block holds the average of its row ramp, the rest of the frame is untouched
+	for y := 0; y < h; y++ {
+		for x := 0; x < w; x++ {
+			want := byte(x * 4)
+			if y < 8 && x < 16 {
+				want = byte(x/8*32 + 14)
+			}
+			if got := frame[y*w+x]; got != want {
+				t.Fatalf("luma (%d,%d): got %d, want %d", x, y, got, want)
+			}
+		}
+	}
+}
+
+func TestPrivacyMaskMJPEG(t *testing.T) {
+	const w, h = 128, 64
+	img := testYCbCr(w, h)
+	var buf bytes.Buffer
+	if err := jpeg.Encode(&buf, img, &jpeg.Options{Quality: 90}); err != nil {
+		t.Fatal(err)
+	}
+	decode := func(data []byte) *image.YCbCr {
+		t.Helper()
+		img, err := jpeg.Decode(bytes.NewReader(data))
+		if err != nil {
+			t.Fatal(err)
+		}
+		return img.(*image.YCbCr)
+	}
+	orig := decode(buf.Bytes())
+
+	// re-encoding without edits preserves the frame
+	var s jpegScan
+	if err := s.parse(buf.Bytes()); err != nil {
+		t.Fatal(err)
+	}
+	same, err := s.rewrite(nil, buf.Bytes(), func(int, int, int, *[64]int32) {})
+	if err != nil {
+		t.Fatal(err)
+	}
+	if !bytes.Equal(decode(same).Y, orig.Y) {
+		t.Fatal("rewritten frame differs")
+	}
+
+	// the MCUs (16x16 in 4:2:0) covering the mask are filled, the others are untouched
+	m, err := NewPrivacyMask(w, h, PrivacyMaskConfig{Color: [3]byte{0, 128, 128}}, rect(20, 20, 40, 30))
+	if err != nil {
+		t.Fatal(err)
+	}
+	out, err := m.ApplyMJPEG(nil, buf.Bytes())
+	if err != nil {
+		t.Fatal(err)
+	}
+	masked := decode(out)
+	for y := 0; y < h; y++ {
+		for x := 0; x < w; x++ {
+			got, want := masked.Y[y*masked.YStride+x], orig.Y[y*orig.YStride+x]
+			if x >= 16 && x < 48 && y >= 16 && y < 32 {
+				want = 0
+			}
+			if got != want {
+				t.Fatalf("luma (%d,%d): got %d, want %d", x, y, got, want)
+			}
+		}
+	}
+
+	// pixelation flattens the blocks of the masked MCUs
+	m, _ = NewPrivacyMask(w, h, PrivacyMaskConfig{Mode: MaskPixelate}, rect(20, 20, 40, 30))
+	if out, err = m.ApplyMJPEG(out, buf.Bytes()); err != nil {
+		t.Fatal(err)
+	}
+	masked = decode(out)
+	for y := 16; y < 32; y++ {
+		for x := 16; x < 48; x++ {
+			corner := masked.Y[y&^7*masked.YStride+x&^7]
+			if d := int(masked.Y[y*masked.YStride+x]) - int(corner); d < -1 || d > 1 {
+				t.Fatalf("luma (%d,%d): %d in a block of %d", x, y, masked.Y[y*masked.YStride+x], corner)
+			}
+		}
+	}
+}
+
+// BenchmarkPrivacyMaskYUYV masks a fifth of a 720p frame
+func BenchmarkPrivacyMaskYUYV(b *testing.B) {
+	frame := make([]byte, LayoutYUYV.FrameSize(1280, 720))
+	m, err := NewPrivacyMask(1280, 720, PrivacyMaskConfig{}, rect(0, 0, 640, 360), []image.Point{{800, 100}, {1200, 500}, {800, 600}})
+	if err != nil {
+		b.Fatal(err)
+	}
+	for i := 0; i < b.N; i++ {
+		m.Apply(frame, LayoutYUYV)
+	}
+}
+
+// BenchmarkPrivacyMaskMJPEG masks a 720p MJPEG frame
+func BenchmarkPrivacyMaskMJPEG(b *testing.B) {
+	var buf bytes.Buffer
+	if err := jpeg.Encode(&buf, testYCbCr(1280, 720), &jpeg.Options{Quality: 85}); err != nil {
+		b.Fatal(err)
+	}
+	m, err := NewPrivacyMask(1280, 720, PrivacyMaskConfig{}, rect(0, 0, 640, 360))
+	if err != nil {
+		b.Fatal(err)
+	}
+	var out []byte
+	b.SetBytes(int64(buf.Len()))
+	for i := 0; i < b.N; i++ {
+		if out, err = m.ApplyMJPEG(out, buf.Bytes()); err != nil {
+			b.Fatal(err)
+		}
+	}
+}
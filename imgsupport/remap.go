@@ -0,0 +1,244 @@
+package imgsupport
+
+import (
+	"fmt"
+	"math"
+	"runtime"
+	"sync"
+)
+
+// LensCalibration holds the intrinsics (focal lengths and principal point, in pixels) and
+// distortion coefficients of a camera, in the pinhole model with Brown-Conrady radial (K)
+// and tangential (P) distortion used by OpenCV, measured on Width x Height frames. The
+// calibration applies to frames of any size of the same aspect ratio.
+type LensCalibration struct {
+	Width, Height  int
+	Fx, Fy, Cx, Cy float64
+	K1, K2, K3     float64
+	P1, P2         float64
+}
+
+// distort maps undistorted normalized coordinates to distorted ones
+func (c LensCalibration) distort(x, y float64) (float64, float64) {
+	r2 := x*x + y*y
+	radial := 1 + r2*(c.K1+r2*(c.K2+r2*c.K3))
+	return x*radial + 2*c.P1*x*y + c.P2*(r2+2*x*x), y*radial + c.P1*(r2+2*y*y) + 2*c.P2*x*y
+}
+
+// RemapConfig tunes a Remapper
+type RemapConfig struct {
+	// LumaOnly outputs the luma plane only (a width x height GREY frame), i.e. for analytics
+	LumaOnly bool
+
+	// Zoom magnifies the corrected frame (1 by default): above 1, the blank areas left at the
+	// borders by barrel distortion correction are cropped out
+	Zoom float64
+
+	// Workers is the number of row bands remapped concurrently (the number of CPUs by default)
+	Workers int
+}
+
+const (
+	remapTileWidth  = 64
+	remapTileHeight = 16
+	remapFracBits   = 7
+	remapOne        = 1 << remapFracBits
+)
+
+// remapEntry locates the source samples of a destination sample: the four samples at
+// off, off+step, off+stride and off+stride+step of the source channel are weighted by the
+// fractional position fx, fy (in 1/remapOne). Samples mapped outside the source frame
+// have a negative off.
+type remapEntry struct {
+	off    int32
+	fx, fy uint8
+}
+
+// remapTable maps the samples of a destination channel to those of a source channel.
+// Entries are stored tile by tile (tiles of remapTileWidth x remapTileHeight samples, in
+// rows of tiles): a tile reads a compact area of the source, and its entries are contiguous.
+type remapTable struct {
+	src, dst plane
+	entries  []remapEntry
+	rowStart []int // index of the first entry of each row of tiles
+	fill     byte
+}
+
+// Remapper corrects the lens distortion of frames of one layout and size, by remapping
+// each destination sample from the source position the lens projected it to, with
+// bilinear interpolation. The mapping is computed once into fixed-point tables, so that
+// remapping a frame reads one table entry and four source samples per sample. Row bands
+// are remapped concurrently. A Remapper is safe for concurrent use.
+type Remapper struct {
+	layout        Layout
+	width, height int
+	config        RemapConfig
+	tables        []remapTable
+	outSize       int
+}
+
+// NewRemapper returns a remapper correcting the distortion described by cal on width x
+// height frames of a YUV layout
+func NewRemapper(cal LensCalibration, layout Layout, width, height int, config RemapConfig) (*Remapper, error) {
+	if layout == LayoutRGBA || layout.FrameSize(2, 2) == 0 {
+		return nil, fmt.Errorf("remap: unsupported layout %s", layout)
+	}
+	if width < 4 || height < 4 || width%2 != 0 || height%2 != 0 || cal.Width <= 0 || cal.Height <= 0 || cal.Fx == 0 || cal.Fy == 0 {
+		return nil, fmt.Errorf("remap: invalid %dx%d frames or calibration", width, height)
+	}
+	if config.Zoom <= 0 {
+		config.Zoom = 1
+	}
+	if config.Workers <= 0 {
+		config.Workers = runtime.NumCPU()
+	}
+
+	// calibration scaled to the frame size
+	sx, sy := float64(width)/float64(cal.Width), float64(height)/float64(cal.Height)
+	cal.Fx, cal.Cx = cal.Fx*sx, (cal.Cx+0.5)*sx-0.5
+	cal.Fy, cal.Cy = cal.Fy*sy, (cal.Cy+0.5)*sy-0.5
+
+	r := &Remapper{layout: layout, width: width, height: height, config: config}
+	planes := layout.planes(width, height)
+	if config.LumaOnly {
+		r.outSize = width * height
+		r.tables = []remapTable{newRemapTable(cal, config.Zoom, planes[0], plane{step: 1, stride: width, w: width, h: height}, width, height, 16)}
+		return r, nil
+	}
+	r.outSize = layout.FrameSize(width, height)
+	// U and V share their geometry: one table, applied at the offset of each
+	chroma := newRemapTable(cal, config.Zoom, planes[1], planes[1], width, height, 128)
+	r.tables = []remapTable{newRemapTable(cal, config.Zoom, planes[0], planes[0], width, height, 16), chroma, chroma}
+	r.tables[2].src, r.tables[2].dst = planes[2], planes[2]
+	return r, nil
+}
+
+// newRemapTable computes the table of a channel (src and dst have the same sample geometry)
+func newRemapTable(cal LensCalibration, zoom float64, src, dst plane, width, height int, fill byte) remapTable {
+	t := remapTable{src: src, dst: dst, fill: fill, entries: make([]remapEntry, 0, dst.w*dst.h)}
+	// subsampling factors of the channel
+	cx, cy := float64(width/dst.w), float64(height/dst.h)
+	fx, fy := cal.Fx*zoom, cal.Fy*zoom
+
+	for ty := 0; ty < dst.h; ty += remapTileHeight {
+		t.rowStart = append(t.rowStart, len(t.entries))
+		for tx := 0; tx < dst.w; tx += remapTileWidth {
+			for y := ty; y < ty+remapTileHeight && y < dst.h; y++ {
+				for x := tx; x < tx+remapTileWidth && x < dst.w; x++ {
+					// sample center in pixels, to distorted pixel position, to source sample position
+					u, v := (float64(x)+0.5)*cx-0.5, (float64(y)+0.5)*cy-0.5
+					xd, yd := cal.distort((u-cal.Cx)/fx, (v-cal.Cy)/fy)
+					su := (cal.Fx*xd+cal.Cx+0.5)/cx - 0.5
+					sv := (cal.Fy*yd+cal.Cy+0.5)/cy - 0.5
+					t.entries = append(t.entries, t.entry(su, sv))
+				}
+			}
+		}
+	}
+	t.rowStart = append(t.rowStart, len(t.entries))
+	return t
+}
+
+// entry returns the entry of source sample position (x, y)
+func (t *remapTable) entry(x, y float64) remapEntry {
+	xi, fx, okx := remapAxis(x, t.src.w)
+	yi, fy, oky := remapAxis(y, t.src.h)
+	if !okx || !oky {
+		return remapEntry{off: -1}
+	}
+	return remapEntry{off: int32(yi*t.src.stride + xi*t.src.step), fx: uint8(fx), fy: uint8(fy)}
+}
+
+// remapAxis splits position p on an axis of n samples into the index of the first sample
+// interpolated and the fractional weight of the second, keeping both within the axis
+func remapAxis(p float64, n int) (int, int, bool) {
+	if p < -0.5 || p > float64(n)-0.5 || math.IsNaN(p) {
+		return 0, 0, false
+	}
+	if p < 0 {
+		p = 0
+	}
+	i := int(p)
+	f := int(math.Round((p - float64(i)) * remapOne))
+	if f == remapOne {
+		i, f = i+1, 0
+	}
+	if i >= n-1 {
+		i, f = n-2, remapOne
+	}
+	return i, f, true
+}
+
+// OutputSize returns the size of the remapped frames
+func (r *Remapper) OutputSize() int {
+	return r.outSize
+}
+
+// Remap writes the corrected src frame to dst, which is grown as needed (and must not
+// overlap src), and returns it
+func (r *Remapper) Remap(dst, src []byte) ([]byte, error) {
+	if len(src) < r.layout.FrameSize(r.width, r.height) {
+		return dst, fmt.Errorf("remap: %s frame too small: %d bytes", r.layout, len(src))
+	}
+	if cap(dst) < r.outSize {
+		dst = make([]byte, r.outSize)
+	}
+	dst = dst[:r.outSize]
+
+	// each worker remaps a band of rows of tiles of every channel
+	workers := r.config.Workers
+	var wg sync.WaitGroup
+	for w := 0; w < workers; w++ {
+		wg.Add(1)
+		go func(w int) {
+			defer wg.Done()
+			for i := range r.tables {
+				t := &r.tables[i]
+				rows := len(t.rowStart) - 1
+				t.remap(dst, src, rows*w/workers, rows*(w+1)/workers)
+			}
+		}(w)
+	}
+	wg.Wait()
+	return dst, nil
+}
+
+// remap remaps the rows of tiles [row0, row1)
+func (t *remapTable) remap(dst, src []byte, row0, row1 int) {
+	if row0 >= row1 {
+		return
+	}
+	entries := t.entries[t.rowStart[row0]:t.rowStart[row1]]
+	sp, dp := t.src, t.dst
+	source := src[sp.off:]
+	sstep, sstride := sp.step, sp.stride
+	i := 0
+	for ty := row0 * remapTileHeight; ty < row1*remapTileHeight && ty < dp.h; ty += remapTileHeight {
+		for tx := 0; tx < dp.w; tx += remapTileWidth {
+			w := dp.w - tx
+			if w > remapTileWidth {
+				w = remapTileWidth
+			}
+			for y := ty; y < ty+remapTileHeight && y < dp.h; y++ {
+				start := dp.off + y*dp.stride + tx*dp.step
+				out := dst[start : start+(w-1)*dp.step+1]
+				row := entries[i : i+w]
+				i += w
+				for x, o := 0, 0; x < len(row); x, o = x+1, o+dp.step {
+					e := row[x]
+					if e.off < 0 {
+						out[o] = t.fill
+						continue
+					}
+					p := source[e.off:]
+					fx, fy := int32(e.fx), int32(e.fy)
+					a, b := int32(p[0]), int32(p[sstep])
+					c, d := int32(p[sstride]), int32(p[sstride+sstep])
+					top := a<<remapFracBits + (b-a)*fx
+					bottom := c<<remapFracBits + (d-c)*fx
+					out[o] = byte((top<<remapFracBits + (bottom-top)*fy + 1<<(2*remapFracBits-1)) >> (2 * remapFracBits))
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,100 @@
+package imgsupport
+
+import (
+	"bytes"
+	"math"
+	"testing"
+)
+
+func TestRemapper(t *testing.T) {
+	const w, h = 256, 128
+	// calibrated at twice the frame size
+	cal := LensCalibration{Width: 2 * w, Height: 2 * h, Fx: 300, Fy: 300, Cx: w - 0.5, Cy: h - 0.5}
+
+	// no distortion: the identity
+	for _, layout := range []Layout{LayoutYUYV, LayoutNV12, LayoutI420} {
+		src := make([]byte, layout.FrameSize(w, h))
+		for i := range src {
+			src[i] = byte(i * 31)
+		}
+		r, err := NewRemapper(cal, layout, w, h, RemapConfig{Workers: 3})
+		if err != nil {
+			t.Fatal(err)
+		}
+		out, err := r.Remap(nil, src)
+		if err != nil {
+			t.Fatal(err)
+		}
+		if !bytes.Equal(out, src) {
+			t.Fatalf("%s: identity remap changed the frame", layout)
+		}
+	}
+
+	// barrel distortion of a horizontal ramp: each sample holds the ramp at its source position
+	cal.K1, cal.P1 = -0.25, 0.01
+	src := make([]byte, LayoutNV12.FrameSize(w, h))
+	for y := 0; y < h; y++ {
+		for x := 0; x < w; x++ {
+			src[y*w+x] = byte(x)
+		}
+	}
+	r, err := NewRemapper(cal, LayoutNV12, w, h, RemapConfig{})
+	if err != nil {
+		t.Fatal(err)
+	}
+	out, _ := r.Remap(nil, src)
+	f, c := 150.0, float64(w/2)-0.5
+	cy := float64(h/2) - 0.5
+	for y := 0; y < h; y++ {
+		for x := 0; x < w; x++ {
+			nx, ny := (float64(x)-c)/f, (float64(y)-cy)/f
+			r2 := nx*nx + ny*ny
+			sx := f*(nx*(1+cal.K1*r2)+2*cal.P1*nx*ny) + c
+			got := out[y*w+x]
+			if sx < 0 || sx > w-1 {
+				continue
+			}
+			if d := float64(got) - sx; math.Abs(d) > 1 {
+				t.Fatalf("luma (%d,%d): got %d, want %.1f", x, y, got, sx)
+			}
+		}
+	}
+	if out[w/2] == src[w/2] && out[0] == src[0] {
+		t.Fatal("frame not remapped")
+	}
+
+	// luma only output is the luma plane of the full output
+	lr, err := NewRemapper(cal, LayoutNV12, w, h, RemapConfig{LumaOnly: true, Workers: 2})
+	if err != nil {
+		t.Fatal(err)
+	}
+	luma, _ := lr.Remap(nil, src)
+	if lr.OutputSize() != w*h || !bytes.Equal(luma, out[:w*h]) {
+		t.Fatal("luma only output differs")
+	}
+}
+
+func benchmarkRemap(b *testing.B, config RemapConfig) {
+	cal := LensCalibration{Width: 1920, Height: 1080, Fx: 1000, Fy: 1000, Cx: 959.5, Cy: 539.5, K1: -0.3, K2: 0.1}
+	r, err := NewRemapper(cal, LayoutYUYV, 1920, 1080, config)
+	if err != nil {
+		b.Fatal(err)
+	}
+	src := make([]byte, LayoutYUYV.FrameSize(1920, 1080))
+	for i := range src {
+		src[i] = byte(i * 7)
+	}
+	var dst []byte
+	for i := 0; i < b.N; i++ {
+		dst, _ = r.Remap(dst, src)
+	}
+}
+
+// BenchmarkRemapYUYV remaps 1080p frames on 2 cores
+func BenchmarkRemapYUYV(b *testing.B) {
+	benchmarkRemap(b, RemapConfig{Workers: 2})
+}
+
+func BenchmarkRemapLuma(b *testing.B) {
+	benchmarkRemap(b, RemapConfig{Workers: 2, LumaOnly: true})
+}
@@ -0,0 +1,266 @@
+package imgsupport
+
+import (
+	"fmt"
+	"image"
+)
+
+// Layout is the memory layout of an 8-bit YUV 4:2:x frame (or of an RGBA frame)
+type Layout int
+
+const (
+	// LayoutYUYV is packed 4:2:2: Y0 U Y1 V for each pair of pixels
+	LayoutYUYV Layout = iota
+	// LayoutNV12 is 4:2:0 with a Y plane followed by a plane of interleaved U and V samples
+	LayoutNV12
+	// LayoutI420 is 4:2:0 with a Y plane followed by a U plane and a V plane
+	LayoutI420
+	// LayoutRGBA is packed R G B A, 4 bytes per pixel
+	LayoutRGBA
+	// LayoutMJPEG is a compressed JPEG image (MJPEG streams), which has no fixed frame size
+	LayoutMJPEG
+)
+
+func (l Layout) String() string {
+	switch l {
+	case LayoutYUYV:
+		return "YUYV"
+	case LayoutNV12:
+		return "NV12"
+	case LayoutI420:
+		return "I420"
+	case LayoutRGBA:
+		return "RGBA"
+	case LayoutMJPEG:
+		return "MJPEG"
+	}
+	return fmt.Sprintf("Layout(%d)", int(l))
+}
+
+// FrameSize returns the size in bytes of a width x height frame (width and height even),
+// or 0 for compressed layouts
+func (l Layout) FrameSize(width, height int) int {
+	switch l {
+	case LayoutYUYV:
+		return width * height * 2
+	case LayoutNV12, LayoutI420:
+		return width * height * 3 / 2
+	case LayoutRGBA:
+		return width * height * 4
+	}
+	return 0
+}
+
+// plane describes the samples of one channel of a frame: sample (x, y) is data[off+y*stride+x*step]
+type plane struct {
+	off, step, stride int
+	w, h              int
+}
+
+// planes returns the Y, U and V channels of a width x height YUV frame
+func (l Layout) planes(width, height int) [3]plane {
+	switch l {
+	case LayoutYUYV:
+		stride := 2 * width
+		return [3]plane{
+			{off: 0, step: 2, stride: stride, w: width, h: height},
+			{off: 1, step: 4, stride: stride, w: width / 2, h: height},
+			{off: 3, step: 4, stride: stride, w: width / 2, h: height},
+		}
+	case LayoutNV12:
+		luma := width * height
+		return [3]plane{
+			{off: 0, step: 1, stride: width, w: width, h: height},
+			{off: luma, step: 2, stride: width, w: width / 2, h: height / 2},
+			{off: luma + 1, step: 2, stride: width, w: width / 2, h: height / 2},
+		}
+	case LayoutI420:
+		luma := width * height
+		return [3]plane{
+			{off: 0, step: 1, stride: width, w: width, h: height},
+			{off: luma, step: 1, stride: width / 2, w: width / 2, h: height / 2},
+			{off: luma + luma/4, step: 1, stride: width / 2, w: width / 2, h: height / 2},
+		}
+	}
+	return [3]plane{}
+}
+
+// sub returns the part of the channel covering the frame region r (in pixels)
+func (p plane) sub(r image.Rectangle, width, height int) plane {
+	cx, cy := width/p.w, height/p.h // subsampling factors
+	p.off += r.Min.Y/cy*p.stride + r.Min.X/cx*p.step
+	p.w, p.h = r.Dx()/cx, r.Dy()/cy
+	return p
+}
+
+// axis maps the samples of a destination axis to the two source samples they are
+// interpolated from: off0[i] and off1[i] (byte offsets), weighted 256-frac[i] and frac[i]
+type axis struct {
+	off0, off1 []int32
+	frac       []int32
+}
+
+// newAxis samples n source samples spaced step bytes apart at the centers of m destination samples
+func newAxis(n, m, step int) axis {
+	a := axis{off0: make([]int32, m), off1: make([]int32, m), frac: make([]int32, m)}
+	for i := 0; i < m; i++ {
+		// source position in 1/256 of a sample, of the center of destination sample i
+		pos := ((2*i+1)*n*256/m - 256) / 2
+		if pos < 0 {
+			pos = 0
+		}
+		idx, frac := pos>>8, pos&0xff
+		next := idx + 1
+		if next >= n {
+			idx, next, frac = n-1, n-1, 0
+		}
+		a.off0[i], a.off1[i], a.frac[i] = int32(idx*step), int32(next*step), int32(frac)
+	}
+	return a
+}
+
+// Scaler scales frames of one size and layout into a region of frames of another size
+// and layout, with bilinear interpolation. The source to destination sample mapping is
+// computed once, so that scaling a frame is a tight fixed-point loop per channel. Scaling
+// between YUV layouts converts chroma subsampling along the way; RGBA destinations are
+// scaled to YUYV then converted (BT.601, limited range). A Scaler keeps scratch memory:
+// it must not be used concurrently.
+type Scaler struct {
+	srcLayout, dstLayout Layout
+	srcSize, dstSize     int
+	src, dst             [3]plane
+	x, y                 [3]axis
+
+	// RGBA destinations: scaled YUYV rows are converted into the region
+	rgba       image.Rectangle
+	dstStride  int
+	scratch    []byte
+	scratchRow int
+}
+
+// NewScaler returns a scaler from src frames (srcWidth x srcHeight) to the region dstRect
+// of dst frames (dstWidth x dstHeight). Sizes and region bounds must be even.
+func NewScaler(src Layout, srcWidth, srcHeight int, dst Layout, dstWidth, dstHeight int, dstRect image.Rectangle) (*Scaler, error) {
+	if src == LayoutRGBA || src.FrameSize(2, 2) == 0 || dst.FrameSize(2, 2) == 0 {
+		return nil, fmt.Errorf("scaler: unsupported layouts %s to %s", src, dst)
+	}
+	odd := func(v ...int) bool {
+		for _, n := range v {
+			if n <= 0 || n%2 != 0 {
+				return true
+			}
+		}
+		return false
+	}
+	r := dstRect
+	if odd(srcWidth, srcHeight, dstWidth, dstHeight, r.Dx(), r.Dy()) || r.Min.X%2 != 0 || r.Min.Y%2 != 0 ||
+		!r.In(image.Rect(0, 0, dstWidth, dstHeight)) {
+		return nil, fmt.Errorf("scaler: invalid sizes %dx%d to %v of %dx%d", srcWidth, srcHeight, r, dstWidth, dstHeight)
+	}
+
+	s := &Scaler{
+		srcLayout: src,
+		dstLayout: dst,
+		srcSize:   src.FrameSize(srcWidth, srcHeight),
+		dstSize:   dst.FrameSize(dstWidth, dstHeight),
+		src:       src.planes(srcWidth, srcHeight),
+	}
+	if dst == LayoutRGBA {
+		s.rgba, s.dstStride = r, 4*dstWidth
+		s.scratchRow = 2 * r.Dx()
+		s.scratch = make([]byte, s.scratchRow*r.Dy())
+		s.dst = LayoutYUYV.planes(r.Dx(), r.Dy())
+	} else {
+		for i, p := range dst.planes(dstWidth, dstHeight) {
+			s.dst[i] = p.sub(r, dstWidth, dstHeight)
+		}
+	}
+	for i := range s.dst {
+		s.x[i] = newAxis(s.src[i].w, s.dst[i].w, s.src[i].step)
+		s.y[i] = newAxis(s.src[i].h, s.dst[i].h, s.src[i].stride)
+	}
+	return s, nil
+}
+
+// Scale scales the src frame into its region of the dst frame, leaving the rest of dst untouched
+func (s *Scaler) Scale(dst, src []byte) error {
+	if len(src) < s.srcSize {
+		return fmt.Errorf("scaler: %s frame too small: %d bytes", s.srcLayout, len(src))
+	}
+	if len(dst) < s.dstSize {
+		return fmt.Errorf("scaler: %s frame too small: %d bytes", s.dstLayout, len(dst))
+	}
+	out := dst
+	if s.scratch != nil {
+		out = s.scratch
+	}
+	for i := range s.dst {
+		scalePlane(out, s.dst[i], src, s.src[i], s.x[i], s.y[i])
+	}
+	if s.scratch != nil {
+		r := s.rgba
+		for y := 0; y < r.Dy(); y++ {
+			start := (r.Min.Y+y)*s.dstStride + 4*r.Min.X
+			yuyvToRGBA(dst[start:start+4*r.Dx()], s.scratch[y*s.scratchRow:(y+1)*s.scratchRow])
+		}
+	}
+	return nil
+}
+
+func scalePlane(dst []byte, dp plane, src []byte, sp plane, xa, ya axis) {
+	off0, off1, fxs := xa.off0[:dp.w], xa.off1[:dp.w], xa.frac[:dp.w]
+	last := (dp.w-1)*dp.step + 1
+	for y := 0; y < dp.h; y++ {
+		row0 := src[sp.off+int(ya.off0[y]):]
+		row1 := src[sp.off+int(ya.off1[y]):]
+		fy := ya.frac[y]
+		start := dp.off + y*dp.stride
+		out := dst[start : start+last]
+		o := 0
+		if fy == 0 {
+			// on a source row: interpolate horizontally only
+			for x, fx := range fxs {
+				a, b := int32(row0[off0[x]]), int32(row0[off1[x]])
+				out[o] = byte((a<<8 + (b-a)*fx + 128) >> 8)
+				o += dp.step
+			}
+			continue
+		}
+		for x, fx := range fxs {
+			o0, o1 := off0[x], off1[x]
+			a, b := int32(row0[o0]), int32(row0[o1])
+			c, d := int32(row1[o0]), int32(row1[o1])
+			top := a<<8 + (b-a)*fx
+			bottom := c<<8 + (d-c)*fx
+			out[o] = byte((top<<8 + (bottom-top)*fy + 1<<15) >> 16)
+			o += dp.step
+		}
+	}
+}
+
+// Fill paints the region r of a width x height frame with the color (Y, U, V for YUV
+// layouts, R, G, B, A for RGBA). Region bounds must be even.
+func Fill(frame []byte, layout Layout, width, height int, r image.Rectangle, color [4]byte) error {
+	if layout.FrameSize(2, 2) == 0 || len(frame) < layout.FrameSize(width, height) || !r.In(image.Rect(0, 0, width, height)) {
+		return fmt.Errorf("fill: invalid region %v of %dx%d %s frame", r, width, height, layout)
+	}
+	if layout == LayoutRGBA {
+		for y := r.Min.Y; y < r.Max.Y; y++ {
+			row := frame[(y*width+r.Min.X)*4 : (y*width+r.Max.X)*4]
+			for x := 0; x < len(row); x += 4 {
+				row[x], row[x+1], row[x+2], row[x+3] = color[0], color[1], color[2], color[3]
+			}
+		}
+		return nil
+	}
+	for i, p := range layout.planes(width, height) {
+		p = p.sub(r, width, height)
+		for y := 0; y < p.h; y++ {
+			row := frame[p.off+y*p.stride:]
+			for x := 0; x < p.w*p.step; x += p.step {
+				row[x] = color[i]
+			}
+		}
+	}
+	return nil
+}
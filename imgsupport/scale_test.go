@@ -0,0 +1,94 @@
+package imgsupport
+
+import (
+	"image"
+	"testing"
+)
+
+func TestScaler(t *testing.T) {
+	// YUYV frame with a horizontal luma ramp, constant chroma
+	const w, h = 64, 32
+	src := make([]byte, LayoutYUYV.FrameSize(w, h))
+	for y := 0; y < h; y++ {
+		for x := 0; x < w; x++ {
+			src[y*2*w+2*x] = byte(4 * x)
+		}
+		for x := 0; x < w; x += 2 {
+			src[y*2*w+2*x+1], src[y*2*w+2*x+3] = 90, 160
+		}
+	}
+
+	// down to the right half of an NV12 frame
+	const dw, dh = 64, 16
+	dst := make([]byte, LayoutNV12.FrameSize(dw, dh))
+	s, err := NewScaler(LayoutYUYV, w, h, LayoutNV12, dw, dh, image.Rect(32, 0, 64, 16))
+	if err != nil {
+		t.Fatal(err)
+	}
+	if err := s.Scale(dst, src); err != nil {
+		t.Fatal(err)
+	}
+	for y := 0; y < dh; y++ {
+		for x := 0; x < dw; x++ {
+			got := int(dst[y*dw+x])
+			if x < 32 {
+				if got != 0 {
+					t.Fatalf("luma (%d,%d) outside the region: %d", x, y, got)
+				}
+				continue
+			}
+			// destination pixel x covers source pixels 2(x-32) and 2(x-32)+1
+			if want := 4*2*(x-32) + 2; got != want {
+				t.Fatalf("luma (%d,%d): got %d, want %d", x, y, got, want)
+			}
+		}
+	}
+	chroma := dst[dw*dh:]
+	for y := 0; y < dh/2; y++ {
+		for x := dw / 2; x < dw; x += 2 {
+			if u, v := chroma[y*dw+x], chroma[y*dw+x+1]; u != 90 || v != 160 {
+				t.Fatalf("chroma (%d,%d): got %d %d", x/2, y, u, v)
+			}
+		}
+	}
+
+	// mid gray to RGBA
+	for i := 0; i < len(src); i += 2 {
+		src[i], src[i+1] = 126, 128
+	}
+	rgba := make([]byte, LayoutRGBA.FrameSize(8, 8))
+	if s, err = NewScaler(LayoutYUYV, w, h, LayoutRGBA, 8, 8, image.Rect(0, 0, 8, 8)); err != nil {
+		t.Fatal(err)
+	}
+	if err := s.Scale(rgba, src); err != nil {
+		t.Fatal(err)
+	}
+	for i := 0; i < len(rgba); i += 4 {
+		if rgba[i] != 128 || rgba[i+1] != 128 || rgba[i+2] != 128 || rgba[i+3] != 0xff {
+			t.Fatalf("pixel %d: got %v", i/4, rgba[i:i+4])
+		}
+	}
+
+	if _, err := NewScaler(LayoutYUYV, w, h, LayoutNV12, dw, dh, image.Rect(1, 0, 33, 16)); err == nil {
+		t.Fatal("odd region accepted")
+	}
+}
+
+// BenchmarkScaleYUYV scales a 720p frame to a tile of a 4x4 1080p mosaic
+func BenchmarkScaleYUYV(b *testing.B) {
+	src := make([]byte, LayoutYUYV.FrameSize(1280, 720))
+	for i := range src {
+		src[i] = byte(i * 7)
+	}
+	dst := make([]byte, LayoutYUYV.FrameSize(1920, 1080))
+	s, err := NewScaler(LayoutYUYV, 1280, 720, LayoutYUYV, 1920, 1080, image.Rect(480, 270, 960, 540))
+	if err != nil {
+		b.Fatal(err)
+	}
+	b.SetBytes(int64(len(src)))
+	for i := 0; i < b.N; i++ {
+		if err := s.Scale(dst, src); err != nil {
+			b.Fatal(err)
+		}
+	}
+}
@@ -0,0 +1,82 @@
+package imgsupport
+
+import (
+	"fmt"
+	"image"
+)
+
+// Sharpness metrics score how much fine detail a region holds, for contrast detection
+// autofocus: the better focused the frame, the higher the score. Scores are only
+// comparable between frames of the same scene, format and region.
+
+// SharpnessLuma returns the gradient energy (the sum of squared differences between
+// horizontally and vertically adjacent pixels) of the region roi of an 8-bit luma plane
+// (GREY, or the Y plane of NV12, I420...)
+func SharpnessLuma(plane []byte, stride int, roi image.Rectangle) (uint64, error) {
+	return sharpness(plane, stride, 1, roi)
+}
+
+// SharpnessYUYV returns the gradient energy of the luma of the region roi of a packed YUYV frame
+func SharpnessYUYV(frame []byte, width int, roi image.Rectangle) (uint64, error) {
+	return sharpness(frame, 2*width, 2, roi)
+}
+
+func sharpness(data []byte, stride, step int, roi image.Rectangle) (uint64, error) {
+	if roi.Dx() < 2 || roi.Dy() < 2 || roi.Min.X < 0 || roi.Min.Y < 0 || roi.Max.X*step > stride {
+		return 0, fmt.Errorf("sharpness: invalid region %v", roi)
+	}
+	if len(data) < (roi.Max.Y-1)*stride+roi.Max.X*step {
+		return 0, fmt.Errorf("sharpness: frame too small: %d bytes", len(data))
+	}
+
+	var sum uint64
+	n := (roi.Dx() - 1) * step
+	for y := roi.Min.Y; y < roi.Max.Y-1; y++ {
+		start := y*stride + roi.Min.X*step
+		line := data[start : start+n+step]
+		next := data[start+stride : start+stride+n]
+		var rowSum uint32 // at most 2*255^2 per pixel: a row of 8K pixels fits
+		for i := 0; i < n; i += step {
+			dx := int32(line[i+step]) - int32(line[i])
+			dy := int32(next[i]) - int32(line[i])
+			rowSum += uint32(dx*dx + dy*dy)
+		}
+		sum += uint64(rowSum)
+	}
+	return sum, nil
+}
+
+// SharpnessMJPEG returns the AC energy (the sum of squared dequantized AC coefficients) of
+// the luma blocks within the region roi of a baseline JPEG frame. Only the entropy coded
+// data is decoded: the energy of a block's AC coefficients measures its detail directly.
+func SharpnessMJPEG(frame []byte, roi image.Rectangle) (uint64, error) {
+	s := jpegScanPool.Get().(*jpegScan)
+	defer jpegScanPool.Put(s)
+	s.dcOnly = false
+
+	if err := s.parse(frame); err != nil {
+		return 0, fmt.Errorf("sharpness: %w", err)
+	}
+	luma := &s.comps[0]
+	q := &s.quant[luma.tq]
+	// luma blocks covering roi (luma is not subsampled)
+	bx0, by0 := roi.Min.X/8, roi.Min.Y/8
+	bx1, by1 := (roi.Max.X+7)/8, (roi.Max.Y+7)/8
+
+	var sum uint64
+	err := s.walk(frame, func(comp, bx, by int, blk *[64]int32) {
+		if comp != 0 || bx < bx0 || bx >= bx1 || by < by0 || by >= by1 {
+			return
+		}
+		for k := 1; k < 64; k++ {
+			if c := int64(blk[k]); c != 0 {
+				c *= int64(q[k])
+				sum += uint64(c * c)
+			}
+		}
+	}, nil)
+	if err != nil {
+		return 0, fmt.Errorf("sharpness: %w", err)
+	}
+	return sum, nil
+}
@@ -0,0 +1,95 @@
+package imgsupport
+
+import (
+	"bytes"
+	"image"
+	"image/jpeg"
+	"testing"
+)
+
+// testDetail returns a 4:2:0 image of a fine checkerboard, box blurred radius times
+func testDetail(width, height, radius int) *image.YCbCr {
+	img := image.NewYCbCr(image.Rect(0, 0, width, height), image.YCbCrSubsampleRatio420)
+	for y := 0; y < height; y++ {
+		for x := 0; x < width; x++ {
+			img.Y[y*img.YStride+x] = uint8(64 + 128*((x/3+y/3)%2))
+		}
+	}
+	for i := range img.Cb {
+		img.Cb[i], img.Cr[i] = 128, 128
+	}
+	tmp := make([]byte, len(img.Y))
+	for r := 0; r < radius; r++ {
+		for y := 1; y < height-1; y++ {
+			for x := 1; x < width-1; x++ {
+				sum := 0
+				for j := -1; j <= 1; j++ {
+					for i := -1; i <= 1; i++ {
+						sum += int(img.Y[(y+j)*img.YStride+x+i])
+					}
+				}
+				tmp[y*img.YStride+x] = uint8(sum / 9)
+			}
+		}
+		copy(img.Y, tmp)
+	}
+	return img
+}
+
+func toYUYV(img *image.YCbCr) []byte {
+	w, h := img.Rect.Dx(), img.Rect.Dy()
+	frame := make([]byte, 2*w*h)
+	for y := 0; y < h; y++ {
+		for x := 0; x < w; x++ {
+			frame[2*(y*w+x)] = img.Y[y*img.YStride+x]
+			frame[2*(y*w+x)+1] = 128
+		}
+	}
+	return frame
+}
+
+func TestSharpness(t *testing.T) {
+	const width, height = 320, 240
+	roi := image.Rect(80, 60, 240, 180)
+	sharp, blurred := testDetail(width, height, 0), testDetail(width, height, 2)
+
+	ls, _ := SharpnessLuma(sharp.Y, sharp.YStride, roi)
+	lb, _ := SharpnessLuma(blurred.Y, blurred.YStride, roi)
+	if ls <= lb {
+		t.Fatalf("luma: sharp %d <= blurred %d", ls, lb)
+	}
+
+	ys, _ := SharpnessYUYV(toYUYV(sharp), width, roi)
+	yb, _ := SharpnessYUYV(toYUYV(blurred), width, roi)
+	if ys != ls || yb != lb {
+		t.Fatalf("YUYV scores %d, %d differ from luma scores %d, %d", ys, yb, ls, lb)
+	}
+
+	var js, jb bytes.Buffer
+	jpeg.Encode(&js, sharp, &jpeg.Options{Quality: 85})
+	jpeg.Encode(&jb, blurred, &jpeg.Options{Quality: 85})
+	ms, err := SharpnessMJPEG(js.Bytes(), roi)
+	if err != nil {
+		t.Fatal(err)
+	}
+	mb, _ := SharpnessMJPEG(jb.Bytes(), roi)
+	if ms <= mb {
+		t.Fatalf("MJPEG: sharp %d <= blurred %d", ms, mb)
+	}
+
+	if _, err := SharpnessLuma(sharp.Y, sharp.YStride, image.Rect(0, 0, width+1, 10)); err == nil {
+		t.Fatal("expected invalid region error")
+	}
+}
+
+func BenchmarkSharpnessYUYV(b *testing.B) {
+	frame := make([]byte, 1280*720*2)
+	for i := range frame {
+		frame[i] = byte(i * 13)
+	}
+	roi := image.Rect(320, 180, 960, 540)
+	b.SetBytes(int64(roi.Dx() * roi.Dy()))
+	for i := 0; i < b.N; i++ {
+		SharpnessYUYV(frame, 1280, roi)
+	}
+}
@@ -0,0 +1,195 @@
+package imgsupport
+
+import (
+	"fmt"
+	"sync"
+	"time"
+)
+
+// LumaGrid is a coarse luma thumbnail of a frame (the average brightness of each cell
+// of a grid laid over the frame), used to tell cheaply whether a frame differs from another.
+// Raw frames are subsampled (a few pixels per cell), MJPEG frames are summarized from the
+// DC coefficients of their luma blocks without decoding the pixels.
+type LumaGrid struct {
+	Cols, Rows int
+	Cells      []uint8
+
+	sums   []uint32
+	counts []uint32
+	colOf  []int32 // cell column of each block column (MJPEG)
+	rowOf  []int32 // cell offset of each block row (MJPEG)
+}
+
+// NewLumaGrid returns a grid of cols x rows cells
+func NewLumaGrid(cols, rows int) *LumaGrid {
+	return &LumaGrid{
+		Cols:   cols,
+		Rows:   rows,
+		Cells:  make([]uint8, cols*rows),
+		sums:   make([]uint32, cols*rows),
+		counts: make([]uint32, cols*rows),
+	}
+}
+
+// lumaGridSamples is the number of pixels sampled per cell, along each axis
+const lumaGridSamples = 4
+
+// FromLuma fills the grid from an 8-bit luma plane (GREY, or the Y plane of NV12, I420...)
+func (g *LumaGrid) FromLuma(plane []byte, stride, width, height int) error {
+	return g.sample(plane, stride, 1, width, height)
+}
+
+// FromYUYV fills the grid from a packed YUYV frame
+func (g *LumaGrid) FromYUYV(frame []byte, width, height int) error {
+	return g.sample(frame, 2*width, 2, width, height)
+}
+
+func (g *LumaGrid) sample(data []byte, stride, step, width, height int) error {
+	if width < g.Cols || height < g.Rows {
+		return fmt.Errorf("luma grid: frame %dx%d smaller than grid", width, height)
+	}
+	if len(data) < stride*(height-1)+step*width {
+		return fmt.Errorf("luma grid: frame too small: %d bytes", len(data))
+	}
+	const n = lumaGridSamples
+	for row := 0; row < g.Rows; row++ {
+		y0, y1 := row*height/g.Rows, (row+1)*height/g.Rows
+		for col := 0; col < g.Cols; col++ {
+			x0, x1 := col*width/g.Cols, (col+1)*width/g.Cols
+			sum := 0
+			for j := 0; j < n; j++ {
+				line := data[(y0+(2*j+1)*(y1-y0)/(2*n))*stride:]
+				for i := 0; i < n; i++ {
+					sum += int(line[(x0+(2*i+1)*(x1-x0)/(2*n))*step])
+				}
+			}
+			g.Cells[row*g.Cols+col] = uint8(sum / (n * n))
+		}
+	}
+	return nil
+}
+
+var jpegScanPool = sync.Pool{New: func() interface{} { return new(jpegScan) }}
+
+// FromMJPEG fills the grid from a baseline JPEG frame. Only the entropy coded data is
+// decoded: a luma block's DC coefficient gives its average brightness.
+func (g *LumaGrid) FromMJPEG(frame []byte) error {
+	s := jpegScanPool.Get().(*jpegScan)
+	defer jpegScanPool.Put(s)
+	s.dcOnly = true
+
+	if err := s.parse(frame); err != nil {
+		return fmt.Errorf("luma grid: %w", err)
+	}
+	luma := &s.comps[0]
+	q := int32(s.quant[luma.tq][0])
+	if q == 0 {
+		q = 1
+	}
+	for i := range g.sums {
+		g.sums[i], g.counts[i] = 0, 0
+	}
+	blocksX, blocksY := luma.blocksX, luma.blocksY
+	if len(g.colOf) != blocksX || len(g.rowOf) != blocksY {
+		g.colOf, g.rowOf = make([]int32, blocksX), make([]int32, blocksY)
+		for bx := range g.colOf {
+			g.colOf[bx] = int32(bx * g.Cols / blocksX)
+		}
+		for by := range g.rowOf {
+			g.rowOf[by] = int32(by * g.Rows / blocksY * g.Cols)
+		}
+	}
+	err := s.walk(frame, func(comp, bx, by int, blk *[64]int32) {
+		if comp != 0 || bx >= blocksX || by >= blocksY {
+			return
+		}
+		// the DC coefficient is 8 times the block average, level shifted by 128
+		mean := 128 + blk[0]*q/8
+		switch {
+		case mean < 0:
+			mean = 0
+		case mean > 255:
+			mean = 255
+		}
+		cell := g.rowOf[by] + g.colOf[bx]
+		g.sums[cell] += uint32(mean)
+		g.counts[cell]++
+	}, nil)
+	if err != nil {
+		return fmt.Errorf("luma grid: %w", err)
+	}
+	for i := range g.Cells {
+		if g.counts[i] > 0 {
+			g.Cells[i] = uint8(g.sums[i] / g.counts[i])
+		}
+	}
+	return nil
+}
+
+// Distance returns the largest brightness difference between matching cells of the
+// grids, or 255 when the grids do not have the same layout.
+func (g *LumaGrid) Distance(o *LumaGrid) int {
+	if g.Cols != o.Cols || g.Rows != o.Rows {
+		return 255
+	}
+	max := 0
+	for i, c := range g.Cells {
+		d := int(c) - int(o.Cells[i])
+		if d < 0 {
+			d = -d
+		}
+		if d > max {
+			max = d
+		}
+	}
+	return max
+}
+
+// Hash returns a 64-bit perceptual hash of the grid (one bit per cell, set when the cell
+// is brighter than the grid average), for grids of 64 cells or fewer. Frames of the same
+// scene hash the same in spite of noise, which suits indexing; use Distance to detect
+// small changes.
+func (g *LumaGrid) Hash() uint64 {
+	if len(g.Cells) == 0 || len(g.Cells) > 64 {
+		return 0
+	}
+	sum := 0
+	for _, c := range g.Cells {
+		sum += int(c)
+	}
+	mean := sum / len(g.Cells)
+	var hash uint64
+	for i, c := range g.Cells {
+		if int(c) > mean {
+			hash |= 1 << uint(i)
+		}
+	}
+	return hash
+}
+
+// StaticFilter decides which frames of a mostly static scene need to be sent or recorded.
+// A frame is kept when its grid differs from the grid of the last kept frame by more than
+// Threshold (so that slow changes accumulate until they are noticed), or as a heartbeat
+// when no frame was kept for Heartbeat (0 disables heartbeats).
+type StaticFilter struct {
+	Threshold int
+	Heartbeat time.Duration
+
+	ref     LumaGrid
+	started bool
+	last    time.Duration
+}
+
+// Keep reports whether the frame summarized by grid, and captured at ts, should be kept.
+func (f *StaticFilter) Keep(grid *LumaGrid, ts time.Duration) bool {
+	switch {
+	case !f.started,
+		grid.Distance(&f.ref) > f.Threshold,
+		f.Heartbeat > 0 && ts-f.last >= f.Heartbeat:
+		f.ref.Cols, f.ref.Rows = grid.Cols, grid.Rows
+		f.ref.Cells = append(f.ref.Cells[:0], grid.Cells...)
+		f.started, f.last = true, ts
+		return true
+	}
+	return false
+}
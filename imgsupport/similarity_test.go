@@ -0,0 +1,86 @@
+package imgsupport
+
+import (
+	"bytes"
+	"image"
+	"image/jpeg"
+	"testing"
+)
+
+// testYCbCr returns a 4:2:0 image with a horizontal and vertical brightness gradient
+func testYCbCr(width, height int) *image.YCbCr {
+	img := image.NewYCbCr(image.Rect(0, 0, width, height), image.YCbCrSubsampleRatio420)
+	for y := 0; y < height; y++ {
+		for x := 0; x < width; x++ {
+			img.Y[y*img.YStride+x] = uint8(16 + (x*160/width+y*64/height)%224)
+		}
+	}
+	for i := range img.Cb {
+		img.Cb[i], img.Cr[i] = 128, 128
+	}
+	return img
+}
+
+func TestLumaGridMJPEG(t *testing.T) {
+	const width, height = 640, 480
+	img := testYCbCr(width, height)
+	var buf bytes.Buffer
+	if err := jpeg.Encode(&buf, img, &jpeg.Options{Quality: 75}); err != nil {
+		t.Fatal(err)
+	}
+
+	raw := NewLumaGrid(16, 12)
+	if err := raw.FromLuma(img.Y, img.YStride, width, height); err != nil {
+		t.Fatal(err)
+	}
+	compressed := NewLumaGrid(16, 12)
+	if err := compressed.FromMJPEG(buf.Bytes()); err != nil {
+		t.Fatal(err)
+	}
+	if d := raw.Distance(compressed); d > 8 {
+		t.Fatalf("MJPEG grid differs from raw grid by %d: %v vs %v", d, compressed.Cells, raw.Cells)
+	}
+}
+
+func TestStaticFilter(t *testing.T) {
+	grid := NewLumaGrid(4, 4)
+	filter := StaticFilter{Threshold: 4, Heartbeat: 10}
+	if !filter.Keep(grid, 0) {
+		t.Fatal("first frame not kept")
+	}
+	grid.Cells[5] = 3
+	if filter.Keep(grid, 1) {
+		t.Fatal("unchanged frame kept")
+	}
+	grid.Cells[5] = 6
+	if !filter.Keep(grid, 2) {
+		t.Fatal("changed frame not kept")
+	}
+	if filter.Keep(grid, 11) || !filter.Keep(grid, 12) {
+		t.Fatal("heartbeat not kept")
+	}
+}
+
+func BenchmarkLumaGridMJPEG(b *testing.B) {
+	var buf bytes.Buffer
+	if err := jpeg.Encode(&buf, testYCbCr(1280, 720), &jpeg.Options{Quality: 85}); err != nil {
+		b.Fatal(err)
+	}
+	grid := NewLumaGrid(16, 9)
+	b.SetBytes(int64(buf.Len()))
+	b.ReportAllocs()
+	for i := 0; i < b.N; i++ {
+		if err := grid.FromMJPEG(buf.Bytes()); err != nil {
+			b.Fatal(err)
+		}
+	}
+}
+
+func BenchmarkLumaGridYUYV(b *testing.B) {
+	frame := make([]byte, 1280*720*2)
+	grid := NewLumaGrid(16, 9)
+	b.ReportAllocs()
+	for i := 0; i < b.N; i++ {
+		grid.FromYUYV(frame, 1280, 720)
+	}
+}
@@ -0,0 +1,60 @@
+package pipeline
+
+import (
+	"sync"
+
+	"github.com/vladimirvivien/go4vl/device"
+)
+
+// FuseFunc merges the frames of a bracket into dst (grown as needed) and returns it,
+// i.e. imgsupport.FuseExposuresYUYV
+type FuseFunc func(dst []byte, exposures [][]byte) ([]byte, error)
+
+// Bracket returns a stage merging the frames of each bracket (n consecutive frames
+// captured with control sets 0 to n-1, see device.WithBracketing) into one item, so
+// that the stage delivers one item per n frames. The other items of a bracket are
+// dropped, while the stage holds a reference to their frame. A bracket broken by a
+// dropped frame is discarded. The stage merges source frames (Frame.Data, not the data
+// of previous stages) and keeps state across items: it must run with a single worker.
+func Bracket(n int, fuse FuseFunc) Process {
+	var mu sync.Mutex
+	held := make([]*device.Frame, 0, n)
+	exposures := make([][]byte, n)
+	reset := func() {
+		for _, f := range held {
+			f.Release()
+		}
+		held = held[:0]
+	}
+
+	return func(it *Item) error {
+		mu.Lock()
+		defer mu.Unlock()
+
+		f := it.Frame
+		if len(held) > 0 && (f.Bracket != len(held) || f.Sequence != held[len(held)-1].Sequence+1) {
+			reset()
+		}
+		if f.Bracket != len(held) {
+			// not the first frame of a bracket: wait for the next one
+			return ErrDrop
+		}
+		if len(held) < n-1 {
+			f.Retain()
+			held = append(held, f)
+			return ErrDrop
+		}
+
+		for i, h := range held {
+			exposures[i] = h.Data
+		}
+		exposures[n-1] = f.Data
+		out, err := fuse(it.Buffer(len(f.Data)), exposures)
+		reset()
+		if err != nil {
+			return err
+		}
+		it.Data = out
+		return nil
+	}
+}
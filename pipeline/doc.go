@@ -0,0 +1,27 @@
+// Package pipeline runs captured frames through a graph of processing stages.
+//
+// A pipeline is declared as a list of named nodes: sources (devices or frame channels),
+// stages (convert, scale, detect, encode...) and sinks (HTTP, recorder, output device).
+// Each stage or sink reads from one or more earlier nodes (the previous node by default)
+// and runs its function on a pool of workers fed by a bounded queue:
+//
+//	p := pipeline.New()
+//	p.AddDevice("cam", dev) // opened with device.WithFrameOutput and started
+//	p.AddStage("jpeg", toJPEG, pipeline.WithWorkers(4), pipeline.WithOrdering())
+//	p.AddSink("http", serve, pipeline.WithDropWhenFull())
+//	p.AddSink("record", record, pipeline.WithInputs("jpeg"))
+//	err := p.Run(ctx)
+//
+// A full queue blocks its producers, so a slow stage slows down everything upstream of
+// it, down to the device (which then drops frames), unless the stage is declared with
+// WithDropWhenFull. Stages declared WithOrdering deliver items in the order they were
+// queued even when processed by several workers.
+//
+// Items flowing through the pipeline hold a reference on the source frame, so stages can
+// share artifacts derived from it (see device.Frame.Attachment). Stages write their output
+// to buffers obtained from Item.Buffer, which are drawn from a per-stage pool and
+// recycled once downstream nodes are done with them. Items sent to several nodes share
+// their data, and the data of the source frame is shared with the other consumers of the
+// frame, so both must be treated as read-only: stages modifying the data in place (i.e.
+// burning in text, see OSD) get it from Item.Writable, which copies shared data.
+package pipeline
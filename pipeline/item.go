@@ -0,0 +1,106 @@
+package pipeline
+
+import (
+	"sync"
+	"sync/atomic"
+
+	"github.com/vladimirvivien/go4vl/device"
+)
+
+// buffer is a pooled output buffer shared by the items fanned out from a node
+type buffer struct {
+	b    []byte
+	refs int32
+	pool *sync.Pool
+}
+
+func (b *buffer) retain() {
+	atomic.AddInt32(&b.refs, 1)
+}
+
+func (b *buffer) release() {
+	if atomic.AddInt32(&b.refs, -1) == 0 {
+		b.pool.Put(b)
+	}
+}
+
+// Item is the unit of work flowing through a pipeline
+type Item struct {
+	// Source is the name of the source node the item comes from
+	Source string
+
+	// Frame is the source frame. The item holds a reference on it until it leaves the pipeline.
+	Frame *device.Frame
+
+	// Data is the current payload: the frame data as captured, or the output of the last stage
+	// that replaced it (see Buffer)
+	Data []byte
+
+	buf    *buffer // buffer backing Data, if drawn from a stage pool
+	out    *buffer // buffer obtained by the running stage
+	pool   *sync.Pool
+	seq    uint64 // position in the queue of the node processing the item
+	shared bool   // Data is shared with items sent to other nodes
+}
+
+// Buffer returns an empty buffer with a capacity of at least n bytes, for the running stage
+// to write its output to. Once the stage returns, the buffer replaces the previous one
+// backing Data (set Data to the output written into the buffer).
+func (it *Item) Buffer(n int) []byte {
+	if it.out == nil {
+		it.out = it.pool.Get().(*buffer)
+		it.out.refs = 1
+	}
+	if cap(it.out.b) < n {
+		it.out.b = make([]byte, 0, n)
+	}
+	return it.out.b[:0]
+}
+
+// Writable returns the item data for the running stage to modify in place: Data itself
+// when it is held by a buffer of the pipeline that no other item shares; otherwise (the
+// data of the source frame, which other consumers of the frame read, or shared data) Data
+// is first copied to a buffer of the stage (see Buffer).
+func (it *Item) Writable() []byte {
+	if it.shared || it.buf == nil {
+		it.Data = append(it.Buffer(len(it.Data)), it.Data...)
+	}
+	return it.Data
+}
+
+// stageDone makes the buffer obtained by the stage (if any) the one backing Data
+func (it *Item) stageDone() {
+	if it.out == nil {
+		return
+	}
+	if it.buf != nil {
+		it.buf.release()
+	}
+	it.buf, it.out = it.out, nil
+	it.shared = false
+}
+
+// clone returns a copy of the item sharing its frame and data
+func (it *Item) clone() *Item {
+	c := &Item{Source: it.Source, Frame: it.Frame, Data: it.Data, buf: it.buf, shared: true}
+	it.shared = true
+	it.Frame.Retain()
+	if it.buf != nil {
+		it.buf.retain()
+	}
+	return c
+}
+
+// release drops the item, along with its frame and buffers
+func (it *Item) release() {
+	if it.out != nil {
+		it.out.release()
+		it.out = nil
+	}
+	if it.buf != nil {
+		it.buf.release()
+		it.buf = nil
+	}
+	it.Frame.Release()
+	it.Frame, it.Data = nil, nil
+}
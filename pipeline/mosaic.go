@@ -0,0 +1,253 @@
+package pipeline
+
+import (
+	"context"
+	"fmt"
+	"image"
+	"math"
+	"sync"
+	"time"
+
+	"github.com/vladimirvivien/go4vl/device"
+	"github.com/vladimirvivien/go4vl/imgsupport"
+)
+
+// MosaicTile is a source shown in a mosaic
+type MosaicTile struct {
+	// Source is the name of the source node of the items shown in the tile
+	Source string
+
+	// Width, Height and Layout describe the item data (i.e. the device pixel format)
+	Width, Height int
+	Layout        imgsupport.Layout
+}
+
+// MosaicConfig describes a mosaic
+type MosaicConfig struct {
+	// Width, Height and Layout describe the composite frames
+	Width, Height int
+	Layout        imgsupport.Layout
+
+	// Columns is the number of tiles per row (enough for a square grid by default)
+	Columns int
+
+	// FPS is the composite frame rate (15 by default)
+	FPS int
+
+	// Tiles lists the sources shown, row by row
+	Tiles []MosaicTile
+}
+
+// Mosaic composites the latest frame of several sources into tiles of one frame, at a
+// fixed frame rate: for one stream showing a wall of cameras. Its Collect method is the
+// process of a sink reading from the sources, its Frames channel delivers the composite
+// frames (i.e. as the source of the nodes serving or encoding them):
+//
+//	m, err := pipeline.NewMosaic(config)
+//	p.AddSink("tiles", m.Collect, pipeline.WithInputs("cam0", "cam1", "cam2", "cam3"))
+//	p.AddSource("wall", m.Frames())
+//	p.AddSink("http", serve)
+//	go m.Run(ctx)
+//	err = p.Run(ctx)
+//
+// Each tile keeps the aspect ratio of its source, and is only redrawn when its source
+// delivered a new frame since the last composite.
+type Mosaic struct {
+	config  MosaicConfig
+	tiles   []*mosaicTile
+	sources map[string]*mosaicTile
+	canvas  []byte
+	frames  chan *device.Frame
+	pool    sync.Pool
+	seq     uint32
+}
+
+type mosaicTile struct {
+	scaler *imgsupport.Scaler
+	size   int // source frame size
+
+	mu    sync.Mutex
+	frame *device.Frame // frame held for data, if any
+	data  []byte
+	owned []byte // copy of data not backed by the frame (output of a stage)
+	dirty bool
+}
+
+// mosaicBlack is black in each layout (limited range YUV)
+var mosaicBlack = [4]byte{16, 128, 128, 0}
+
+// NewMosaic returns a mosaic drawing the tiles of config (black until their source delivers a frame)
+func NewMosaic(config MosaicConfig) (*Mosaic, error) {
+	n := len(config.Tiles)
+	if n == 0 {
+		return nil, fmt.Errorf("pipeline: mosaic: no tiles")
+	}
+	if config.Columns <= 0 {
+		config.Columns = int(math.Ceil(math.Sqrt(float64(n))))
+	}
+	if config.FPS <= 0 {
+		config.FPS = 15
+	}
+	rows := (n + config.Columns - 1) / config.Columns
+	size := config.Layout.FrameSize(config.Width, config.Height)
+	if size == 0 || config.Width/config.Columns < 2 || config.Height/rows < 2 {
+		return nil, fmt.Errorf("pipeline: mosaic: invalid %dx%d %s frames", config.Width, config.Height, config.Layout)
+	}
+
+	m := &Mosaic{
+		config:  config,
+		sources: make(map[string]*mosaicTile),
+		canvas:  make([]byte, size),
+		frames:  make(chan *device.Frame, 1),
+	}
+	m.pool.New = func() interface{} {
+		b := make([]byte, size)
+		return &b
+	}
+	black := mosaicBlack
+	if config.Layout == imgsupport.LayoutRGBA {
+		black = [4]byte{0, 0, 0, 0xff}
+	}
+	canvas := image.Rect(0, 0, config.Width, config.Height)
+	if err := imgsupport.Fill(m.canvas, config.Layout, config.Width, config.Height, canvas, black); err != nil {
+		return nil, fmt.Errorf("pipeline: mosaic: %w", err)
+	}
+
+	for i, t := range config.Tiles {
+		if _, dup := m.sources[t.Source]; dup {
+			return nil, fmt.Errorf("pipeline: mosaic: duplicate source %s", t.Source)
+		}
+		col, row := i%config.Columns, i/config.Columns
+		cell := image.Rect(
+			col*config.Width/config.Columns, row*config.Height/rows,
+			(col+1)*config.Width/config.Columns, (row+1)*config.Height/rows,
+		)
+		scaler, err := imgsupport.NewScaler(t.Layout, t.Width, t.Height, config.Layout, config.Width, config.Height, fitRect(cell, t.Width, t.Height))
+		if err != nil {
+			return nil, fmt.Errorf("pipeline: mosaic: tile %s: %w", t.Source, err)
+		}
+		tile := &mosaicTile{scaler: scaler, size: t.Layout.FrameSize(t.Width, t.Height)}
+		m.tiles = append(m.tiles, tile)
+		m.sources[t.Source] = tile
+	}
+	return m, nil
+}
+
+// fitRect returns the largest rectangle of the aspect ratio of a width x height frame
+// centered in cell, with even bounds
+func fitRect(cell image.Rectangle, width, height int) image.Rectangle {
+	w, h := cell.Dx(), cell.Dy()
+	if w*height > h*width {
+		w = h * width / height
+	} else {
+		h = w * height / width
+	}
+	w, h = w&^1, h&^1
+	x := (cell.Min.X + (cell.Dx()-w)/2) &^ 1
+	y := (cell.Min.Y + (cell.Dy()-h)/2) &^ 1
+	return image.Rect(x, y, x+w, y+h)
+}
+
+// Collect is the process of a sink feeding the mosaic: it keeps the item as the latest
+// frame of its tile. Items of sources not in the mosaic are dropped.
+func (m *Mosaic) Collect(it *Item) error {
+	tile, ok := m.sources[it.Source]
+	if !ok {
+		return ErrDrop
+	}
+	if len(it.Data) < tile.size {
+		return fmt.Errorf("pipeline: mosaic: %s: frame too small: %d bytes", it.Source, len(it.Data))
+	}
+
+	tile.mu.Lock()
+	defer tile.mu.Unlock()
+	tile.drop()
+	if it.buf == nil {
+		// the data is the source frame's: hold the frame rather than copy it
+		it.Frame.Retain()
+		tile.frame, tile.data = it.Frame, it.Data
+	} else {
+		tile.owned = append(tile.owned[:0], it.Data...)
+		tile.data = tile.owned
+	}
+	tile.dirty = true
+	return nil
+}
+
+// drop releases the frame held by the tile, if any
+func (t *mosaicTile) drop() {
+	if t.frame != nil {
+		t.frame.Release()
+		t.frame = nil
+	}
+}
+
+// Frames returns the channel of composite frames, closed once Run returns. Frames must be
+// released by their consumer. Composites the consumer is not ready for are skipped.
+func (m *Mosaic) Frames() <-chan *device.Frame {
+	return m.frames
+}
+
+// Run composites frames at the configured frame rate until ctx is done
+func (m *Mosaic) Run(ctx context.Context) error {
+	defer func() {
+		close(m.frames)
+		for _, t := range m.tiles {
+			t.mu.Lock()
+			t.drop()
+			t.mu.Unlock()
+		}
+	}()
+
+	ticker := time.NewTicker(time.Second / time.Duration(m.config.FPS))
+	defer ticker.Stop()
+	for {
+		select {
+		case <-ctx.Done():
+			return ctx.Err()
+		case <-ticker.C:
+		}
+		frame, err := m.compose()
+		if err != nil {
+			return err
+		}
+		select {
+		case m.frames <- frame:
+		default:
+			frame.Release()
+		}
+	}
+}
+
+// compose redraws the tiles with a new frame (concurrently) and returns a copy of the canvas
+func (m *Mosaic) compose() (*device.Frame, error) {
+	var wg sync.WaitGroup
+	errs := make([]error, len(m.tiles))
+	for i, t := range m.tiles {
+		wg.Add(1)
+		go func(i int, t *mosaicTile) {
+			defer wg.Done()
+			t.mu.Lock()
+			defer t.mu.Unlock()
+			if !t.dirty {
+				return
+			}
+			t.dirty = false
+			errs[i] = t.scaler.Scale(m.canvas, t.data)
+		}(i, t)
+	}
+	wg.Wait()
+	for i, err := range errs {
+		if err != nil {
+			return nil, fmt.Errorf("pipeline: mosaic: %s: %w", m.config.Tiles[i].Source, err)
+		}
+	}
+
+	buf := m.pool.Get().(*[]byte)
+	copy(*buf, m.canvas)
+	frame := device.NewFrame(*buf, func(*device.Frame) { m.pool.Put(buf) })
+	frame.Sequence = m.seq
+	frame.Timestamp = time.Duration(time.Now().UnixNano())
+	m.seq++
+	return frame, nil
+}
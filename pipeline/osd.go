@@ -0,0 +1,23 @@
+package pipeline
+
+import (
+	"sync"
+
+	"github.com/vladimirvivien/go4vl/imgsupport"
+)
+
+// OSD returns a stage burning the text returned by text for each item (i.e. a timestamp)
+// into the item data, in place (see Item.Writable). With a nil text function, the stage
+// draws the text last set on the overlay (i.e. a camera name). Only the characters that
+// changed since the previous item are looked up again.
+func OSD(overlay *imgsupport.Overlay, text func(*Item) string) Process {
+	var mu sync.Mutex
+	return func(it *Item) error {
+		mu.Lock()
+		defer mu.Unlock()
+		if text != nil {
+			overlay.Set(text(it))
+		}
+		return overlay.Draw(it.Writable())
+	}
+}
@@ -0,0 +1,436 @@
+package pipeline
+
+import (
+	"context"
+	"errors"
+	"fmt"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/vladimirvivien/go4vl/device"
+)
+
+// ErrDrop can be returned by a stage to drop an item without counting an error
+// (i.e. a motion detector dropping still frames)
+var ErrDrop = errors.New("pipeline: drop item")
+
+// Process is the function run by a stage or sink on each item. A stage replaces the item
+// data by writing to Item.Buffer, or leaves it as is (i.e. detectors).
+type Process func(*Item) error
+
+// Stats reports the activity of a node
+type Stats struct {
+	// In counts items queued to the node, Out items it passed on (or consumed, for sinks)
+	In  uint64
+	Out uint64
+
+	// Dropped counts items dropped on a full queue (see WithDropWhenFull) or by the
+	// stage (see ErrDrop), Errors items the stage failed to process
+	Dropped uint64
+	Errors  uint64
+
+	// Queued is the number of items waiting in the node queue
+	Queued int
+
+	// Latency is the average time spent processing an item (moving average), MaxLatency the longest
+	Latency    time.Duration
+	MaxLatency time.Duration
+
+	// LastError is the last error returned by the stage
+	LastError error
+}
+
+type nodeConfig struct {
+	inputs   []string
+	workers  int
+	queue    int
+	ordered  bool
+	dropFull bool
+}
+
+// Option configures a stage or sink
+type Option func(*nodeConfig)
+
+// WithInputs sets the nodes a stage reads from (the last source or stage declared before it by default)
+func WithInputs(names ...string) Option {
+	return func(c *nodeConfig) {
+		c.inputs = names
+	}
+}
+
+// WithWorkers sets the number of items processed concurrently by a stage (1 by default)
+func WithWorkers(n int) Option {
+	return func(c *nodeConfig) {
+		c.workers = n
+	}
+}
+
+// WithQueueSize sets the number of items waiting to be processed by a stage (2 per worker by default)
+func WithQueueSize(n int) Option {
+	return func(c *nodeConfig) {
+		c.queue = n
+	}
+}
+
+// WithOrdering makes a stage with several workers deliver items in the order they were queued
+func WithOrdering() Option {
+	return func(c *nodeConfig) {
+		c.ordered = true
+	}
+}
+
+// WithDropWhenFull makes a stage drop the items sent to it while its queue is full instead
+// of blocking its producers, i.e. for live views that should not hold back a recorder
+func WithDropWhenFull() Option {
+	return func(c *nodeConfig) {
+		c.dropFull = true
+	}
+}
+
+// result is an item processed by a worker of an ordered stage (nil when dropped)
+type result struct {
+	seq  uint64
+	item *Item
+}
+
+type node struct {
+	name    string
+	config  nodeConfig
+	process Process
+	sink    bool
+
+	// source nodes
+	frames func() <-chan *device.Frame
+
+	in        chan *Item
+	seq       uint64 // next sequence number, guarded by sendMu
+	sendMu    sync.Mutex
+	producers int32
+	outputs   []*node
+	pool      sync.Pool
+
+	in64, out64, dropped, errs uint64
+
+	statsMu    sync.Mutex
+	latency    time.Duration
+	maxLatency time.Duration
+	lastErr    error
+}
+
+// Pipeline is a graph of nodes processing frames (see package documentation)
+type Pipeline struct {
+	nodes   []*node
+	byName  map[string]*node
+	running int32
+}
+
+// New returns an empty pipeline
+func New() *Pipeline {
+	return &Pipeline{byName: make(map[string]*node)}
+}
+
+func (p *Pipeline) add(n *node) {
+	n.pool.New = func() interface{} { return &buffer{pool: &n.pool} }
+	p.nodes = append(p.nodes, n)
+	if _, dup := p.byName[n.name]; !dup {
+		p.byName[n.name] = n
+	}
+}
+
+// AddSource adds a source node delivering the frames received from a channel
+func (p *Pipeline) AddSource(name string, frames <-chan *device.Frame) {
+	p.add(&node{name: name, frames: func() <-chan *device.Frame { return frames }})
+}
+
+// AddDevice adds a source node delivering the frames captured by dev, which must be opened
+// with device.WithFrameOutput (and started before the pipeline runs)
+func (p *Pipeline) AddDevice(name string, dev *device.Device) {
+	p.add(&node{name: name, frames: dev.GetFrames})
+}
+
+// AddStage adds a node running process on the items of its inputs and passing them on.
+// Without WithInputs, the stage reads from the last source or stage declared before it.
+func (p *Pipeline) AddStage(name string, process Process, options ...Option) {
+	n := &node{name: name, process: process}
+	for _, o := range options {
+		o(&n.config)
+	}
+	p.add(n)
+}
+
+// AddSink adds a node consuming the items of its inputs. Sinks are stages with no output:
+// items are released once process returns, so a sink keeping data must copy it (or retain
+// the frame).
+func (p *Pipeline) AddSink(name string, process Process, options ...Option) {
+	p.AddStage(name, process, options...)
+	p.nodes[len(p.nodes)-1].sink = true
+}
+
+// Stats returns the activity of the node name
+func (p *Pipeline) Stats(name string) (Stats, bool) {
+	n, ok := p.byName[name]
+	if !ok {
+		return Stats{}, false
+	}
+	n.statsMu.Lock()
+	defer n.statsMu.Unlock()
+	return Stats{
+		In:         atomic.LoadUint64(&n.in64),
+		Out:        atomic.LoadUint64(&n.out64),
+		Dropped:    atomic.LoadUint64(&n.dropped),
+		Errors:     atomic.LoadUint64(&n.errs),
+		Queued:     len(n.in),
+		Latency:    n.latency,
+		MaxLatency: n.maxLatency,
+		LastError:  n.lastErr,
+	}, true
+}
+
+// link validates the graph and connects each node to its inputs
+func (p *Pipeline) link() error {
+	if len(p.byName) != len(p.nodes) {
+		return fmt.Errorf("pipeline: duplicate node names")
+	}
+	for i, n := range p.nodes {
+		if n.frames != nil {
+			continue
+		}
+		inputs := n.config.inputs
+		if len(inputs) == 0 {
+			for j := i - 1; j >= 0; j-- {
+				if !p.nodes[j].sink {
+					inputs = []string{p.nodes[j].name}
+					break
+				}
+			}
+		}
+		if len(inputs) == 0 {
+			return fmt.Errorf("pipeline: stage %s: no input", n.name)
+		}
+		for _, name := range inputs {
+			in, ok := p.byName[name]
+			if !ok {
+				return fmt.Errorf("pipeline: stage %s: unknown input %s", n.name, name)
+			}
+			if in.sink {
+				return fmt.Errorf("pipeline: stage %s: input %s is a sink", n.name, name)
+			}
+			// inputs must be declared first, which keeps the graph acyclic
+			if in == n || indexOf(p.nodes, in) > i {
+				return fmt.Errorf("pipeline: stage %s: input %s declared after the stage", n.name, name)
+			}
+			in.outputs = append(in.outputs, n)
+			n.producers++
+		}
+
+		if n.config.workers <= 0 {
+			n.config.workers = 1
+		}
+		if n.config.queue <= 0 {
+			n.config.queue = 2 * n.config.workers
+		}
+		n.in = make(chan *Item, n.config.queue)
+	}
+	return nil
+}
+
+func indexOf(nodes []*node, n *node) int {
+	for i := range nodes {
+		if nodes[i] == n {
+			return i
+		}
+	}
+	return -1
+}
+
+// Run runs the pipeline until its sources are exhausted or ctx is done. Items in flight
+// when sources stop are processed through to the sinks before Run returns.
+func (p *Pipeline) Run(ctx context.Context) error {
+	if !atomic.CompareAndSwapInt32(&p.running, 0, 1) {
+		return fmt.Errorf("pipeline: already running")
+	}
+	if err := p.link(); err != nil {
+		return err
+	}
+
+	var wg sync.WaitGroup
+	for _, n := range p.nodes {
+		wg.Add(1)
+		if n.frames != nil {
+			go func(n *node) {
+				defer wg.Done()
+				n.runSource(ctx)
+			}(n)
+			continue
+		}
+		go func(n *node) {
+			defer wg.Done()
+			n.run()
+		}(n)
+	}
+	wg.Wait()
+	return ctx.Err()
+}
+
+func (n *node) runSource(ctx context.Context) {
+	defer n.finish()
+	frames := n.frames()
+	if frames == nil {
+		return
+	}
+	for {
+		select {
+		case <-ctx.Done():
+			return
+		case frame, ok := <-frames:
+			if !ok {
+				return
+			}
+			atomic.AddUint64(&n.in64, 1)
+			n.emit(&Item{Source: n.name, Frame: frame, Data: frame.Data})
+		}
+	}
+}
+
+// run processes the queued items until all the node inputs are done
+func (n *node) run() {
+	defer n.finish()
+
+	var results chan result
+	var collected sync.WaitGroup
+	if n.config.ordered && n.config.workers > 1 {
+		results = make(chan result, n.config.workers)
+		collected.Add(1)
+		go func() {
+			defer collected.Done()
+			n.reorder(results)
+		}()
+	}
+
+	var wg sync.WaitGroup
+	for i := 0; i < n.config.workers; i++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			for it := range n.in {
+				seq := it.seq
+				processed := n.processItem(it)
+				if results != nil {
+					results <- result{seq: seq, item: processed}
+				} else if processed != nil {
+					n.emit(processed)
+				}
+			}
+		}()
+	}
+	wg.Wait()
+	if results != nil {
+		close(results)
+		collected.Wait()
+	}
+}
+
+// processItem runs the stage on it, and returns it unless it was dropped
+func (n *node) processItem(it *Item) *Item {
+	it.pool = &n.pool
+	start := time.Now()
+	err := n.process(it)
+	elapsed := time.Since(start)
+
+	n.statsMu.Lock()
+	if n.latency == 0 {
+		n.latency = elapsed
+	} else {
+		n.latency += (elapsed - n.latency) / 16
+	}
+	if elapsed > n.maxLatency {
+		n.maxLatency = elapsed
+	}
+	if err != nil && !errors.Is(err, ErrDrop) {
+		n.lastErr = err
+	}
+	n.statsMu.Unlock()
+
+	switch {
+	case errors.Is(err, ErrDrop):
+		atomic.AddUint64(&n.dropped, 1)
+	case err != nil:
+		atomic.AddUint64(&n.errs, 1)
+	default:
+		it.stageDone()
+		return it
+	}
+	it.release()
+	return nil
+}
+
+// reorder passes on processed items in sequence order
+func (n *node) reorder(results <-chan result) {
+	pending := make(map[uint64]*Item)
+	next := uint64(0)
+	for r := range results {
+		if r.seq != next {
+			pending[r.seq] = r.item
+			continue
+		}
+		for {
+			if r.item != nil {
+				n.emit(r.item)
+			}
+			next++
+			item, ok := pending[next]
+			if !ok {
+				break
+			}
+			delete(pending, next)
+			r.item = item
+		}
+	}
+}
+
+// emit passes it on to the node outputs, or releases it when the node has none
+func (n *node) emit(it *Item) {
+	atomic.AddUint64(&n.out64, 1)
+	if len(n.outputs) == 0 {
+		it.release()
+		return
+	}
+	for i, out := range n.outputs {
+		item := it
+		if i < len(n.outputs)-1 {
+			item = it.clone()
+		}
+		out.enqueue(item)
+	}
+}
+
+// enqueue queues it for processing, blocking while the queue is full unless the node
+// drops items in that case
+func (n *node) enqueue(it *Item) {
+	atomic.AddUint64(&n.in64, 1)
+	n.sendMu.Lock()
+	defer n.sendMu.Unlock()
+	it.seq = n.seq
+	if n.config.dropFull {
+		select {
+		case n.in <- it:
+		default:
+			atomic.AddUint64(&n.dropped, 1)
+			it.release()
+			return
+		}
+	} else {
+		n.in <- it
+	}
+	n.seq++
+}
+
+// finish signals the node outputs that one of their producers is done
+func (n *node) finish() {
+	for _, out := range n.outputs {
+		if atomic.AddInt32(&out.producers, -1) == 0 {
+			close(out.in)
+		}
+	}
+}
@@ -0,0 +1,330 @@
+package pipeline
+
+import (
+	"bytes"
+	"context"
+	"encoding/binary"
+	"image"
+	"sync"
+	"sync/atomic"
+	"testing"
+	"time"
+
+	"github.com/vladimirvivien/go4vl/device"
+	"github.com/vladimirvivien/go4vl/imgsupport"
+)
+
+func TestPipeline(t *testing.T) {
+	const count = 200
+	var released int32
+	frames := make(chan *device.Frame)
+	go func() {
+		defer close(frames)
+		for i := 0; i < count; i++ {
+			data := make([]byte, 4)
+			binary.BigEndian.PutUint32(data, uint32(i))
+			frames <- device.NewFrame(data, func(*device.Frame) { atomic.AddInt32(&released, 1) })
+		}
+	}()
+
+	p := New()
+	p.AddSource("cam", frames)
+	// doubles the frame number, taking longer on even frames to shuffle completions
+	p.AddStage("double", func(it *Item) error {
+		n := binary.BigEndian.Uint32(it.Data)
+		if n%2 == 0 {
+			time.Sleep(100 * time.Microsecond)
+		}
+		it.Data = it.Buffer(4)[:4]
+		binary.BigEndian.PutUint32(it.Data, 2*n)
+		return nil
+	}, WithWorkers(4), WithOrdering())
+	p.AddStage("odd", func(it *Item) error {
+		if binary.BigEndian.Uint32(it.Frame.Data)%2 == 0 {
+			return ErrDrop
+		}
+		return nil
+	}, WithInputs("cam"))
+
+	var mu sync.Mutex
+	var doubled []uint32
+	p.AddSink("collect", func(it *Item) error {
+		mu.Lock()
+		doubled = append(doubled, binary.BigEndian.Uint32(it.Data))
+		mu.Unlock()
+		return nil
+	}, WithInputs("double"))
+	var odd int32
+	p.AddSink("count", func(it *Item) error {
+		atomic.AddInt32(&odd, 1)
+		return nil
+	})
+
+	if err := p.Run(context.Background()); err != nil {
+		t.Fatal(err)
+	}
+
+	if len(doubled) != count {
+		t.Fatalf("collected %d items, want %d", len(doubled), count)
+	}
+	for i, v := range doubled {
+		if v != uint32(2*i) {
+			t.Fatalf("item %d: got %d, out of order", i, v)
+		}
+	}
+	if odd != count/2 {
+		t.Fatalf("counted %d odd frames", odd)
+	}
+	if released != count {
+		t.Fatalf("released %d frames, want %d", released, count)
+	}
+	if s, _ := p.Stats("odd"); s.In != count || s.Dropped != count/2 {
+		t.Fatalf("unexpected stats: %+v", s)
+	}
+}
+
+func TestPipelineInvalid(t *testing.T) {
+	p := New()
+	p.AddStage("first", func(*Item) error { return nil })
+	if err := p.Run(context.Background()); err == nil {
+		t.Fatal("stage without input accepted")
+	}
+
+	p = New()
+	p.AddSource("cam", nil)
+	p.AddStage("a", func(*Item) error { return nil }, WithInputs("b"))
+	p.AddStage("b", func(*Item) error { return nil })
+	if err := p.Run(context.Background()); err == nil {
+		t.Fatal("cycle accepted")
+	}
+}
+
+func TestBracket(t *testing.T) {
+	frames := make(chan *device.Frame, 16)
+	// brackets of 3, the frame with sequence 4 is missing
+	for _, seq := range []uint32{1, 2, 3, 5, 6, 7, 8, 9} {
+		f := device.NewFrame([]byte{byte(seq)}, nil)
+		f.Sequence, f.Bracket = seq, int(seq%3)
+		frames <- f
+	}
+	close(frames)
+
+	sum := func(dst []byte, exposures [][]byte) ([]byte, error) {
+		var s byte
+		for _, e := range exposures {
+			s += e[0]
+		}
+		return append(dst, s), nil
+	}
+
+	p := New()
+	p.AddSource("cam", frames)
+	p.AddStage("hdr", Bracket(3, sum))
+	var fused []byte
+	p.AddSink("collect", func(it *Item) error {
+		fused = append(fused, it.Data[0])
+		return nil
+	})
+	if err := p.Run(context.Background()); err != nil {
+		t.Fatal(err)
+	}
+	// 3+4+5 is broken by the gap, 6+7+8 is complete, 9 starts an incomplete bracket
+	if len(fused) != 1 || fused[0] != 6+7+8 {
+		t.Fatalf("unexpected fused items: %v", fused)
+	}
+}
+
+func TestMosaic(t *testing.T) {
+	// two 4:3 YUYV cameras side by side in a 16:9 frame
+	m, err := NewMosaic(MosaicConfig{
+		Width: 128, Height: 48, Layout: imgsupport.LayoutYUYV,
+		Tiles: []MosaicTile{
+			{Source: "a", Width: 64, Height: 48, Layout: imgsupport.LayoutYUYV},
+			{Source: "b", Width: 64, Height: 48, Layout: imgsupport.LayoutYUYV},
+		},
+	})
+	if err != nil {
+		t.Fatal(err)
+	}
+	var released int32
+	gray := func(luma byte) *Item {
+		data := make([]byte, 64*48*2)
+		for i := 0; i < len(data); i += 2 {
+			data[i], data[i+1] = luma, 128
+		}
+		frame := device.NewFrame(data, func(*device.Frame) { atomic.AddInt32(&released, 1) })
+		return &Item{Source: "a", Frame: frame, Data: data}
+	}
+	lumaAt := func(f *device.Frame, x, y int) byte { return f.Data[y*2*128+2*x] }
+
+	// tile b has no frame yet
+	a := gray(50)
+	if err := m.Collect(a); err != nil {
+		t.Fatal(err)
+	}
+	a.release()
+	out, err := m.compose()
+	if err != nil {
+		t.Fatal(err)
+	}
+	if l := lumaAt(out, 32, 24); l != 50 {
+		t.Fatalf("tile a: luma %d", l)
+	}
+	if l := lumaAt(out, 96, 24); l != 16 {
+		t.Fatalf("tile b: luma %d, want black", l)
+	}
+	out.Release()
+	if released != 0 {
+		t.Fatal("frame of tile a released while shown")
+	}
+
+	b := gray(200)
+	b.Source = "b"
+	m.Collect(b)
+	b.release()
+	a = gray(90)
+	m.Collect(a)
+	a.release()
+	if released != 1 {
+		t.Fatalf("replaced frame not released")
+	}
+	out, _ = m.compose()
+	if l, r := lumaAt(out, 32, 24), lumaAt(out, 96, 24); l != 90 || r != 200 {
+		t.Fatalf("tiles: luma %d and %d", l, r)
+	}
+	out.Release()
+
+	unknown := gray(0)
+	unknown.Source = "c"
+	if err := m.Collect(unknown); err != ErrDrop {
+		t.Fatalf("collected item of unknown source: %v", err)
+	}
+	unknown.release()
+
+	ctx, cancel := context.WithCancel(context.Background())
+	cancel()
+	m.Run(ctx)
+	if released != 4 {
+		t.Fatalf("released %d frames, want 4", released)
+	}
+}
+
+func TestOSD(t *testing.T) {
+	const w, h = 64, 24
+	atlas := imgsupport.BasicAtlas(1)
+	overlay, err := imgsupport.NewOverlay(atlas, imgsupport.DefaultOverlayStyle, imgsupport.LayoutYUYV, w, h, image.Pt(0, 0))
+	if err != nil {
+		t.Fatal(err)
+	}
+	frames := make(chan *device.Frame, 1)
+	data := make([]byte, w*h*2)
+	for i := range data {
+		data[i] = 128
+	}
+	frames <- device.NewFrame(data, nil)
+	close(frames)
+
+	p := New()
+	p.AddSource("cam", frames)
+	p.AddStage("osd", OSD(overlay, func(*Item) string { return "8" }))
+	var burned, raw []byte
+	p.AddSink("record", func(it *Item) error {
+		burned = append(burned, it.Data...)
+		return nil
+	})
+	p.AddSink("live", func(it *Item) error {
+		raw = append(raw, it.Data...)
+		return nil
+	}, WithInputs("cam"))
+	if err := p.Run(context.Background()); err != nil {
+		t.Fatal(err)
+	}
+
+	changed := 0
+	for i := range burned {
+		if burned[i] != 128 {
+			changed++
+		}
+		if raw[i] != 128 {
+			t.Fatal("text burned into the data of another node")
+		}
+	}
+	if changed == 0 {
+		t.Fatal("no text burned")
+	}
+}
+
+func TestOSDSourceFrame(t *testing.T) {
+	const w, h = 64, 24
+	atlas := imgsupport.BasicAtlas(1)
+	overlay, err := imgsupport.NewOverlay(atlas, imgsupport.DefaultOverlayStyle, imgsupport.LayoutYUYV, w, h, image.Pt(0, 0))
+	if err != nil {
+		t.Fatal(err)
+	}
+	data := make([]byte, w*h*2)
+	for i := range data {
+		data[i] = 128
+	}
+	// another consumer of the frame (i.e. a subscriber) holds it along with the pipeline
+	frame := device.NewFrame(data, nil)
+	frame.Retain()
+	defer frame.Release()
+	frames := make(chan *device.Frame, 1)
+	frames <- frame
+	close(frames)
+
+	p := New()
+	p.AddSource("cam", frames)
+	p.AddStage("osd", OSD(overlay, func(*Item) string { return "8" }))
+	clean := append([]byte(nil), data...)
+	burned := false
+	p.AddSink("record", func(it *Item) error {
+		burned = !bytes.Equal(it.Data, clean)
+		return nil
+	})
+	if err := p.Run(context.Background()); err != nil {
+		t.Fatal(err)
+	}
+	if !burned {
+		t.Fatal("no text burned")
+	}
+	for _, b := range frame.Data {
+		if b != 128 {
+			t.Fatal("text burned into the source frame")
+		}
+	}
+}
+
+func TestPrivacyMask(t *testing.T) {
+	const w, h = 32, 16
+	mask, err := imgsupport.NewPrivacyMask(w, h, imgsupport.PrivacyMaskConfig{},
+		[]image.Point{{0, 0}, {16, 0}, {16, 8}, {0, 8}})
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	// a raw frame whose first bytes happen to be a JPEG start of image marker
+	frame := make([]byte, imgsupport.LayoutYUYV.FrameSize(w, h))
+	for i := range frame {
+		frame[i] = 0x80
+	}
+	frame[0], frame[1] = 0xFF, 0xD8
+	var pool sync.Pool
+	pool.New = func() interface{} { return &buffer{pool: &pool} }
+	it := &Item{Data: frame, pool: &pool}
+	if err := PrivacyMask(mask, imgsupport.LayoutYUYV)(it); err != nil {
+		t.Fatal(err)
+	}
+	if it.Data[0] == 0xFF || it.Data[1] == 0xD8 || it.Data[2*w*h-1] != 0x80 {
+		t.Fatalf("raw frame not masked: %X", it.Data[:4])
+	}
+	// the source frame data is masked in a copy
+	if frame[0] != 0xFF || frame[1] != 0xD8 {
+		t.Fatal("mask applied to the source frame")
+	}
+
+	// MJPEG frames are decided by the layout, not the data
+	if err := PrivacyMask(mask, imgsupport.LayoutMJPEG)(&Item{Data: make([]byte, 64), pool: &pool}); err == nil {
+		t.Fatal("invalid JPEG data masked")
+	}
+}
@@ -0,0 +1,24 @@
+package pipeline
+
+import (
+	"github.com/vladimirvivien/go4vl/imgsupport"
+)
+
+// PrivacyMask returns a stage obscuring the regions of mask in the item data, frames of
+// layout (i.e. the device pixel format). Raw frames are masked in place (see
+// Item.Writable); MJPEG frames (imgsupport.LayoutMJPEG) are rewritten into a buffer of the
+// stage (see imgsupport.PrivacyMask.ApplyMJPEG).
+func PrivacyMask(mask *imgsupport.PrivacyMask, layout imgsupport.Layout) Process {
+	return func(it *Item) error {
+		if layout == imgsupport.LayoutMJPEG {
+			// room for the odd extra byte of padding and stuffing
+			out, err := mask.ApplyMJPEG(it.Buffer(len(it.Data)+len(it.Data)/64), it.Data)
+			if err != nil {
+				return err
+			}
+			it.Data = out
+			return nil
+		}
+		return mask.Apply(it.Writable(), layout)
+	}
+}
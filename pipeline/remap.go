@@ -0,0 +1,18 @@
+package pipeline
+
+import (
+	"github.com/vladimirvivien/go4vl/imgsupport"
+)
+
+// Undistort returns a stage correcting the lens distortion of the item data with r, into
+// a buffer of the stage (a GREY frame when r is luma only, i.e. for analytics stages)
+func Undistort(r *imgsupport.Remapper) Process {
+	return func(it *Item) error {
+		out, err := r.Remap(it.Buffer(r.OutputSize()), it.Data)
+		if err != nil {
+			return err
+		}
+		it.Data = out
+		return nil
+	}
+}
@@ -0,0 +1,10 @@
+// Package rtp sends H.264 video to a peer over RTP (RFC 3550, RFC 6184). RTP and RTCP share
+// one UDP port (rtcp-mux), packets are paced, and picture loss indications from the peer
+// request key frames from the encoder.
+//
+// Dial sends plain RTP to a known address. Listen serves as the media path of a WebRTC
+// sendonly video session: it answers the ICE connectivity checks of the browser as an ICE
+// lite agent, and protects media with SRTP (AES_CM_128_HMAC_SHA1_80) once the keys are
+// established by a DTLS-SRTP handshake. The handshake is supplied by the application
+// (WithDTLS), as the standard library has no DTLS implementation.
+package rtp
@@ -0,0 +1,96 @@
+package rtp
+
+import (
+	"io"
+	"net"
+	"os"
+	"sync"
+	"time"
+)
+
+// dtlsConn is the connection a DTLSHandshake runs over: it reads the DTLS records the read
+// loop of the peer demultiplexes from the packets of the remote address, and writes to it
+// from the peer socket.
+type dtlsConn struct {
+	conn   *net.UDPConn
+	remote *net.UDPAddr
+	in     chan []byte
+	done   chan struct{}
+	once   sync.Once
+
+	mu       sync.Mutex
+	deadline time.Time
+}
+
+func newDTLSConn(conn *net.UDPConn, remote *net.UDPAddr) *dtlsConn {
+	return &dtlsConn{conn: conn, remote: remote, in: make(chan []byte, 16), done: make(chan struct{})}
+}
+
+// deliver queues a copy of record for Read, or drops it when the handshake does not keep up
+func (c *dtlsConn) deliver(record []byte) {
+	select {
+	case c.in <- append([]byte(nil), record...):
+	default:
+	}
+}
+
+// Read reads the next DTLS datagram. A read deadline set while Read is blocked applies to
+// the next Read.
+func (c *dtlsConn) Read(b []byte) (int, error) {
+	c.mu.Lock()
+	deadline := c.deadline
+	c.mu.Unlock()
+	var expired <-chan time.Time
+	if !deadline.IsZero() {
+		timer := time.NewTimer(time.Until(deadline))
+		defer timer.Stop()
+		expired = timer.C
+	}
+	select {
+	case record := <-c.in:
+		return copy(b, record), nil
+	case <-c.done:
+		return 0, io.EOF
+	case <-expired:
+		return 0, os.ErrDeadlineExceeded
+	}
+}
+
+func (c *dtlsConn) Write(b []byte) (int, error) {
+	select {
+	case <-c.done:
+		return 0, net.ErrClosed
+	default:
+	}
+	return c.conn.WriteToUDP(b, c.remote)
+}
+
+// Close ends the reads of the connection, the peer socket stays open
+func (c *dtlsConn) Close() error {
+	c.once.Do(func() { close(c.done) })
+	return nil
+}
+
+func (c *dtlsConn) LocalAddr() net.Addr {
+	return c.conn.LocalAddr()
+}
+
+func (c *dtlsConn) RemoteAddr() net.Addr {
+	return c.remote
+}
+
+func (c *dtlsConn) SetDeadline(t time.Time) error {
+	return c.SetReadDeadline(t)
+}
+
+func (c *dtlsConn) SetReadDeadline(t time.Time) error {
+	c.mu.Lock()
+	c.deadline = t
+	c.mu.Unlock()
+	return nil
+}
+
+// SetWriteDeadline has no effect, datagrams are written without blocking
+func (c *dtlsConn) SetWriteDeadline(t time.Time) error {
+	return nil
+}
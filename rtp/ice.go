@@ -0,0 +1,131 @@
+package rtp
+
+import (
+	"crypto/hmac"
+	"crypto/sha1"
+	"encoding/binary"
+	"hash"
+	"hash/crc32"
+	"net"
+	"strings"
+)
+
+// STUN (RFC 5389) values used by ICE connectivity checks (RFC 8445)
+const (
+	stunHeaderSize     = 20
+	stunMagicCookie    = 0x2112A442
+	stunBindingRequest = 0x0001
+	stunBindingSuccess = 0x0101
+
+	stunAttrUsername         = 0x0006
+	stunAttrMessageIntegrity = 0x0008
+	stunAttrXORMappedAddress = 0x0020
+	stunAttrUseCandidate     = 0x0025
+	stunAttrFingerprint      = 0x8028
+
+	stunFingerprintXOR = 0x5354554E
+)
+
+// iceLite answers the connectivity checks of a full ICE agent (i.e. a browser) as an ICE lite
+// agent (RFC 8445, section 2.5): its only candidate is the host address of the peer socket,
+// it sends no check of its own, and it uses the pair the remote agent nominates.
+type iceLite struct {
+	ufrag string
+	auth  hash.Hash // HMAC-SHA1 keyed with the local password (short-term credential)
+	mac   [sha1.Size]byte
+}
+
+func newICELite(ufrag, password string) *iceLite {
+	return &iceLite{ufrag: ufrag, auth: hmac.New(sha1.New, []byte(password))}
+}
+
+// answer appends to dst[:0] the success response to the binding request req received
+// from addr, and returns it along with whether the request nominates the pair
+// (USE-CANDIDATE). It returns a nil response for requests that are not valid binding
+// requests for the local credentials, which are dropped.
+func (ice *iceLite) answer(dst, req []byte, addr *net.UDPAddr) ([]byte, bool) {
+	if len(req) < stunHeaderSize || binary.BigEndian.Uint16(req) != stunBindingRequest ||
+		binary.BigEndian.Uint32(req[4:]) != stunMagicCookie ||
+		int(binary.BigEndian.Uint16(req[2:]))+stunHeaderSize != len(req) {
+		return nil, false
+	}
+	var username, integrity []byte
+	integrityAt, nominated := -1, false
+	for off := stunHeaderSize; off+4 <= len(req); {
+		attr, size := binary.BigEndian.Uint16(req[off:]), int(binary.BigEndian.Uint16(req[off+2:]))
+		if off+4+size > len(req) {
+			return nil, false
+		}
+		value := req[off+4 : off+4+size]
+		switch {
+		case attr == stunAttrFingerprint:
+			if size != 4 || crc32.ChecksumIEEE(req[:off])^stunFingerprintXOR != binary.BigEndian.Uint32(value) {
+				return nil, false
+			}
+		case integrityAt >= 0:
+			// other attributes following the message integrity are ignored
+		case attr == stunAttrUsername:
+			username = value
+		case attr == stunAttrMessageIntegrity:
+			integrity, integrityAt = value, off
+		case attr == stunAttrUseCandidate:
+			nominated = true
+		}
+		off += 4 + (size+3)&^3
+	}
+	// USERNAME is "local ufrag:remote ufrag"
+	if integrityAt < 0 || !strings.HasPrefix(string(username), ice.ufrag+":") ||
+		!hmac.Equal(ice.integrity(req[:integrityAt]), integrity) {
+		return nil, false
+	}
+
+	resp := append(dst[:0], 0, 0, 0, 0)
+	binary.BigEndian.PutUint16(resp, stunBindingSuccess)
+	resp = append(resp, req[4:stunHeaderSize]...) // magic cookie and transaction id
+	resp = appendXORMappedAddress(resp, addr)
+	resp = appendAttr(resp, stunAttrMessageIntegrity, ice.integrity(resp))
+	var fingerprint [4]byte
+	binary.BigEndian.PutUint32(fingerprint[:], crc32.ChecksumIEEE(withLength(resp, 8))^stunFingerprintXOR)
+	resp = appendAttr(resp, stunAttrFingerprint, fingerprint[:])
+	return resp, nominated
+}
+
+// integrity returns the MESSAGE-INTEGRITY value of msg (the message up to the attribute),
+// computed with the header length counting the attribute (the length field of msg is set)
+func (ice *iceLite) integrity(msg []byte) []byte {
+	ice.auth.Reset()
+	ice.auth.Write(withLength(msg, 4+sha1.Size)[:stunHeaderSize])
+	ice.auth.Write(msg[stunHeaderSize:])
+	return ice.auth.Sum(ice.mac[:0])
+}
+
+// withLength sets the length field of the STUN message msg as if extra attribute bytes
+// followed it, and returns msg
+func withLength(msg []byte, extra int) []byte {
+	binary.BigEndian.PutUint16(msg[2:], uint16(len(msg)-stunHeaderSize+extra))
+	return msg
+}
+
+func appendAttr(msg []byte, attr uint16, value []byte) []byte {
+	msg = append(msg, byte(attr>>8), byte(attr), byte(len(value)>>8), byte(len(value)))
+	msg = append(msg, value...)
+	for len(msg)%4 != 0 {
+		msg = append(msg, 0)
+	}
+	return withLength(msg, 0)
+}
+
+// appendXORMappedAddress appends the XOR-MAPPED-ADDRESS attribute of addr
+func appendXORMappedAddress(msg []byte, addr *net.UDPAddr) []byte {
+	value := []byte{0, 1, 0, 0}
+	ip := addr.IP.To4()
+	if ip == nil {
+		value[1], ip = 2, addr.IP.To16()
+	}
+	binary.BigEndian.PutUint16(value[2:], uint16(addr.Port)^stunMagicCookie>>16)
+	// the address is xored with the magic cookie and (IPv6) the transaction id
+	for i, b := range ip {
+		value = append(value, b^msg[4+i])
+	}
+	return appendAttr(msg, stunAttrXORMappedAddress, value)
+}
@@ -0,0 +1,105 @@
+package rtp
+
+import (
+	"encoding/binary"
+
+	"github.com/vladimirvivien/go4vl/h264"
+)
+
+const (
+	// HeaderSize is the size of the RTP header (without CSRC or extensions)
+	HeaderSize = 12
+
+	// DefaultMTU is the default maximum size of RTP packets, which leaves room for the
+	// IP/UDP headers (and SRTP overhead) within common path MTUs
+	DefaultMTU = 1200
+
+	// ClockRate is the RTP clock rate of video payloads
+	ClockRate = 90000
+
+	fuA = 28 // FU-A fragmentation unit (RFC 6184, section 5.8)
+)
+
+// Packet is an RTP packet. The payload references the NAL unit it carries (it is not a
+// copy): the packet is sent as its header followed by its payload, with a vectored write.
+type Packet struct {
+	header  [HeaderSize + 2]byte // RTP header, followed by the FU indicator and header
+	n       int
+	Payload []byte
+}
+
+// Header returns the RTP header of the packet (including the FU-A bytes, if any)
+func (p *Packet) Header() []byte {
+	return p.header[:p.n]
+}
+
+// Packetizer splits H.264 access units into RTP packets
+type Packetizer struct {
+	SSRC        uint32
+	PayloadType uint8
+	MTU         int
+
+	seq uint16
+}
+
+// Packetize appends to dst the packets of the access unit made of nals (see
+// h264.SplitNALUnits), captured at ts (in ClockRate units). NAL units that fit in one
+// packet are sent as is, larger units are split into FU-A fragments. Access unit
+// delimiters are dropped, and the marker bit is set on the last packet.
+func (z *Packetizer) Packetize(dst []Packet, nals [][]byte, ts uint32) []Packet {
+	mtu := z.MTU
+	if mtu == 0 {
+		mtu = DefaultMTU
+	}
+	first := len(dst)
+	for _, nal := range nals {
+		if len(nal) == 0 || h264.Type(nal) == h264.NALAccessUnit {
+			continue
+		}
+		if HeaderSize+len(nal) <= mtu {
+			dst = append(dst, Packet{})
+			p := z.fill(&dst[len(dst)-1], ts)
+			p.Payload = nal
+			continue
+		}
+
+		// FU-A: the NAL header is spread into the FU indicator and FU header
+		indicator, nalType := nal[0]&0xE0|fuA, nal[0]&0x1F
+		chunk := mtu - HeaderSize - 2
+		for data := nal[1:]; len(data) > 0; {
+			size := chunk
+			if size > len(data) {
+				size = len(data)
+			}
+			fuHeader := nalType
+			if len(data) == len(nal)-1 {
+				fuHeader |= 0x80 // start
+			}
+			if size == len(data) {
+				fuHeader |= 0x40 // end
+			}
+			dst = append(dst, Packet{})
+			p := z.fill(&dst[len(dst)-1], ts)
+			p.header[p.n], p.header[p.n+1] = indicator, fuHeader
+			p.n += 2
+			p.Payload = data[:size]
+			data = data[size:]
+		}
+	}
+	if len(dst) > first {
+		dst[len(dst)-1].header[1] |= 0x80 // marker
+	}
+	return dst
+}
+
+// fill sets the RTP header of packet p
+func (z *Packetizer) fill(p *Packet, ts uint32) *Packet {
+	p.header[0] = 0x80 // version 2
+	p.header[1] = z.PayloadType & 0x7F
+	binary.BigEndian.PutUint16(p.header[2:], z.seq)
+	binary.BigEndian.PutUint32(p.header[4:], ts)
+	binary.BigEndian.PutUint32(p.header[8:], z.SSRC)
+	p.n = HeaderSize
+	z.seq++
+	return p
+}
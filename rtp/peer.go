@@ -0,0 +1,496 @@
+package rtp
+
+import (
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"math/rand"
+	"net"
+	"sync"
+	"sync/atomic"
+	"syscall"
+	"time"
+	"unsafe"
+
+	"github.com/vladimirvivien/go4vl/h264"
+)
+
+type config struct {
+	payloadType uint8
+	mtu         int
+	bitrate     int
+	keyFrame    func()
+	keyInterval time.Duration
+	lossReport  func(loss float64)
+	iceUfrag    string
+	icePassword string
+	dtls        DTLSHandshake
+}
+
+type Option func(*config)
+
+// WithPayloadType sets the dynamic RTP payload type negotiated for H.264 (96 by default)
+func WithPayloadType(pt uint8) Option {
+	return func(o *config) {
+		o.payloadType = pt
+	}
+}
+
+// WithMTU sets the maximum size of RTP packets (DefaultMTU by default)
+func WithMTU(mtu int) Option {
+	return func(o *config) {
+		o.mtu = mtu
+	}
+}
+
+// WithPacing spreads the packets sent to the peer at the specified rate (in bits per
+// second), instead of bursting each frame. It should be set above the encoder bitrate
+// (i.e. 1.5 times), so that key frames do not fall behind.
+func WithPacing(bitrate int) Option {
+	return func(o *config) {
+		o.bitrate = bitrate
+	}
+}
+
+// WithKeyFrameRequest sets the function called when the peer reports a picture loss
+// (RTCP PLI or FIR), i.e. device.Device.RequestKeyFrame of the encoder. Requests are
+// coalesced to at most one per interval.
+func WithKeyFrameRequest(request func(), interval time.Duration) Option {
+	return func(o *config) {
+		o.keyFrame = request
+		o.keyInterval = interval
+	}
+}
+
+// WithLossReport sets the function called with the fraction of packets lost by the
+// peer (0 to 1) for each RTCP receiver report, i.e. to feed a device.BitrateController.
+func WithLossReport(report func(loss float64)) Option {
+	return func(o *config) {
+		o.lossReport = report
+	}
+}
+
+// WithICELite sets the ICE credentials (ice-ufrag and ice-pwd of the local session
+// description) with which a peer created with Listen answers connectivity checks
+func WithICELite(ufrag, password string) Option {
+	return func(o *config) {
+		o.iceUfrag = ufrag
+		o.icePassword = password
+	}
+}
+
+// DTLSHandshake runs a DTLS-SRTP handshake (RFC 5764) over conn, which carries the DTLS
+// records exchanged with the remote peer, and returns the SRTP keys it negotiated for the
+// AES_CM_128_HMAC_SHA1_80 profile (see SRTPKeysFromDTLS). The standard library has no DTLS
+// implementation: the handshake is provided by the application, i.e. with
+// github.com/pion/dtls, using the certificate advertised in its session description.
+type DTLSHandshake func(conn net.Conn) (SRTPKeys, error)
+
+// WithDTLS sets the DTLS handshake establishing the SRTP keys of a peer created with
+// Listen. Without it, media is sent as plain RTP once the ICE pair is nominated.
+func WithDTLS(handshake DTLSHandshake) Option {
+	return func(o *config) {
+		o.dtls = handshake
+	}
+}
+
+// session states of a peer
+const (
+	peerWaiting     int32 = iota // for a nominated ICE pair
+	peerConnecting               // DTLS handshake in progress
+	peerEstablished              // media flowing
+)
+
+// Peer sends an H.264 stream to a remote peer over UDP, and reads the RTCP feedback the
+// peer sends back on the same port.
+type Peer struct {
+	config     config
+	conn       *net.UDPConn
+	raw        syscall.RawConn
+	packetizer Packetizer
+	packets    []Packet
+	nals       [][]byte
+	pace       pacer
+
+	mu          sync.Mutex
+	lastRequest time.Time
+
+	// listening peers (see Listen): remote and srtp are set before the session is
+	// established, and read once it is
+	ice         *iceLite
+	state       int32
+	established chan struct{}
+	remote      *net.UDPAddr
+	srtp        *srtpSession
+	sealed      []byte
+	dtls        *dtlsConn       // owned by the read loop
+	checked     map[string]bool // addresses that passed a connectivity check
+}
+
+// Dial connects a peer to the remote address (host:port) from a local UDP port. Media is
+// sent as plain RTP right away, without ICE nor SRTP.
+func Dial(address string, opts ...Option) (*Peer, error) {
+	raddr, err := net.ResolveUDPAddr("udp", address)
+	if err != nil {
+		return nil, fmt.Errorf("rtp: dial: %w", err)
+	}
+	conn, err := net.DialUDP("udp", nil, raddr)
+	if err != nil {
+		return nil, fmt.Errorf("rtp: dial: %w", err)
+	}
+	p, err := newPeer(conn, opts)
+	if err != nil {
+		return nil, fmt.Errorf("rtp: dial: %w", err)
+	}
+	p.state = peerEstablished
+	close(p.established)
+	go p.readLoop()
+	return p, nil
+}
+
+// Listen returns a peer waiting on a local UDP address (host:port) for a remote WebRTC
+// agent (i.e. a browser), as the sendonly video end of its session. The peer is an ICE lite
+// agent with a single host candidate, the local address: it answers the connectivity
+// checks of the remote agent (see WithICELite), and sends media to the address of the pair
+// the remote agent nominates, protected with SRTP once the DTLS handshake (see WithDTLS)
+// established the keys. STUN, DTLS, RTP and RTCP share the port (RFC 7983).
+//
+// The offer/answer exchange is left to the application. Its answer advertises a=ice-lite,
+// the ICE credentials, the certificate fingerprint of its DTLS layer, the H.264 payload
+// type (see WithPayloadType), and a host candidate for LocalAddr. Frames written before
+// the session is established are dropped (see Established).
+func Listen(address string, opts ...Option) (*Peer, error) {
+	laddr, err := net.ResolveUDPAddr("udp", address)
+	if err != nil {
+		return nil, fmt.Errorf("rtp: listen: %w", err)
+	}
+	conn, err := net.ListenUDP("udp", laddr)
+	if err != nil {
+		return nil, fmt.Errorf("rtp: listen: %w", err)
+	}
+	p, err := newPeer(conn, opts)
+	if err != nil {
+		return nil, fmt.Errorf("rtp: listen: %w", err)
+	}
+	if p.config.iceUfrag == "" || p.config.icePassword == "" {
+		conn.Close()
+		return nil, fmt.Errorf("rtp: listen: ICE credentials required (see WithICELite)")
+	}
+	p.ice = newICELite(p.config.iceUfrag, p.config.icePassword)
+	p.checked = make(map[string]bool)
+	go p.readLoop()
+	return p, nil
+}
+
+func newPeer(conn *net.UDPConn, opts []Option) (*Peer, error) {
+	cfg := config{payloadType: 96, mtu: DefaultMTU, keyInterval: 500 * time.Millisecond}
+	for _, o := range opts {
+		o(&cfg)
+	}
+	raw, err := conn.SyscallConn()
+	if err != nil {
+		conn.Close()
+		return nil, err
+	}
+	return &Peer{
+		config: cfg,
+		conn:   conn,
+		raw:    raw,
+		packetizer: Packetizer{
+			SSRC:        rand.Uint32(),
+			PayloadType: cfg.payloadType,
+			MTU:         cfg.mtu,
+		},
+		pace:        pacer{bitrate: cfg.bitrate},
+		established: make(chan struct{}),
+	}, nil
+}
+
+// LocalAddr returns the local address of the peer socket (where it receives RTCP)
+func (p *Peer) LocalAddr() net.Addr {
+	return p.conn.LocalAddr()
+}
+
+// SSRC returns the synchronization source identifier of the stream
+func (p *Peer) SSRC() uint32 {
+	return p.packetizer.SSRC
+}
+
+// Close closes the peer socket
+func (p *Peer) Close() error {
+	return p.conn.Close()
+}
+
+// Established returns a channel closed once the session is established: right away for
+// peers created with Dial, after ICE and DTLS for peers created with Listen
+func (p *Peer) Established() <-chan struct{} {
+	return p.established
+}
+
+// WriteFrame sends an H.264 access unit (Annex B, as produced by capture devices and
+// encoders) captured at timestamp. The data is sent without being copied (except to be
+// encrypted, with SRTP); it may be reused once WriteFrame returns. Frames written before
+// the session is established are dropped. WriteFrame must not be called concurrently.
+func (p *Peer) WriteFrame(data []byte, timestamp time.Duration) error {
+	if atomic.LoadInt32(&p.state) != peerEstablished {
+		return nil
+	}
+	p.nals = h264.SplitNALUnits(p.nals[:0], data)
+	return p.writeNALUnits(timestamp)
+}
+
+// WriteIndexedFrame is like WriteFrame for an access unit already indexed (i.e. the
+// NALs of a device.Frame), which is not scanned again.
+func (p *Peer) WriteIndexedFrame(data []byte, index *h264.Index, timestamp time.Duration) error {
+	if atomic.LoadInt32(&p.state) != peerEstablished {
+		return nil
+	}
+	p.nals = index.NALUnits(p.nals[:0], data)
+	return p.writeNALUnits(timestamp)
+}
+
+func (p *Peer) writeNALUnits(timestamp time.Duration) error {
+	ts := uint32(uint64(timestamp/time.Microsecond) * ClockRate / 1000000)
+	p.packets = p.packetizer.Packetize(p.packets[:0], p.nals, ts)
+	for i := range p.packets {
+		packet := &p.packets[i]
+		p.pace.wait(len(packet.Header()) + len(packet.Payload))
+		if err := p.write(packet); err != nil {
+			return fmt.Errorf("rtp: write: %w", err)
+		}
+	}
+	return nil
+}
+
+// write sends packet to the remote peer: gathered from its header and payload on the
+// connected socket of a dialed peer, or from a copy (encrypted with SRTP) otherwise
+func (p *Peer) write(packet *Packet) error {
+	switch {
+	case p.remote == nil:
+		return p.send(packet.Header(), packet.Payload)
+	case p.srtp != nil:
+		p.sealed = p.srtp.protectRTP(p.sealed, packet.Header(), packet.Payload)
+	default:
+		p.sealed = append(append(p.sealed[:0], packet.Header()...), packet.Payload...)
+	}
+	_, err := p.conn.WriteToUDP(p.sealed, p.remote)
+	return err
+}
+
+// send writes a datagram gathered from header and payload (sendmsg with two iovecs),
+// which spares copying the payload into a packet buffer.
+func (p *Peer) send(header, payload []byte) error {
+	var iov [2]syscall.Iovec
+	iov[0].Base = &header[0]
+	iov[0].SetLen(len(header))
+	iov[1].Base = &payload[0]
+	iov[1].SetLen(len(payload))
+	var msg syscall.Msghdr
+	msg.Iov = &iov[0]
+	msg.Iovlen = 2
+
+	var errno syscall.Errno
+	err := p.raw.Write(func(fd uintptr) bool {
+		_, _, errno = syscall.Syscall(syscall.SYS_SENDMSG, fd, uintptr(unsafe.Pointer(&msg)), 0)
+		return errno != syscall.EAGAIN
+	})
+	if err != nil {
+		return err
+	}
+	if errno != 0 {
+		return errno
+	}
+	return nil
+}
+
+// readLoop reads the packets sent by the remote peer until the socket is closed. Packets
+// are told apart by their first byte (RFC 7983): STUN connectivity checks are answered,
+// DTLS records handed to the handshake, and RTCP feedback processed.
+func (p *Peer) readLoop() {
+	buf := make([]byte, 1500)
+	var resp []byte
+	defer func() {
+		if p.dtls != nil {
+			p.dtls.Close()
+		}
+	}()
+	for {
+		n, addr, err := p.conn.ReadFromUDP(buf)
+		if err != nil {
+			var netErr net.Error
+			if errors.As(err, &netErr) && netErr.Temporary() {
+				continue
+			}
+			return // closed
+		}
+		packet := buf[:n]
+		switch {
+		case n == 0 || p.ice == nil && packet[0] < 128:
+		case packet[0] < 4: // STUN
+			var nominated bool
+			if resp, nominated = p.ice.answer(resp, packet, addr); resp == nil {
+				continue
+			}
+			p.conn.WriteToUDP(resp, addr)
+			p.checked[addr.String()] = true
+			if nominated {
+				p.nominate(addr)
+			}
+		case packet[0] >= 20 && packet[0] < 64: // DTLS
+			// the remote agent may start the handshake on a pair it checked before nominating it
+			if p.checked[addr.String()] {
+				p.nominate(addr)
+			}
+			if p.dtls != nil && sameAddr(addr, p.dtls.remote) {
+				p.dtls.deliver(packet)
+			}
+		case packet[0] >= 128 && packet[0] < 192: // RTP and RTCP (rtcp-mux)
+			if atomic.LoadInt32(&p.state) != peerEstablished || p.remote != nil && !sameAddr(addr, p.remote) {
+				continue
+			}
+			if p.srtp != nil {
+				if packet, err = p.srtp.unprotectRTCP(packet); err != nil {
+					continue
+				}
+			}
+			p.feedback(packet)
+		}
+	}
+}
+
+// feedback processes a compound RTCP packet received from the peer
+func (p *Peer) feedback(packet []byte) {
+	pictureLoss, loss := parseFeedback(packet, p.packetizer.SSRC)
+	if pictureLoss {
+		p.requestKeyFrame()
+	}
+	if loss >= 0 && p.config.lossReport != nil {
+		p.config.lossReport(loss)
+	}
+}
+
+// nominate selects the candidate pair of the remote address addr, and starts the DTLS
+// handshake of the session. Only the first nominated pair is used, unless the handshake
+// fails. It is called by the read loop.
+func (p *Peer) nominate(addr *net.UDPAddr) {
+	if !atomic.CompareAndSwapInt32(&p.state, peerWaiting, peerConnecting) {
+		return
+	}
+	if p.config.dtls == nil {
+		p.establish(addr, nil)
+		return
+	}
+	if p.dtls != nil {
+		p.dtls.Close()
+	}
+	p.dtls = newDTLSConn(p.conn, addr)
+	go func(conn *dtlsConn) {
+		keys, err := p.config.dtls(conn)
+		var session *srtpSession
+		if err == nil {
+			session, err = newSRTPSession(keys)
+		}
+		if err != nil {
+			// wait for the remote agent to try again
+			conn.Close()
+			atomic.StoreInt32(&p.state, peerWaiting)
+			return
+		}
+		p.establish(addr, session)
+	}(p.dtls)
+}
+
+// establish starts sending media to addr, protected by session (when not nil)
+func (p *Peer) establish(addr *net.UDPAddr, session *srtpSession) {
+	p.remote, p.srtp = addr, session
+	atomic.StoreInt32(&p.state, peerEstablished)
+	close(p.established)
+	// the remote decoder can only start with a key frame
+	p.requestKeyFrame()
+}
+
+func sameAddr(a, b *net.UDPAddr) bool {
+	return a.Port == b.Port && a.IP.Equal(b.IP)
+}
+
+func (p *Peer) requestKeyFrame() {
+	if p.config.keyFrame == nil {
+		return
+	}
+	p.mu.Lock()
+	now := time.Now()
+	due := now.Sub(p.lastRequest) >= p.config.keyInterval
+	if due {
+		p.lastRequest = now
+	}
+	p.mu.Unlock()
+	if due {
+		p.config.keyFrame()
+	}
+}
+
+// RTCP packet types (RFC 3550) and payload feedback formats (RFC 4585, RFC 5104)
+const (
+	rtcpSR   = 200
+	rtcpRR   = 201
+	rtcpPSFB = 206
+	fmtPLI   = 1
+	fmtFIR   = 4
+)
+
+// parseFeedback reads a compound RTCP packet, and reports whether it holds a picture loss
+// indication or a full intra request, and the fraction of packets lost from the report
+// block about ssrc (-1 when there is none).
+func parseFeedback(data []byte, ssrc uint32) (pictureLoss bool, loss float64) {
+	loss = -1
+	for len(data) >= 4 {
+		if data[0]>>6 != 2 {
+			break
+		}
+		length := (int(binary.BigEndian.Uint16(data[2:])) + 1) * 4
+		if length > len(data) {
+			break
+		}
+		count, packetType := int(data[0]&0x1F), data[1]
+		switch packetType {
+		case rtcpPSFB:
+			pictureLoss = pictureLoss || count == fmtPLI || count == fmtFIR
+		case rtcpSR, rtcpRR:
+			// report blocks (24 bytes) follow the sender ssrc (and sender info of SRs)
+			offset := 8
+			if packetType == rtcpSR {
+				offset = 28
+			}
+			for i := 0; i < count && offset+24 <= length; i++ {
+				if binary.BigEndian.Uint32(data[offset:]) == ssrc {
+					loss = float64(data[offset+4]) / 256
+				}
+				offset += 24
+			}
+		}
+		data = data[length:]
+	}
+	return pictureLoss, loss
+}
+
+// pacer spaces packets to send them at a given bitrate
+type pacer struct {
+	bitrate int
+	next    time.Time
+}
+
+// wait blocks until a packet of size bytes can be sent. Short delays are accumulated
+// instead of slept, since sleeps are not precise below a millisecond.
+func (p *pacer) wait(size int) {
+	if p.bitrate <= 0 {
+		return
+	}
+	now := time.Now()
+	if p.next.Before(now) {
+		p.next = now
+	}
+	if ahead := p.next.Sub(now); ahead > time.Millisecond {
+		time.Sleep(ahead)
+	}
+	p.next = p.next.Add(time.Duration(size) * 8 * time.Second / time.Duration(p.bitrate))
+}
@@ -0,0 +1,276 @@
+package rtp
+
+import (
+	"bytes"
+	"crypto/hmac"
+	"crypto/sha1"
+	"encoding/binary"
+	"hash/crc32"
+	"net"
+	"testing"
+	"time"
+)
+
+// depacketize rebuilds the NAL units of an access unit from its RTP packets
+func depacketize(t *testing.T, conn *net.UDPConn) (nals [][]byte, ts uint32) {
+	buf := make([]byte, 2048)
+	var fu []byte
+	for {
+		conn.SetReadDeadline(time.Now().Add(time.Second))
+		n, err := conn.Read(buf)
+		if err != nil {
+			t.Fatal(err)
+		}
+		if n > DefaultMTU {
+			t.Fatalf("packet of %d bytes exceeds MTU", n)
+		}
+		packet := buf[:n]
+		ts = binary.BigEndian.Uint32(packet[4:])
+		payload := packet[HeaderSize:]
+		if payload[0]&0x1F == fuA {
+			if payload[1]&0x80 != 0 {
+				fu = []byte{payload[0]&0xE0 | payload[1]&0x1F}
+			}
+			fu = append(fu, payload[2:]...)
+			if payload[1]&0x40 != 0 {
+				nals = append(nals, fu)
+			}
+		} else {
+			nals = append(nals, append([]byte(nil), payload...))
+		}
+		if packet[1]&0x80 != 0 { // marker
+			return nals, ts
+		}
+	}
+}
+
+func TestPeerLoopback(t *testing.T) {
+	remote, err := net.ListenUDP("udp", &net.UDPAddr{IP: net.IPv4(127, 0, 0, 1)})
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer remote.Close()
+
+	requests := make(chan struct{}, 4)
+	peer, err := Dial(remote.LocalAddr().String(), WithPacing(50000000), WithKeyFrameRequest(func() {
+		requests <- struct{}{}
+	}, time.Second))
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer peer.Close()
+
+	sps := []byte{0x67, 0x42, 0xC0, 0x1F, 0xDA}
+	pps := []byte{0x68, 0xCE, 0x3C, 0x80}
+	idr := make([]byte, 5000)
+	for i := range idr {
+		idr[i] = byte(i%250 + 1)
+	}
+	idr[0] = 0x65
+	var frame []byte
+	for _, nal := range [][]byte{{0x09, 0xF0}, sps, pps, idr} {
+		frame = append(append(frame, 0, 0, 0, 1), nal...)
+	}
+
+	if err := peer.WriteFrame(frame, 2*time.Second); err != nil {
+		t.Fatal(err)
+	}
+	nals, ts := depacketize(t, remote)
+	if ts != 2*ClockRate {
+		t.Errorf("timestamp %d, want %d", ts, 2*ClockRate)
+	}
+	want := [][]byte{sps, pps, idr}
+	if len(nals) != len(want) {
+		t.Fatalf("got %d NAL units, want %d", len(nals), len(want))
+	}
+	for i := range want {
+		if !bytes.Equal(nals[i], want[i]) {
+			t.Fatalf("NAL unit %d differs", i)
+		}
+	}
+
+	// picture loss indication, sent twice: only one key frame request is expected
+	pli := []byte{0x80 | fmtPLI, rtcpPSFB, 0, 2, 0, 0, 0, 1, 0, 0, 0, 0}
+	binary.BigEndian.PutUint32(pli[8:], peer.SSRC())
+	for i := 0; i < 2; i++ {
+		if _, err := remote.WriteTo(pli, peer.LocalAddr()); err != nil {
+			t.Fatal(err)
+		}
+	}
+	select {
+	case <-requests:
+	case <-time.After(time.Second):
+		t.Fatal("key frame not requested")
+	}
+	select {
+	case <-requests:
+		t.Fatal("key frame requests not coalesced")
+	case <-time.After(100 * time.Millisecond):
+	}
+}
+
+// testBindingRequest returns a binding request from the remote agent, signed with password
+func testBindingRequest(username, password string, nominate bool) []byte {
+	req := []byte{0, 1, 0, 0, 0x21, 0x12, 0xA4, 0x42, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12}
+	attr := func(t uint16, v []byte) {
+		req = append(req, byte(t>>8), byte(t), byte(len(v)>>8), byte(len(v)))
+		req = append(req, v...)
+		for len(req)%4 != 0 {
+			req = append(req, 0)
+		}
+	}
+	attr(0x0006, []byte(username))
+	if nominate {
+		attr(0x0025, nil)
+	}
+	binary.BigEndian.PutUint16(req[2:], uint16(len(req)-20+24))
+	mac := hmac.New(sha1.New, []byte(password))
+	mac.Write(req)
+	attr(0x0008, mac.Sum(nil))
+	binary.BigEndian.PutUint16(req[2:], uint16(len(req)-20+8))
+	fingerprint := make([]byte, 4)
+	binary.BigEndian.PutUint32(fingerprint, crc32.ChecksumIEEE(req)^0x5354554E)
+	attr(0x8028, fingerprint)
+	return req
+}
+
+// testCheckResponse validates a binding success response to req received by addr
+func testCheckResponse(t *testing.T, resp, req []byte, password string, addr *net.UDPAddr) {
+	if len(resp) < 20 || binary.BigEndian.Uint16(resp) != 0x0101 || !bytes.Equal(resp[4:20], req[4:20]) {
+		t.Fatalf("not a binding success response: %X", resp)
+	}
+	var mapped *net.UDPAddr
+	for off := 20; off+4 <= len(resp); {
+		attr, size := binary.BigEndian.Uint16(resp[off:]), int(binary.BigEndian.Uint16(resp[off+2:]))
+		value := resp[off+4 : off+4+size]
+		switch attr {
+		case 0x0020:
+			ip := make(net.IP, 4)
+			for i := range ip {
+				ip[i] = value[4+i] ^ resp[4+i]
+			}
+			mapped = &net.UDPAddr{IP: ip, Port: int(binary.BigEndian.Uint16(value[2:]) ^ 0x2112)}
+		case 0x0008:
+			msg := append([]byte(nil), resp[:off]...)
+			binary.BigEndian.PutUint16(msg[2:], uint16(off-20+24))
+			mac := hmac.New(sha1.New, []byte(password))
+			mac.Write(msg)
+			if !bytes.Equal(mac.Sum(nil), value) {
+				t.Error("invalid message integrity")
+			}
+		case 0x8028:
+			if crc32.ChecksumIEEE(resp[:off])^0x5354554E != binary.BigEndian.Uint32(value) {
+				t.Error("invalid fingerprint")
+			}
+		}
+		off += 4 + (size+3)&^3
+	}
+	if mapped == nil || !sameAddr(mapped, addr) {
+		t.Errorf("mapped address %v, want %v", mapped, addr)
+	}
+}
+
+func TestPeerListen(t *testing.T) {
+	browser, err := net.ListenUDP("udp", &net.UDPAddr{IP: net.IPv4(127, 0, 0, 1)})
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer browser.Close()
+
+	// DTLS handshake stand-in: one record each way, then the keys
+	keys := testSRTPKeys()
+	handshake := func(conn net.Conn) (SRTPKeys, error) {
+		buf := make([]byte, 1500)
+		n, err := conn.Read(buf)
+		if err != nil {
+			return SRTPKeys{}, err
+		}
+		if _, err := conn.Write(buf[:n]); err != nil {
+			return SRTPKeys{}, err
+		}
+		return keys, nil
+	}
+	requests := make(chan struct{}, 4)
+	peer, err := Listen("127.0.0.1:0", WithICELite("lite", "lite-password-0123456789"), WithDTLS(handshake),
+		WithKeyFrameRequest(func() { requests <- struct{}{} }, 0))
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer peer.Close()
+
+	read := func() []byte {
+		buf := make([]byte, 1500)
+		browser.SetReadDeadline(time.Now().Add(time.Second))
+		n, err := browser.Read(buf)
+		if err != nil {
+			t.Fatal(err)
+		}
+		return buf[:n]
+	}
+
+	// checks with invalid credentials are dropped
+	if _, err := browser.WriteTo(testBindingRequest("lite:browser", "wrong", true), peer.LocalAddr()); err != nil {
+		t.Fatal(err)
+	}
+	req := testBindingRequest("lite:browser", "lite-password-0123456789", true)
+	if _, err := browser.WriteTo(req, peer.LocalAddr()); err != nil {
+		t.Fatal(err)
+	}
+	testCheckResponse(t, read(), req, "lite-password-0123456789", browser.LocalAddr().(*net.UDPAddr))
+
+	// frames written before the session is established are dropped
+	frame := append([]byte{0, 0, 0, 1, 0x65}, bytes.Repeat([]byte{0x42}, 3000)...)
+	if err := peer.WriteFrame(frame, time.Second); err != nil {
+		t.Fatal(err)
+	}
+
+	record := []byte{22, 0xFE, 0xFD, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0xAA}
+	if _, err := browser.WriteTo(record, peer.LocalAddr()); err != nil {
+		t.Fatal(err)
+	}
+	if got := read(); !bytes.Equal(got, record) {
+		t.Fatalf("DTLS record %X, want %X", got, record)
+	}
+	select {
+	case <-peer.Established():
+	case <-time.After(time.Second):
+		t.Fatal("session not established")
+	}
+	select {
+	case <-requests:
+	case <-time.After(time.Second):
+		t.Fatal("no key frame requested for the new session")
+	}
+
+	// media is SRTP, sent to the nominated address
+	if err := peer.WriteFrame(frame, time.Second); err != nil {
+		t.Fatal(err)
+	}
+	var fu []byte
+	for fu == nil || len(fu) < len(frame)-4 {
+		packet := testUnprotectRTP(t, keys, read(), 0)
+		payload := packet[HeaderSize:]
+		if payload[0]&0x1F != fuA {
+			t.Fatalf("unexpected packet %X", payload[:2])
+		}
+		if payload[1]&0x80 != 0 {
+			fu = []byte{payload[0]&0xE0 | payload[1]&0x1F}
+		}
+		fu = append(fu, payload[2:]...)
+	}
+	if !bytes.Equal(fu, frame[4:]) {
+		t.Fatal("NAL unit differs")
+	}
+
+	// SRTCP feedback
+	pli := []byte{0x80 | fmtPLI, rtcpPSFB, 0, 2, 0, 0, 0, 1, 0, 0, 0, 0}
+	binary.BigEndian.PutUint32(pli[8:], peer.SSRC())
+	if _, err := browser.WriteTo(testProtectRTCP(t, keys, pli, 1), peer.LocalAddr()); err != nil {
+		t.Fatal(err)
+	}
+	select {
+	case <-requests:
+	case <-time.After(time.Second):
+		t.Fatal("key frame not requested")
+	}
+}
@@ -0,0 +1,179 @@
+package rtp
+
+import (
+	"crypto/aes"
+	"crypto/cipher"
+	"crypto/hmac"
+	"crypto/sha1"
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"hash"
+)
+
+// SRTP (RFC 3711) with the AES_CM_128_HMAC_SHA1_80 protection profile, which all WebRTC
+// endpoints implement: AES-128 counter mode encryption, and HMAC-SHA1 authentication tags
+// truncated to 80 bits.
+const (
+	srtpKeyLen     = 16
+	srtpSaltLen    = 14
+	srtpAuthKeyLen = 20
+	srtpTagLen     = 10
+	srtcpIndexLen  = 4
+
+	// key derivation labels (RFC 3711, section 4.3.2)
+	labelRTPEncryption  = 0
+	labelRTPAuth        = 1
+	labelRTPSalt        = 2
+	labelRTCPEncryption = 3
+	labelRTCPAuth       = 4
+	labelRTCPSalt       = 5
+)
+
+var errSRTPAuth = errors.New("srtp: authentication failed")
+
+// SRTPKeys are the master keys and salts of an SRTP session, for each direction
+type SRTPKeys struct {
+	LocalKey, LocalSalt   []byte // protect the packets sent
+	RemoteKey, RemoteSalt []byte // authenticate and decrypt the packets received
+}
+
+// SRTPKeysFromDTLS returns the session keys from the keying material exported by a
+// DTLS-SRTP handshake: 60 bytes exported with the label "EXTRACTOR-dtls_srtp" and no
+// context (RFC 5764, section 4.2). client tells whether the local end of the handshake was
+// the DTLS client.
+func SRTPKeysFromDTLS(material []byte, client bool) (SRTPKeys, error) {
+	if len(material) != 2*(srtpKeyLen+srtpSaltLen) {
+		return SRTPKeys{}, fmt.Errorf("srtp: %d bytes of keying material, want %d", len(material), 2*(srtpKeyLen+srtpSaltLen))
+	}
+	// client key, server key, client salt, server salt
+	clientKey, serverKey := material[:srtpKeyLen], material[srtpKeyLen:2*srtpKeyLen]
+	clientSalt, serverSalt := material[2*srtpKeyLen:2*srtpKeyLen+srtpSaltLen], material[2*srtpKeyLen+srtpSaltLen:]
+	if client {
+		return SRTPKeys{LocalKey: clientKey, LocalSalt: clientSalt, RemoteKey: serverKey, RemoteSalt: serverSalt}, nil
+	}
+	return SRTPKeys{LocalKey: serverKey, LocalSalt: serverSalt, RemoteKey: clientKey, RemoteSalt: clientSalt}, nil
+}
+
+// srtpContext holds the session keys of one direction of RTP or RTCP packets
+type srtpContext struct {
+	block cipher.Block
+	salt  [srtpSaltLen]byte
+	auth  hash.Hash
+	mac   [sha1.Size]byte
+}
+
+// newSRTPContext derives the session keys of RTP (or RTCP) packets from a master key and salt
+func newSRTPContext(masterKey, masterSalt []byte, rtcp bool) (*srtpContext, error) {
+	if len(masterKey) != srtpKeyLen || len(masterSalt) != srtpSaltLen {
+		return nil, fmt.Errorf("srtp: invalid master key or salt size")
+	}
+	master, err := aes.NewCipher(masterKey)
+	if err != nil {
+		return nil, fmt.Errorf("srtp: %w", err)
+	}
+	labels := [3]byte{labelRTPEncryption, labelRTPAuth, labelRTPSalt}
+	if rtcp {
+		labels = [3]byte{labelRTCPEncryption, labelRTCPAuth, labelRTCPSalt}
+	}
+	c := &srtpContext{}
+	if c.block, err = aes.NewCipher(deriveKey(master, masterSalt, labels[0], srtpKeyLen)); err != nil {
+		return nil, fmt.Errorf("srtp: %w", err)
+	}
+	c.auth = hmac.New(sha1.New, deriveKey(master, masterSalt, labels[1], srtpAuthKeyLen))
+	copy(c.salt[:], deriveKey(master, masterSalt, labels[2], srtpSaltLen))
+	return c, nil
+}
+
+// deriveKey derives the n bytes session key of label from the master key and salt, with a
+// key derivation rate of 0 (RFC 3711, section 4.3.1)
+func deriveKey(master cipher.Block, masterSalt []byte, label byte, n int) []byte {
+	var iv [aes.BlockSize]byte
+	copy(iv[:], masterSalt)
+	iv[7] ^= label
+	key := make([]byte, n)
+	cipher.NewCTR(master, iv[:]).XORKeyStream(key, key)
+	return key
+}
+
+// xor encrypts (or decrypts) data in place, for the packet of ssrc and index
+// (RFC 3711, section 4.1.1)
+func (c *srtpContext) xor(data []byte, ssrc uint32, index uint64) {
+	var iv [aes.BlockSize]byte
+	copy(iv[:], c.salt[:])
+	for i := 0; i < 4; i++ {
+		iv[4+i] ^= byte(ssrc >> (24 - 8*i))
+	}
+	for i := 0; i < 6; i++ {
+		iv[8+i] ^= byte(index >> (40 - 8*i))
+	}
+	cipher.NewCTR(c.block, iv[:]).XORKeyStream(data, data)
+}
+
+// tag returns the authentication tag of data followed by the rollover counter roc (RTP)
+// or of data alone (RTCP, when roc is nil)
+func (c *srtpContext) tag(data, roc []byte) []byte {
+	c.auth.Reset()
+	c.auth.Write(data)
+	c.auth.Write(roc)
+	return c.auth.Sum(c.mac[:0])[:srtpTagLen]
+}
+
+// srtpSession protects the RTP packets sent, and authenticates and decrypts the RTCP
+// packets received. It is not safe for concurrent use, except that the RTP and RTCP
+// directions may be used concurrently.
+type srtpSession struct {
+	rtp  *srtpContext
+	rtcp *srtpContext
+
+	roc     uint32 // rollover counter of the RTP sequence numbers
+	lastSeq uint16
+	started bool
+}
+
+func newSRTPSession(keys SRTPKeys) (*srtpSession, error) {
+	rtp, err := newSRTPContext(keys.LocalKey, keys.LocalSalt, false)
+	if err != nil {
+		return nil, err
+	}
+	rtcp, err := newSRTPContext(keys.RemoteKey, keys.RemoteSalt, true)
+	if err != nil {
+		return nil, err
+	}
+	return &srtpSession{rtp: rtp, rtcp: rtcp}, nil
+}
+
+// protectRTP appends to dst[:0] the SRTP packet of an RTP packet made of header (the
+// fixed RTP header, possibly followed by payload bytes) and payload, and returns it
+func (s *srtpSession) protectRTP(dst, header, payload []byte) []byte {
+	seq := binary.BigEndian.Uint16(header[2:])
+	if s.started && seq < s.lastSeq {
+		s.roc++ // sequence numbers wrapped (packets are sent in order)
+	}
+	s.lastSeq, s.started = seq, true
+	index := uint64(s.roc)<<16 | uint64(seq)
+
+	dst = append(append(dst[:0], header...), payload...)
+	s.rtp.xor(dst[HeaderSize:], binary.BigEndian.Uint32(header[8:]), index)
+	var roc [4]byte
+	binary.BigEndian.PutUint32(roc[:], s.roc)
+	return append(dst, s.rtp.tag(dst, roc[:])...)
+}
+
+// unprotectRTCP authenticates and decrypts in place an SRTCP packet, and returns the
+// compound RTCP packet it holds (RFC 3711, section 3.4)
+func (s *srtpSession) unprotectRTCP(packet []byte) ([]byte, error) {
+	if len(packet) < 8+srtcpIndexLen+srtpTagLen {
+		return nil, errSRTPAuth
+	}
+	n := len(packet) - srtpTagLen
+	if !hmac.Equal(s.rtcp.tag(packet[:n], nil), packet[n:]) {
+		return nil, errSRTPAuth
+	}
+	index := binary.BigEndian.Uint32(packet[n-srtcpIndexLen:])
+	rtcp := packet[:n-srtcpIndexLen]
+	if index&(1<<31) != 0 { // E flag: encrypted
+		s.rtcp.xor(rtcp[8:], binary.BigEndian.Uint32(rtcp[4:]), uint64(index&^(1<<31)))
+	}
+	return rtcp, nil
+}
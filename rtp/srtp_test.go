@@ -0,0 +1,142 @@
+package rtp
+
+import (
+	"bytes"
+	"crypto/aes"
+	"crypto/cipher"
+	"crypto/hmac"
+	"crypto/sha1"
+	"encoding/binary"
+	"encoding/hex"
+	"testing"
+)
+
+func unhex(t *testing.T, s string) []byte {
+	b, err := hex.DecodeString(s)
+	if err != nil {
+		t.Fatal(err)
+	}
+	return b
+}
+
+// key derivation test vectors of RFC 3711, appendix B.3
+func TestSRTPKeyDerivation(t *testing.T) {
+	master, err := aes.NewCipher(unhex(t, "E1F97A0D3E018BE0D64FA32C06DE4139"))
+	if err != nil {
+		t.Fatal(err)
+	}
+	salt := unhex(t, "0EC675AD498AFEEBB6960B3AABE6")
+	tests := []struct {
+		label byte
+		want  string
+	}{
+		{labelRTPEncryption, "C61E7A93744F39EE10734AFE3FF7A087"},
+		{labelRTPSalt, "30CBBC08863D8C85D49DB34A9AE1"},
+		{labelRTPAuth, "CEBE321F6FF7716B6FD4AB49AF256A156D38BAA4"},
+	}
+	for _, test := range tests {
+		if got := deriveKey(master, salt, test.label, len(test.want)/2); !bytes.Equal(got, unhex(t, test.want)) {
+			t.Errorf("label %d: key %X, want %s", test.label, got, test.want)
+		}
+	}
+}
+
+// testSessionKeys returns the encryption key, salt and authentication key of the session
+// derived with labels (encryption, auth, salt) from a master key and salt
+func testSessionKeys(t *testing.T, key, salt []byte, labels [3]byte) (cipher.Block, []byte, []byte) {
+	master, err := aes.NewCipher(key)
+	if err != nil {
+		t.Fatal(err)
+	}
+	block, err := aes.NewCipher(deriveKey(master, salt, labels[0], srtpKeyLen))
+	if err != nil {
+		t.Fatal(err)
+	}
+	return block, deriveKey(master, salt, labels[2], srtpSaltLen), deriveKey(master, salt, labels[1], srtpAuthKeyLen)
+}
+
+// testIV returns the counter mode IV of a packet (RFC 3711, section 4.1.1)
+func testIV(salt []byte, ssrc uint32, index uint64) []byte {
+	iv := make([]byte, 16)
+	binary.BigEndian.PutUint32(iv[4:], ssrc)
+	binary.BigEndian.PutUint64(iv[8:], index<<16)
+	for i := range salt {
+		iv[i] ^= salt[i]
+	}
+	return iv
+}
+
+// testUnprotectRTP checks and decrypts an SRTP packet sent with rollover counter roc
+func testUnprotectRTP(t *testing.T, keys SRTPKeys, packet []byte, roc uint32) []byte {
+	block, salt, auth := testSessionKeys(t, keys.LocalKey, keys.LocalSalt, [3]byte{0, 1, 2})
+	n := len(packet) - srtpTagLen
+	mac := hmac.New(sha1.New, auth)
+	mac.Write(packet[:n])
+	binary.Write(mac, binary.BigEndian, roc)
+	if !bytes.Equal(mac.Sum(nil)[:srtpTagLen], packet[n:]) {
+		t.Fatal("invalid SRTP authentication tag")
+	}
+	index := uint64(roc)<<16 | uint64(binary.BigEndian.Uint16(packet[2:]))
+	plain := append([]byte(nil), packet[:n]...)
+	cipher.NewCTR(block, testIV(salt, binary.BigEndian.Uint32(packet[8:]), index)).XORKeyStream(plain[HeaderSize:], plain[HeaderSize:])
+	return plain
+}
+
+// testProtectRTCP returns the SRTCP packet of rtcp, encrypted with index
+func testProtectRTCP(t *testing.T, keys SRTPKeys, rtcp []byte, index uint32) []byte {
+	block, salt, auth := testSessionKeys(t, keys.RemoteKey, keys.RemoteSalt, [3]byte{3, 4, 5})
+	packet := append([]byte(nil), rtcp...)
+	cipher.NewCTR(block, testIV(salt, binary.BigEndian.Uint32(rtcp[4:]), uint64(index))).XORKeyStream(packet[8:], packet[8:])
+	packet = append(packet, 0, 0, 0, 0)
+	binary.BigEndian.PutUint32(packet[len(packet)-4:], 1<<31|index)
+	mac := hmac.New(sha1.New, auth)
+	mac.Write(packet)
+	return append(packet, mac.Sum(nil)[:srtpTagLen]...)
+}
+
+func testSRTPKeys() SRTPKeys {
+	material := make([]byte, 60)
+	for i := range material {
+		material[i] = byte(i * 7)
+	}
+	keys, _ := SRTPKeysFromDTLS(material, false)
+	return keys
+}
+
+func TestSRTPSession(t *testing.T) {
+	keys := testSRTPKeys()
+	s, err := newSRTPSession(keys)
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	// packets around a sequence number wrap
+	var z Packetizer
+	z.SSRC, z.seq = 0x12345678, 0xFFFE
+	payload := bytes.Repeat([]byte{0x65, 1, 2, 3}, 100)
+	packets := z.Packetize(nil, [][]byte{payload, payload, payload}, 9000)
+	var sealed []byte
+	for i, p := range packets {
+		sealed = s.protectRTP(sealed, p.Header(), p.Payload)
+		roc := uint32(0)
+		if i == 2 {
+			roc = 1
+		}
+		plain := testUnprotectRTP(t, keys, sealed, roc)
+		if !bytes.Equal(plain[:HeaderSize], p.Header()) || !bytes.Equal(plain[HeaderSize:], p.Payload) {
+			t.Fatalf("packet %d: decrypted packet differs", i)
+		}
+	}
+
+	pli := []byte{0x80 | fmtPLI, rtcpPSFB, 0, 2, 0, 0, 0, 1, 0x12, 0x34, 0x56, 0x78}
+	packet := testProtectRTCP(t, keys, pli, 7)
+	rtcp, err := s.unprotectRTCP(packet)
+	if err != nil || !bytes.Equal(rtcp, pli) {
+		t.Fatalf("unprotected %X (%v), want %X", rtcp, err, pli)
+	}
+	packet = testProtectRTCP(t, keys, pli, 8)
+	packet[9] ^= 1
+	if _, err := s.unprotectRTCP(packet); err != errSRTPAuth {
+		t.Fatalf("altered packet: %v, want authentication failure", err)
+	}
+}
@@ -189,3 +189,8 @@ func makeCtrlMenu(cType CtrlType, qryMenu C.struct_v4l2_querymenu) ControlMenuIt
 
 	return item
 }
+
+// GetControlClass returns the class of the control with the specified id (see V4L2_CTRL_ID2CLASS)
+func GetControlClass(id CtrlID) CtrlClass {
+	return CtrlClass(id & 0x0fff0000)
+}
@@ -80,6 +80,9 @@ const (
 	CtrlMPEGVideoMultiSliceMaxBytes        CtrlID               = C.V4L2_CID_MPEG_VIDEO_MULTI_SLICE_MAX_BYTES
 	CtrlMPEGVideoMultiSliceMaxMB           CtrlID               = C.V4L2_CID_MPEG_VIDEO_MULTI_SLICE_MAX_MB
 	CtrlMPEGVideoMultiSliceMode            CtrlID               = C.V4L2_CID_MPEG_VIDEO_MULTI_SLICE_MODE
+	CtrlMPEGVideoForceKeyFrame             CtrlID               = C.V4L2_CID_MPEG_VIDEO_FORCE_KEY_FRAME
+	CtrlMPEGVideoH264MinQP                 CtrlID               = C.V4L2_CID_MPEG_VIDEO_H264_MIN_QP
+	CtrlMPEGVideoH264MaxQP                 CtrlID               = C.V4L2_CID_MPEG_VIDEO_H264_MAX_QP
 
 	// TODO (vladimir) add remainder codec, there are a lot more!
 )
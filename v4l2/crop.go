@@ -32,6 +32,18 @@ func GetCropCapability(fd uintptr, bufType BufType) (CropCapability, error) {
 	return *(*CropCapability)(unsafe.Pointer(&cap)), nil
 }
 
+// GetCropRect returns the current cropping rectangle of the device
+// See https://www.kernel.org/doc/html/latest/userspace-api/media/v4l/vidioc-g-crop.html#ioctl-vidioc-g-crop-vidioc-s-crop
+func GetCropRect(fd uintptr, bufType BufType) (Rect, error) {
+	var crop C.struct_v4l2_crop
+	crop._type = C.uint(bufType)
+
+	if err := send(fd, C.VIDIOC_G_CROP, uintptr(unsafe.Pointer(&crop))); err != nil {
+		return Rect{}, fmt.Errorf("get crop: %w", err)
+	}
+	return *(*Rect)(unsafe.Pointer(&crop.c)), nil
+}
+
 // SetCropRect sets the cropping dimension for specified device
 // See https://www.kernel.org/doc/html/latest/userspace-api/media/v4l/vidioc-g-crop.html#ioctl-vidioc-g-crop-vidioc-s-crop
 func SetCropRect(fd uintptr, r Rect) error {
@@ -0,0 +1,152 @@
+package v4l2
+
+// #include <linux/videodev2.h>
+import "C"
+
+import (
+	"encoding/binary"
+	"fmt"
+	"unsafe"
+)
+
+// DVTimingsType (v4l2_dv_timings.type)
+// See https://linuxtv.org/downloads/v4l-dvb-apis/userspace-api/v4l/vidioc-g-dv-timings.html#dv-timing-types
+type DVTimingsType = uint32
+
+const (
+	DVTimingsBT656BT1120 DVTimingsType = C.V4L2_DV_BT_656_1120
+)
+
+// BTTimings (v4l2_bt_timings) describes BT.656/BT.1120 digital video timings (i.e. HDMI, SDI)
+// See https://linuxtv.org/downloads/v4l-dvb-apis/userspace-api/v4l/vidioc-g-dv-timings.html#c.V4L.v4l2_bt_timings
+// See https://elixir.bootlin.com/linux/latest/source/include/uapi/linux/videodev2.h#L1530
+type BTTimings struct {
+	Width         uint32
+	Height        uint32
+	Interlaced    uint32
+	Polarities    uint32
+	PixelClock    uint64
+	HFrontPorch   uint32
+	HSync         uint32
+	HBackPorch    uint32
+	VFrontPorch   uint32
+	VSync         uint32
+	VBackPorch    uint32
+	ILVFrontPorch uint32
+	ILVSync       uint32
+	ILVBackPorch  uint32
+	Standards     uint32
+	Flags         uint32
+	PictureAspect Fract
+	CEA861VIC     uint8
+	HDMIVIC       uint8
+}
+
+// DVTimings (v4l2_dv_timings)
+// See https://linuxtv.org/downloads/v4l-dvb-apis/userspace-api/v4l/vidioc-g-dv-timings.html#c.V4L.v4l2_dv_timings
+type DVTimings struct {
+	Type DVTimingsType
+	BT   BTTimings
+}
+
+// FrameRate returns the frame rate (in frames per second) described by the timings
+func (t DVTimings) FrameRate() float64 {
+	bt := t.BT
+	width := uint64(bt.Width + bt.HFrontPorch + bt.HSync + bt.HBackPorch)
+	height := uint64(bt.Height + bt.VFrontPorch + bt.VSync + bt.VBackPorch)
+	if bt.Interlaced != 0 {
+		height += uint64(bt.ILVFrontPorch+bt.ILVSync+bt.ILVBackPorch) + uint64(bt.Height)
+	}
+	if width == 0 || height == 0 {
+		return 0
+	}
+	return float64(bt.PixelClock) / float64(width*height)
+}
+
+func (t DVTimings) String() string {
+	scan := "p"
+	if t.BT.Interlaced != 0 {
+		scan = "i"
+	}
+	return fmt.Sprintf("%dx%d%s%.2f (pixel clock %d Hz)", t.BT.Width, t.BT.Height, scan, t.FrameRate(), t.BT.PixelClock)
+}
+
+// QueryDVTimings asks the receiver to detect the digital video timings of the current input signal
+// See https://linuxtv.org/downloads/v4l-dvb-apis/userspace-api/v4l/vidioc-query-dv-timings.html
+func QueryDVTimings(fd uintptr) (DVTimings, error) {
+	var timings C.struct_v4l2_dv_timings
+	if err := send(fd, C.VIDIOC_QUERY_DV_TIMINGS, uintptr(unsafe.Pointer(&timings))); err != nil {
+		return DVTimings{}, fmt.Errorf("query dv timings: %w", err)
+	}
+	return makeDVTimings(&timings), nil
+}
+
+// GetDVTimings returns the digital video timings currently set for the input
+// See https://linuxtv.org/downloads/v4l-dvb-apis/userspace-api/v4l/vidioc-g-dv-timings.html
+func GetDVTimings(fd uintptr) (DVTimings, error) {
+	var timings C.struct_v4l2_dv_timings
+	if err := send(fd, C.VIDIOC_G_DV_TIMINGS, uintptr(unsafe.Pointer(&timings))); err != nil {
+		return DVTimings{}, fmt.Errorf("get dv timings: %w", err)
+	}
+	return makeDVTimings(&timings), nil
+}
+
+// SetDVTimings sets the digital video timings for the input. Drivers usually reject
+// the call (EBUSY) while buffers are allocated.
+// See https://linuxtv.org/downloads/v4l-dvb-apis/userspace-api/v4l/vidioc-g-dv-timings.html
+func SetDVTimings(fd uintptr, t DVTimings) error {
+	var timings C.struct_v4l2_dv_timings
+	raw := (*[unsafe.Sizeof(timings)]byte)(unsafe.Pointer(&timings))
+	le := binary.LittleEndian
+	le.PutUint32(raw[0:], t.Type)
+	bt := t.BT
+	for i, v := range []uint32{bt.Width, bt.Height, bt.Interlaced, bt.Polarities} {
+		le.PutUint32(raw[4+i*4:], v)
+	}
+	le.PutUint64(raw[20:], bt.PixelClock)
+	for i, v := range []uint32{
+		bt.HFrontPorch, bt.HSync, bt.HBackPorch, bt.VFrontPorch, bt.VSync, bt.VBackPorch,
+		bt.ILVFrontPorch, bt.ILVSync, bt.ILVBackPorch, bt.Standards, bt.Flags,
+		bt.PictureAspect.Numerator, bt.PictureAspect.Denominator,
+	} {
+		le.PutUint32(raw[28+i*4:], v)
+	}
+	raw[80], raw[81] = bt.CEA861VIC, bt.HDMIVIC
+
+	if err := send(fd, C.VIDIOC_S_DV_TIMINGS, uintptr(unsafe.Pointer(&timings))); err != nil {
+		return fmt.Errorf("set dv timings: %w", err)
+	}
+	return nil
+}
+
+// makeDVTimings decodes the packed v4l2_dv_timings struct (its 64-bit pixel clock is
+// not naturally aligned, so the struct can't be cast directly)
+func makeDVTimings(timings *C.struct_v4l2_dv_timings) DVTimings {
+	raw := (*[unsafe.Sizeof(*timings)]byte)(unsafe.Pointer(timings))
+	le := binary.LittleEndian
+	u32 := func(off int) uint32 { return le.Uint32(raw[off:]) }
+	return DVTimings{
+		Type: u32(0),
+		BT: BTTimings{
+			Width:         u32(4),
+			Height:        u32(8),
+			Interlaced:    u32(12),
+			Polarities:    u32(16),
+			PixelClock:    le.Uint64(raw[20:]),
+			HFrontPorch:   u32(28),
+			HSync:         u32(32),
+			HBackPorch:    u32(36),
+			VFrontPorch:   u32(40),
+			VSync:         u32(44),
+			VBackPorch:    u32(48),
+			ILVFrontPorch: u32(52),
+			ILVSync:       u32(56),
+			ILVBackPorch:  u32(60),
+			Standards:     u32(64),
+			Flags:         u32(68),
+			PictureAspect: Fract{Numerator: u32(72), Denominator: u32(76)},
+			CEA861VIC:     raw[80],
+			HDMIVIC:       raw[81],
+		},
+	}
+}
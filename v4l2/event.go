@@ -0,0 +1,97 @@
+package v4l2
+
+// #include <linux/videodev2.h>
+import "C"
+
+import (
+	"fmt"
+	"time"
+	"unsafe"
+)
+
+// EventType (v4l2_event.type)
+// See https://linuxtv.org/downloads/v4l-dvb-apis/userspace-api/v4l/vidioc-dqevent.html#event-type
+type EventType = uint32
+
+const (
+	EventAll          EventType = C.V4L2_EVENT_ALL
+	EventVSync        EventType = C.V4L2_EVENT_VSYNC
+	EventEOS          EventType = C.V4L2_EVENT_EOS
+	EventCtrl         EventType = C.V4L2_EVENT_CTRL
+	EventFrameSync    EventType = C.V4L2_EVENT_FRAME_SYNC
+	EventSourceChange EventType = C.V4L2_EVENT_SOURCE_CHANGE
+	EventMotionDetect EventType = C.V4L2_EVENT_MOTION_DET
+)
+
+// SourceChangeFlag is the change reported by an EventSourceChange event
+type SourceChangeFlag = uint32
+
+const (
+	SourceChangeResolution SourceChangeFlag = C.V4L2_EVENT_SRC_CH_RESOLUTION
+)
+
+// EventSubscriptionFlag (v4l2_event_subscription.flags)
+type EventSubscriptionFlag = uint32
+
+const (
+	EventSubFlagSendInitial   EventSubscriptionFlag = C.V4L2_EVENT_SUB_FL_SEND_INITIAL
+	EventSubFlagAllowFeedback EventSubscriptionFlag = C.V4L2_EVENT_SUB_FL_ALLOW_FEEDBACK
+)
+
+// Event (v4l2_event) is an event dequeued from the device
+// See https://linuxtv.org/downloads/v4l-dvb-apis/userspace-api/v4l/vidioc-dqevent.html#c.V4L.v4l2_event
+type Event struct {
+	Type      EventType
+	Data      [64]byte // event payload
+	Pending   uint32
+	Sequence  uint32
+	Timestamp time.Duration
+	ID        uint32
+}
+
+// SourceChanges returns the changes (SourceChangeFlag) reported by an EventSourceChange event
+func (e Event) SourceChanges() SourceChangeFlag {
+	return *(*uint32)(unsafe.Pointer(&e.Data[0]))
+}
+
+// SubscribeEvent subscribes to the specified event type (for the object id, i.e. a control or an input)
+// See https://linuxtv.org/downloads/v4l-dvb-apis/userspace-api/v4l/vidioc-subscribe-event.html
+func SubscribeEvent(fd uintptr, eventType EventType, id uint32, flags EventSubscriptionFlag) error {
+	var sub C.struct_v4l2_event_subscription
+	sub._type = C.uint(eventType)
+	sub.id = C.uint(id)
+	sub.flags = C.uint(flags)
+	if err := send(fd, C.VIDIOC_SUBSCRIBE_EVENT, uintptr(unsafe.Pointer(&sub))); err != nil {
+		return fmt.Errorf("subscribe event: type %d: %w", eventType, err)
+	}
+	return nil
+}
+
+// UnsubscribeEvent removes the event subscription
+// See https://linuxtv.org/downloads/v4l-dvb-apis/userspace-api/v4l/vidioc-subscribe-event.html
+func UnsubscribeEvent(fd uintptr, eventType EventType, id uint32) error {
+	var sub C.struct_v4l2_event_subscription
+	sub._type = C.uint(eventType)
+	sub.id = C.uint(id)
+	if err := send(fd, C.VIDIOC_UNSUBSCRIBE_EVENT, uintptr(unsafe.Pointer(&sub))); err != nil {
+		return fmt.Errorf("unsubscribe event: type %d: %w", eventType, err)
+	}
+	return nil
+}
+
+// DequeueEvent dequeues a pending event. When no event is pending, the returned error wraps ENOENT.
+// See https://linuxtv.org/downloads/v4l-dvb-apis/userspace-api/v4l/vidioc-dqevent.html
+func DequeueEvent(fd uintptr) (Event, error) {
+	var event C.struct_v4l2_event
+	if err := send(fd, C.VIDIOC_DQEVENT, uintptr(unsafe.Pointer(&event))); err != nil {
+		return Event{}, fmt.Errorf("dequeue event: %w", err)
+	}
+	return Event{
+		Type:      uint32(event._type),
+		Data:      *(*[64]byte)(unsafe.Pointer(&event.u[0])),
+		Pending:   uint32(event.pending),
+		Sequence:  uint32(event.sequence),
+		Timestamp: time.Duration(event.timestamp.tv_sec)*time.Second + time.Duration(event.timestamp.tv_nsec),
+		ID:        uint32(event.id),
+	}, nil
+}
@@ -52,7 +52,19 @@ func SetExtControlValue(fd uintptr, id CtrlID, val CtrlValue) error {
 // https://linuxtv.org/downloads/v4l-dvb-apis-new/userspace-api/v4l/extended-controls.html
 // See https://elixir.bootlin.com/linux/latest/source/include/uapi/linux/videodev2.h#L1774
 func SetExtControlValues(fd uintptr, whichCtrl CtrlClass, ctrls []Control) error {
+	if err := setExtControls(fd, whichCtrl, -1, ctrls); err != nil {
+		return fmt.Errorf("set ext controls: %w", err)
+	}
+	return nil
+}
+
+// setExtControls sends VIDIOC_S_EXT_CTRLS for ctrls, bound to the request requestFD when which
+// is CtrlWhichRequestValue.
+func setExtControls(fd uintptr, which uint32, requestFD int32, ctrls []Control) error {
 	numCtrl := len(ctrls)
+	if numCtrl == 0 {
+		return nil
+	}
 
 	var v4l2CtrlArray []C.struct_v4l2_ext_control
 
@@ -65,15 +77,14 @@ func SetExtControlValues(fd uintptr, whichCtrl CtrlClass, ctrls []Control) error
 	}
 
 	var v4l2Ctrls C.struct_v4l2_ext_controls
-	*(*uint32)(unsafe.Pointer(&v4l2Ctrls.anon0[0])) = whichCtrl
+	*(*uint32)(unsafe.Pointer(&v4l2Ctrls.anon0[0])) = which
 	v4l2Ctrls.count = C.uint(numCtrl)
-	v4l2Ctrls.controls = (*C.struct_v4l2_ext_control)(unsafe.Pointer(&v4l2CtrlArray))
-
-	if err := send(fd, C.VIDIOC_S_EXT_CTRLS, uintptr(unsafe.Pointer(&v4l2Ctrls))); err != nil {
-		return fmt.Errorf("set ext controls: %w", err)
+	v4l2Ctrls.controls = &v4l2CtrlArray[0]
+	if requestFD >= 0 {
+		v4l2Ctrls.request_fd = C.int(requestFD)
 	}
 
-	return nil
+	return send(fd, C.VIDIOC_S_EXT_CTRLS, uintptr(unsafe.Pointer(&v4l2Ctrls)))
 }
 
 // GetExtControl retrieves information (query) and current value for the specified control.
@@ -6,6 +6,7 @@ package v4l2
 */
 import "C"
 import (
+	"errors"
 	"fmt"
 	"unsafe"
 )
@@ -87,3 +88,25 @@ func GetFormatFrameInterval(fd uintptr, index uint32, encoding FourCCType, width
 	}
 	return getFrameInterval(interval)
 }
+
+// GetFormatFrameIntervals returns all supported device frame intervals for a specified encoding and frame size
+func GetFormatFrameIntervals(fd uintptr, encoding FourCCType, width, height uint32) (result []FrameIntervalEnum, err error) {
+	index := uint32(0)
+	for {
+		interval, err := GetFormatFrameInterval(fd, index, encoding, width, height)
+		if err != nil {
+			if errors.Is(err, ErrorBadArgument) && len(result) > 0 {
+				break
+			}
+			return result, fmt.Errorf("frame intervals: encoding %s: %w", PixelFormats[encoding], err)
+		}
+
+		// only discrete intervals are enumerated past index 0
+		result = append(result, interval)
+		if interval.Type != FrameIntervalTypeDiscrete {
+			break
+		}
+		index++
+	}
+	return result, nil
+}
@@ -0,0 +1,81 @@
+package v4l2
+
+/*
+#cgo linux CFLAGS: -I ${SRCDIR}/../include/
+#include <linux/videodev2.h>
+#include <linux/media.h>
+*/
+import "C"
+import (
+	"fmt"
+	"unsafe"
+)
+
+// Request API support: a request binds a set of control values to a buffer, so that the
+// driver applies the controls for the very frame captured in that buffer.
+// See https://www.kernel.org/doc/html/latest/userspace-api/media/mediactl/request-api.html
+
+const (
+	// CtrlWhichRequestValue selects the control values of a request (see SetRequestControlValues)
+	CtrlWhichRequestValue uint32 = C.V4L2_CTRL_WHICH_REQUEST_VAL
+
+	// BufCapSupportsRequests is set in RequestBuffers.Capabilities when buffers can be queued in requests
+	BufCapSupportsRequests uint32 = C.V4L2_BUF_CAP_SUPPORTS_REQUESTS
+)
+
+// AllocRequest allocates a new request on the media device mediaFd and returns its file descriptor
+// See https://www.kernel.org/doc/html/latest/userspace-api/media/mediactl/media-ioc-request-alloc.html
+func AllocRequest(mediaFd uintptr) (uintptr, error) {
+	var reqFd C.int
+	if err := send(mediaFd, C.MEDIA_IOC_REQUEST_ALLOC, uintptr(unsafe.Pointer(&reqFd))); err != nil {
+		return 0, fmt.Errorf("request alloc: %w", err)
+	}
+	return uintptr(reqFd), nil
+}
+
+// QueueRequest queues the request, along with the buffer and controls bound to it
+// See https://www.kernel.org/doc/html/latest/userspace-api/media/mediactl/media-request-ioc-queue.html
+func QueueRequest(reqFd uintptr) error {
+	if err := send(reqFd, C.MEDIA_REQUEST_IOC_QUEUE, 0); err != nil {
+		return fmt.Errorf("request queue: %w", err)
+	}
+	return nil
+}
+
+// ReinitRequest makes a completed request reusable
+// See https://www.kernel.org/doc/html/latest/userspace-api/media/mediactl/media-request-ioc-reinit.html
+func ReinitRequest(reqFd uintptr) error {
+	if err := send(reqFd, C.MEDIA_REQUEST_IOC_REINIT, 0); err != nil {
+		return fmt.Errorf("request reinit: %w", err)
+	}
+	return nil
+}
+
+// CloseRequest frees the request
+func CloseRequest(reqFd uintptr) error {
+	return CloseDevice(reqFd)
+}
+
+// SetRequestControlValues binds control values to the (not yet queued) request reqFd
+func SetRequestControlValues(fd, reqFd uintptr, ctrls []Control) error {
+	if err := setExtControls(fd, CtrlWhichRequestValue, int32(reqFd), ctrls); err != nil {
+		return fmt.Errorf("set request controls: %w", err)
+	}
+	return nil
+}
+
+// QueueBufferInRequest binds the buffer at index to the (not yet queued) request reqFd. The
+// buffer is queued to the driver when the request is (see QueueRequest).
+func QueueBufferInRequest(fd uintptr, ioType IOType, bufType BufType, index uint32, reqFd uintptr) (Buffer, error) {
+	var v4l2Buf C.struct_v4l2_buffer
+	v4l2Buf._type = C.uint(bufType)
+	v4l2Buf.memory = C.uint(ioType)
+	v4l2Buf.index = C.uint(index)
+	v4l2Buf.flags = C.uint(BufFlagRequestFD)
+	*(*int32)(unsafe.Pointer(&v4l2Buf.anon0[0])) = int32(reqFd)
+
+	if err := send(fd, C.VIDIOC_QBUF, uintptr(unsafe.Pointer(&v4l2Buf))); err != nil {
+		return Buffer{}, fmt.Errorf("buffer queue: request: %w", err)
+	}
+	return makeBuffer(v4l2Buf), nil
+}
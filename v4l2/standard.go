@@ -0,0 +1,110 @@
+package v4l2
+
+// #include <linux/videodev2.h>
+import "C"
+
+import (
+	"errors"
+	"fmt"
+	"unsafe"
+)
+
+// Analog video standards (v4l2_std_id)
+// See https://linuxtv.org/downloads/v4l-dvb-apis/userspace-api/v4l/vidioc-enumstd.html#v4l2-std-id
+const (
+	StdPAL_B  StandardId = C.V4L2_STD_PAL_B
+	StdPAL_G  StandardId = C.V4L2_STD_PAL_G
+	StdPAL_H  StandardId = C.V4L2_STD_PAL_H
+	StdPAL_I  StandardId = C.V4L2_STD_PAL_I
+	StdPAL_D  StandardId = C.V4L2_STD_PAL_D
+	StdPAL_M  StandardId = C.V4L2_STD_PAL_M
+	StdPAL_N  StandardId = C.V4L2_STD_PAL_N
+	StdPAL_Nc StandardId = C.V4L2_STD_PAL_Nc
+	StdPAL_60 StandardId = C.V4L2_STD_PAL_60
+
+	StdNTSC_M    StandardId = C.V4L2_STD_NTSC_M
+	StdNTSC_M_JP StandardId = C.V4L2_STD_NTSC_M_JP
+	StdNTSC_443  StandardId = C.V4L2_STD_NTSC_443
+	StdNTSC_M_KR StandardId = C.V4L2_STD_NTSC_M_KR
+
+	StdSECAM_B StandardId = C.V4L2_STD_SECAM_B
+	StdSECAM_D StandardId = C.V4L2_STD_SECAM_D
+	StdSECAM_G StandardId = C.V4L2_STD_SECAM_G
+	StdSECAM_K StandardId = C.V4L2_STD_SECAM_K
+	StdSECAM_L StandardId = C.V4L2_STD_SECAM_L
+
+	StdPAL     StandardId = C.V4L2_STD_PAL
+	StdNTSC    StandardId = C.V4L2_STD_NTSC
+	StdSECAM   StandardId = C.V4L2_STD_SECAM
+	Std525_60  StandardId = C.V4L2_STD_525_60
+	Std625_50  StandardId = C.V4L2_STD_625_50
+	StdUnknown StandardId = C.V4L2_STD_UNKNOWN
+	StdAll     StandardId = C.V4L2_STD_ALL
+)
+
+// Standard (v4l2_standard) describes a video standard supported by the current input
+// See https://linuxtv.org/downloads/v4l-dvb-apis/userspace-api/v4l/vidioc-enumstd.html#c.V4L.v4l2_standard
+type Standard struct {
+	Index       uint32
+	ID          StandardId
+	Name        string
+	FramePeriod Fract
+	FrameLines  uint32
+}
+
+// GetStandard returns the video standard currently selected for the input
+// See https://linuxtv.org/downloads/v4l-dvb-apis/userspace-api/v4l/vidioc-g-std.html
+func GetStandard(fd uintptr) (StandardId, error) {
+	var id C.v4l2_std_id
+	if err := send(fd, C.VIDIOC_G_STD, uintptr(unsafe.Pointer(&id))); err != nil {
+		return 0, fmt.Errorf("standard get: %w", err)
+	}
+	return StandardId(id), nil
+}
+
+// SetStandard selects the video standard of the input. The driver may pick any single
+// standard included in the id mask.
+// See https://linuxtv.org/downloads/v4l-dvb-apis/userspace-api/v4l/vidioc-g-std.html
+func SetStandard(fd uintptr, id StandardId) error {
+	std := C.v4l2_std_id(id)
+	if err := send(fd, C.VIDIOC_S_STD, uintptr(unsafe.Pointer(&std))); err != nil {
+		return fmt.Errorf("standard set: %#x: %w", id, err)
+	}
+	return nil
+}
+
+// QueryStandard returns the set of standards matching the signal received on the input
+// See https://linuxtv.org/downloads/v4l-dvb-apis/userspace-api/v4l/vidioc-querystd.html
+func QueryStandard(fd uintptr) (StandardId, error) {
+	var id C.v4l2_std_id
+	if err := send(fd, C.VIDIOC_QUERYSTD, uintptr(unsafe.Pointer(&id))); err != nil {
+		return 0, fmt.Errorf("standard query: %w", err)
+	}
+	return StandardId(id), nil
+}
+
+// GetAllStandards returns the video standards supported by the current input by
+// iterating from index = 0 until an error (EINVAL) is returned.
+// See https://linuxtv.org/downloads/v4l-dvb-apis/userspace-api/v4l/vidioc-enumstd.html
+func GetAllStandards(fd uintptr) (result []Standard, err error) {
+	index := uint32(0)
+	for {
+		var std C.struct_v4l2_standard
+		std.index = C.uint(index)
+		if err = send(fd, C.VIDIOC_ENUMSTD, uintptr(unsafe.Pointer(&std))); err != nil {
+			if errors.Is(err, ErrorBadArgument) && len(result) > 0 {
+				break
+			}
+			return result, fmt.Errorf("all standards: %w", err)
+		}
+		result = append(result, Standard{
+			Index:       uint32(std.index),
+			ID:          StandardId(std.id),
+			Name:        C.GoString((*C.char)(unsafe.Pointer(&std.name[0]))),
+			FramePeriod: *(*Fract)(unsafe.Pointer(&std.frameperiod)),
+			FrameLines:  uint32(std.framelines),
+		})
+		index++
+	}
+	return result, nil
+}
@@ -171,7 +171,7 @@ func StreamOff(dev StreamingDevice) error {
 // for video capture or video output when using either mem map, user pointer, or DMA buffers.
 // See https://www.kernel.org/doc/html/latest/userspace-api/media/v4l/vidioc-reqbufs.html#vidioc-reqbufs
 func InitBuffers(dev StreamingDevice) (RequestBuffers, error) {
-	if dev.MemIOType() != IOTypeMMAP && dev.MemIOType() != IOTypeDMABuf {
+	if dev.MemIOType() != IOTypeMMAP && dev.MemIOType() != IOTypeUserPtr && dev.MemIOType() != IOTypeDMABuf {
 		return RequestBuffers{}, fmt.Errorf("request buffers: %w", ErrorUnsupported)
 	}
 	var req C.struct_v4l2_requestbuffers
@@ -190,7 +190,7 @@ func InitBuffers(dev StreamingDevice) (RequestBuffers, error) {
 // buffers. Useful when shuttingdown the stream.
 // See https://linuxtv.org/downloads/v4l-dvb-apis-new/userspace-api/v4l/vidioc-reqbufs.html
 func ResetBuffers(dev StreamingDevice) (RequestBuffers, error) {
-	if dev.MemIOType() != IOTypeMMAP && dev.MemIOType() != IOTypeDMABuf {
+	if dev.MemIOType() != IOTypeMMAP && dev.MemIOType() != IOTypeUserPtr && dev.MemIOType() != IOTypeDMABuf {
 		return RequestBuffers{}, fmt.Errorf("reset buffers: %w", ErrorUnsupported)
 	}
 	var req C.struct_v4l2_requestbuffers
@@ -290,6 +290,27 @@ func QueueBuffer(fd uintptr, ioType IOType, bufType BufType, index uint32) (Buff
 	return makeBuffer(v4l2Buf), nil
 }
 
+// QueueUserPtrBuffer enqueues the application-allocated buffer buf at the specified index when using
+// user pointer IO. The buffer memory must stay valid (and should be page-aligned) until the buffer is dequeued.
+// https://www.kernel.org/doc/html/latest/userspace-api/media/v4l/userp.html
+func QueueUserPtrBuffer(fd uintptr, bufType BufType, index uint32, buf []byte) (Buffer, error) {
+	if len(buf) == 0 {
+		return Buffer{}, fmt.Errorf("buffer queue: user pointer: %w", ErrorBadArgument)
+	}
+	var v4l2Buf C.struct_v4l2_buffer
+	v4l2Buf._type = C.uint(bufType)
+	v4l2Buf.memory = C.uint(IOTypeUserPtr)
+	v4l2Buf.index = C.uint(index)
+	v4l2Buf.length = C.uint(len(buf))
+	*(*uintptr)(unsafe.Pointer(&v4l2Buf.m[0])) = uintptr(unsafe.Pointer(&buf[0]))
+
+	if err := send(fd, C.VIDIOC_QBUF, uintptr(unsafe.Pointer(&v4l2Buf))); err != nil {
+		return Buffer{}, fmt.Errorf("buffer queue: user pointer: %w", err)
+	}
+
+	return makeBuffer(v4l2Buf), nil
+}
+
 // DequeueBuffer dequeues a buffer in the device driver, marking it as consumed by the application,
 // when using either memory map, user pointer, or DMA buffers. Buffer is returned with
 // additional information about the dequeued buffer.
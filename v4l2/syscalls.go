@@ -87,7 +87,8 @@ func send(fd, req, arg uintptr) error {
 }
 
 // WaitForRead returns a channel that can be used to be notified when
-// a device's is ready to be read.
+// a device's is ready to be read. Note that the wait occupies an OS thread (blocked in select);
+// device streaming instead waits on the fd using the Go runtime poller.
 func WaitForRead(dev Device) <-chan struct{} {
 	sigChan := make(chan struct{})
 
@@ -27,6 +27,16 @@ var InputStatuses = map[InputStatus]string{
 	InputStatusNoColor:  "no color",
 }
 
+// InputCapability (v4l2_input.capabilities)
+// See https://linuxtv.org/downloads/v4l-dvb-apis/userspace-api/v4l/vidioc-enuminput.html#input-capabilities
+type InputCapability = uint32
+
+const (
+	InputCapDVTimings  InputCapability = C.V4L2_IN_CAP_DV_TIMINGS
+	InputCapStd        InputCapability = C.V4L2_IN_CAP_STD
+	InputCapNativeSize InputCapability = C.V4L2_IN_CAP_NATIVE_SIZE
+)
+
 type InputType = uint32
 
 const (
@@ -86,6 +96,15 @@ func GetCurrentVideoInputIndex(fd uintptr) (int32, error) {
 	return index, nil
 }
 
+// SetVideoInputIndex selects the current video input for the device
+// See https://linuxtv.org/downloads/v4l-dvb-apis/userspace-api/v4l/vidioc-g-input.html
+func SetVideoInputIndex(fd uintptr, index int32) error {
+	if err := send(fd, C.VIDIOC_S_INPUT, uintptr(unsafe.Pointer(&index))); err != nil {
+		return fmt.Errorf("video input set: index %d: %w", index, err)
+	}
+	return nil
+}
+
 // GetVideoInputInfo returns specified input information for video device
 // See https://linuxtv.org/downloads/v4l-dvb-apis/userspace-api/v4l/vidioc-enuminput.html
 func GetVideoInputInfo(fd uintptr, index uint32) (InputInfo, error) {
@@ -0,0 +1,9 @@
+// Package wsstream streams captured frames to WebSocket clients.
+//
+// Each frame is sent as one binary message: a Header (HeaderSize bytes, big endian)
+// followed by the frame data. Clients pace the stream with credits: a client sends a
+// binary message holding a big endian uint32, the number of additional frames it is ready
+// to receive (i.e. 1 after handling each frame, which acknowledges it). While a client has
+// no credit left, only the latest frame is kept for it, so a lagging client skips to the
+// most recent frame instead of falling further behind.
+package wsstream
@@ -0,0 +1,284 @@
+package wsstream
+
+import (
+	"bufio"
+	"encoding/binary"
+	"net"
+	"net/http"
+	"sync"
+	"sync/atomic"
+	"time"
+)
+
+// HeaderSize is the size of the header preceding the frame data of each message
+const HeaderSize = 16
+
+// Header describes the frame carried by a message
+type Header struct {
+	// Sequence is the frame sequence number
+	Sequence uint32
+
+	// Format is the pixel format of the frame (v4l2.FourCCType)
+	Format uint32
+
+	// Timestamp is the capture time of the frame
+	Timestamp time.Duration
+}
+
+func (h Header) put(buf []byte) {
+	binary.BigEndian.PutUint32(buf[0:], h.Sequence)
+	binary.BigEndian.PutUint32(buf[4:], h.Format)
+	binary.BigEndian.PutUint64(buf[8:], uint64(h.Timestamp))
+}
+
+// message is a frame encoded once and shared by the clients of a tier. The prefix holds
+// the WebSocket frame header and the Header; the frame data is written from the caller's
+// buffer (vectored with the prefix), and handed back once every client is done with it.
+type message struct {
+	prefix  [maxFrameHeader + HeaderSize]byte
+	n       int
+	payload []byte
+	release func()
+	refs    int32
+}
+
+var messagePool = sync.Pool{New: func() interface{} { return new(message) }}
+
+func newMessage(h Header, payload []byte, release func()) *message {
+	m := messagePool.Get().(*message)
+	m.n = putFrameHeader(m.prefix[:], opBinary, HeaderSize+len(payload))
+	h.put(m.prefix[m.n:])
+	m.n += HeaderSize
+	m.payload, m.release, m.refs = payload, release, 1
+	return m
+}
+
+func (m *message) retain() {
+	atomic.AddInt32(&m.refs, 1)
+}
+
+func (m *message) done() {
+	if atomic.AddInt32(&m.refs, -1) != 0 {
+		return
+	}
+	if m.release != nil {
+		m.release()
+	}
+	m.payload, m.release = nil, nil
+	messagePool.Put(m)
+}
+
+type config struct {
+	credits      uint32
+	writeTimeout time.Duration
+}
+
+type Option func(*config)
+
+// WithInitialCredits sets the number of frames a client can receive before sending
+// credits (1 by default)
+func WithInitialCredits(credits uint32) Option {
+	return func(o *config) {
+		o.credits = credits
+	}
+}
+
+// WithWriteTimeout sets how long writing a frame to a client may take before the client
+// is disconnected (5 seconds by default)
+func WithWriteTimeout(timeout time.Duration) Option {
+	return func(o *config) {
+		o.writeTimeout = timeout
+	}
+}
+
+// Server is an http.Handler streaming published frames to WebSocket clients. Clients
+// select a tier (i.e. a resolution or quality of the stream) with the "tier" query
+// parameter; frames are published to a tier, and encoded once for all its clients.
+type Server struct {
+	config config
+	mu     sync.RWMutex
+	tiers  map[string]map[*client]struct{}
+}
+
+// NewServer returns a server with no clients
+func NewServer(opts ...Option) *Server {
+	s := &Server{
+		config: config{credits: 1, writeTimeout: 5 * time.Second},
+		tiers:  make(map[string]map[*client]struct{}),
+	}
+	for _, o := range opts {
+		o(&s.config)
+	}
+	return s
+}
+
+// Publish sends the frame to the clients of the tier. The payload is not copied: release
+// (when not nil) is called once the frame has been written to (or skipped by) all clients,
+// after which the payload may be reused.
+func (s *Server) Publish(tier string, h Header, payload []byte, release func()) {
+	m := newMessage(h, payload, release)
+	s.mu.RLock()
+	for c := range s.tiers[tier] {
+		m.retain()
+		c.offer(m)
+	}
+	s.mu.RUnlock()
+	m.done()
+}
+
+// Clients returns the number of clients connected to the tier
+func (s *Server) Clients(tier string) int {
+	s.mu.RLock()
+	defer s.mu.RUnlock()
+	return len(s.tiers[tier])
+}
+
+// ServeHTTP upgrades the request to a WebSocket connection and streams the frames
+// published to the requested tier until the client disconnects.
+func (s *Server) ServeHTTP(w http.ResponseWriter, r *http.Request) {
+	conn, reader, err := upgrade(w, r)
+	if err != nil {
+		return
+	}
+	tier := r.URL.Query().Get("tier")
+	c := &client{conn: conn, credits: s.config.credits, wake: make(chan struct{}, 1), done: make(chan struct{})}
+
+	s.mu.Lock()
+	if s.tiers[tier] == nil {
+		s.tiers[tier] = make(map[*client]struct{})
+	}
+	s.tiers[tier][c] = struct{}{}
+	s.mu.Unlock()
+
+	go c.readLoop(reader)
+	c.writeLoop(s.config.writeTimeout)
+
+	s.mu.Lock()
+	delete(s.tiers[tier], c)
+	s.mu.Unlock()
+	c.drop()
+}
+
+// client is a connected WebSocket client. The latest frame offered to it waits in pending
+// until the client has credits to receive it.
+type client struct {
+	conn net.Conn
+
+	mu      sync.Mutex
+	pending *message
+	credits uint32
+	closed  bool
+
+	writeMu sync.Mutex // serializes frames and control messages
+	wake    chan struct{}
+	done    chan struct{}
+}
+
+func (c *client) signal() {
+	select {
+	case c.wake <- struct{}{}:
+	default:
+	}
+}
+
+// offer replaces the pending frame of the client with m
+func (c *client) offer(m *message) {
+	c.mu.Lock()
+	if c.closed {
+		c.mu.Unlock()
+		m.done()
+		return
+	}
+	old := c.pending
+	c.pending = m
+	c.mu.Unlock()
+	if old != nil {
+		old.done() // skipped
+	}
+	c.signal()
+}
+
+func (c *client) writeLoop(timeout time.Duration) {
+	for {
+		select {
+		case <-c.wake:
+		case <-c.done:
+			return
+		}
+		c.mu.Lock()
+		m := c.pending
+		if m == nil || c.credits == 0 {
+			c.mu.Unlock()
+			continue
+		}
+		c.pending = nil
+		c.credits--
+		c.mu.Unlock()
+
+		err := c.write(timeout, m.prefix[:m.n], m.payload)
+		m.done()
+		if err != nil {
+			return
+		}
+	}
+}
+
+// write sends the buffers with a single vectored write (writev on TCP connections)
+func (c *client) write(timeout time.Duration, bufs ...[]byte) error {
+	c.writeMu.Lock()
+	defer c.writeMu.Unlock()
+	if timeout > 0 {
+		c.conn.SetWriteDeadline(time.Now().Add(timeout))
+	}
+	buffers := net.Buffers(bufs)
+	_, err := buffers.WriteTo(c.conn)
+	return err
+}
+
+func (c *client) readLoop(r *bufio.Reader) {
+	defer close(c.done)
+	var buf [maxClientPayload]byte
+	for {
+		opcode, payload, err := readFrame(r, buf[:])
+		if err != nil {
+			return
+		}
+		switch opcode {
+		case opBinary:
+			if len(payload) != 4 {
+				return
+			}
+			c.mu.Lock()
+			c.credits += binary.BigEndian.Uint32(payload)
+			c.mu.Unlock()
+			c.signal()
+		case opPing:
+			var head [maxFrameHeader]byte
+			n := putFrameHeader(head[:], opPong, len(payload))
+			if c.write(time.Second, head[:n], payload) != nil {
+				return
+			}
+		case opClose:
+			var head [maxFrameHeader]byte
+			n := putFrameHeader(head[:], opClose, 0)
+			c.write(time.Second, head[:n])
+			return
+		case opText, opContinuation, opPong:
+			// ignored
+		default:
+			return
+		}
+	}
+}
+
+// drop closes the connection and releases the pending frame
+func (c *client) drop() {
+	c.conn.Close()
+	c.mu.Lock()
+	m := c.pending
+	c.pending, c.closed = nil, true
+	c.mu.Unlock()
+	if m != nil {
+		m.done()
+	}
+}
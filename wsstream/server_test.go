@@ -0,0 +1,100 @@
+package wsstream
+
+import (
+	"bufio"
+	"encoding/binary"
+	"fmt"
+	"io"
+	"net"
+	"net/http"
+	"net/http/httptest"
+	"strings"
+	"sync/atomic"
+	"testing"
+	"time"
+)
+
+// dial connects a minimal WebSocket client to the server
+func dial(t *testing.T, url string) (net.Conn, *bufio.Reader) {
+	conn, err := net.Dial("tcp", strings.TrimPrefix(url, "http://"))
+	if err != nil {
+		t.Fatal(err)
+	}
+	fmt.Fprintf(conn, "GET /?tier=hd HTTP/1.1\r\nHost: test\r\nConnection: Upgrade\r\nUpgrade: websocket\r\n"+
+		"Sec-WebSocket-Version: 13\r\nSec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n\r\n")
+	r := bufio.NewReader(conn)
+	resp, err := http.ReadResponse(r, nil)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if resp.StatusCode != http.StatusSwitchingProtocols || resp.Header.Get("Sec-WebSocket-Accept") != "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=" {
+		t.Fatalf("unexpected handshake response: %v", resp)
+	}
+	return conn, r
+}
+
+func readMessage(t *testing.T, r *bufio.Reader) (Header, []byte) {
+	var head [4]byte
+	if _, err := io.ReadFull(r, head[:2]); err != nil {
+		t.Fatal(err)
+	}
+	length := int(head[1])
+	if length == 126 {
+		io.ReadFull(r, head[2:4])
+		length = int(binary.BigEndian.Uint16(head[2:]))
+	}
+	msg := make([]byte, length)
+	if _, err := io.ReadFull(r, msg); err != nil {
+		t.Fatal(err)
+	}
+	h := Header{
+		Sequence:  binary.BigEndian.Uint32(msg[0:]),
+		Format:    binary.BigEndian.Uint32(msg[4:]),
+		Timestamp: time.Duration(binary.BigEndian.Uint64(msg[8:])),
+	}
+	return h, msg[HeaderSize:]
+}
+
+func sendCredits(conn net.Conn, credits uint32) {
+	frame := []byte{0x80 | opBinary, 0x80 | 4, 1, 2, 3, 4, 0, 0, 0, 0}
+	binary.BigEndian.PutUint32(frame[6:], credits)
+	for i := 0; i < 4; i++ {
+		frame[6+i] ^= frame[2+i]
+	}
+	conn.Write(frame)
+}
+
+func TestServerLatestFrame(t *testing.T) {
+	server := NewServer()
+	ts := httptest.NewServer(server)
+	defer ts.Close()
+
+	conn, r := dial(t, ts.URL)
+	defer conn.Close()
+	for server.Clients("hd") == 0 {
+		time.Sleep(time.Millisecond)
+	}
+
+	var released int32
+	release := func() { atomic.AddInt32(&released, 1) }
+	payload := make([]byte, 300)
+
+	server.Publish("hd", Header{Sequence: 1, Format: 42, Timestamp: time.Second}, payload, release)
+	if h, data := readMessage(t, r); h.Sequence != 1 || h.Format != 42 || h.Timestamp != time.Second || len(data) != len(payload) {
+		t.Fatalf("unexpected message %+v (%d bytes)", h, len(data))
+	}
+
+	// out of credits: only the latest frame is kept
+	server.Publish("hd", Header{Sequence: 2}, payload, release)
+	server.Publish("hd", Header{Sequence: 3}, payload, release)
+	sendCredits(conn, 1)
+	if h, _ := readMessage(t, r); h.Sequence != 3 {
+		t.Fatalf("got frame %d, want latest frame 3", h.Sequence)
+	}
+	for i := 0; atomic.LoadInt32(&released) != 3; i++ {
+		if i == 1000 {
+			t.Fatalf("%d frames released, want 3", atomic.LoadInt32(&released))
+		}
+		time.Sleep(time.Millisecond)
+	}
+}
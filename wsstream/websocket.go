@@ -0,0 +1,126 @@
+package wsstream
+
+import (
+	"bufio"
+	"crypto/sha1"
+	"encoding/base64"
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"io"
+	"net"
+	"net/http"
+	"strings"
+)
+
+// WebSocket opcodes (RFC 6455, section 5.2)
+const (
+	opContinuation = 0x0
+	opText         = 0x1
+	opBinary       = 0x2
+	opClose        = 0x8
+	opPing         = 0x9
+	opPong         = 0xA
+)
+
+// maxFrameHeader is the size of the largest server frame header (no mask)
+const maxFrameHeader = 10
+
+// maxClientPayload bounds the messages read from clients (credits and control frames)
+const maxClientPayload = 125
+
+var errProtocol = errors.New("wsstream: protocol error")
+
+// upgrade completes the WebSocket opening handshake (RFC 6455, section 4.2) and takes
+// over the connection.
+func upgrade(w http.ResponseWriter, r *http.Request) (net.Conn, *bufio.Reader, error) {
+	key := r.Header.Get("Sec-WebSocket-Key")
+	switch {
+	case r.Method != http.MethodGet,
+		!headerContains(r.Header, "Connection", "upgrade"),
+		!headerContains(r.Header, "Upgrade", "websocket"),
+		r.Header.Get("Sec-WebSocket-Version") != "13",
+		key == "":
+		http.Error(w, "websocket upgrade required", http.StatusBadRequest)
+		return nil, nil, fmt.Errorf("wsstream: upgrade: %w", errProtocol)
+	}
+	hijacker, ok := w.(http.Hijacker)
+	if !ok {
+		http.Error(w, "websocket not supported", http.StatusInternalServerError)
+		return nil, nil, fmt.Errorf("wsstream: upgrade: connection cannot be hijacked")
+	}
+	conn, rw, err := hijacker.Hijack()
+	if err != nil {
+		return nil, nil, fmt.Errorf("wsstream: upgrade: %w", err)
+	}
+	response := "HTTP/1.1 101 Switching Protocols\r\n" +
+		"Upgrade: websocket\r\n" +
+		"Connection: Upgrade\r\n" +
+		"Sec-WebSocket-Accept: " + acceptKey(key) + "\r\n\r\n"
+	if _, err := conn.Write([]byte(response)); err != nil {
+		conn.Close()
+		return nil, nil, fmt.Errorf("wsstream: upgrade: %w", err)
+	}
+	return conn, rw.Reader, nil
+}
+
+func acceptKey(key string) string {
+	sum := sha1.Sum([]byte(key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"))
+	return base64.StdEncoding.EncodeToString(sum[:])
+}
+
+func headerContains(h http.Header, name, token string) bool {
+	for _, value := range h[name] {
+		for _, t := range strings.Split(value, ",") {
+			if strings.EqualFold(strings.TrimSpace(t), token) {
+				return true
+			}
+		}
+	}
+	return false
+}
+
+// putFrameHeader writes the header of an unfragmented, unmasked server frame into buf,
+// and returns its size.
+func putFrameHeader(buf []byte, opcode byte, length int) int {
+	buf[0] = 0x80 | opcode
+	switch {
+	case length < 126:
+		buf[1] = byte(length)
+		return 2
+	case length <= 0xFFFF:
+		buf[1] = 126
+		binary.BigEndian.PutUint16(buf[2:], uint16(length))
+		return 4
+	default:
+		buf[1] = 127
+		binary.BigEndian.PutUint64(buf[2:], uint64(length))
+		return 10
+	}
+}
+
+// readFrame reads a client frame into buf (which must hold maxClientPayload bytes).
+// Client frames are masked, and only small unfragmented messages are expected.
+func readFrame(r *bufio.Reader, buf []byte) (opcode byte, payload []byte, err error) {
+	var head [2]byte
+	if _, err := io.ReadFull(r, head[:]); err != nil {
+		return 0, nil, err
+	}
+	fin, opcode, masked := head[0]&0x80 != 0, head[0]&0x0F, head[1]&0x80 != 0
+	length := int(head[1] & 0x7F)
+	if !fin || !masked || length > maxClientPayload {
+		return 0, nil, errProtocol
+	}
+	var mask [4]byte
+	if _, err := io.ReadFull(r, mask[:]); err != nil {
+		return 0, nil, err
+	}
+	payload = buf[:length]
+	if _, err := io.ReadFull(r, payload); err != nil {
+		return 0, nil, err
+	}
+	for i := range payload {
+		payload[i] ^= mask[i&3]
+	}
+	return opcode, payload, nil
+}